@@ -0,0 +1,91 @@
+#include "bench.h"
+#include "mcc_btree_map.h"
+#include "mcc_hash_map.h"
+#include "mcc_list.h"
+#include "mcc_map.h"
+#include "mcc_vector.h"
+
+/*
+ * Short-lived containers, as built and thrown away by a request handler:
+ * every round fills a map, a B-tree map, a hash map, a list and a vector with
+ * n elements each, then gets rid of all of them. The heap rows drop each
+ * container, the arena rows drop them too and then release the arena to the
+ * mark taken at the start of the round.
+ *
+ * usage: bench_arena [elements per container] (default 1e3)
+ */
+
+#define ELEMENTS 4000000
+
+struct round {
+	struct mcc_map *map;
+	struct mcc_btree_map *btree;
+	struct mcc_hash_map *hash;
+	struct mcc_list *list;
+	struct mcc_vector *vec;
+};
+
+static void build(struct round *r, struct mcc_arena *arena, size_t n,
+		  uint64_t *state)
+{
+	const struct mcc_object_interface *T = mcc_ulong_long();
+	uint64_t key;
+	size_t i;
+
+	r->map = mcc_map_new_in(arena, T, T);
+	r->btree = mcc_btree_map_new_in(arena, T, T);
+	r->hash = mcc_hash_map_new_in(arena, T, T);
+	r->list = mcc_list_new_in(arena, T);
+	r->vec = mcc_vector_new_in(arena, T);
+	for (i = 0; i < n; i++) {
+		key = next_random(state);
+		mcc_map_insert(r->map, &key, &i);
+		mcc_btree_map_insert(r->btree, &key, &i);
+		mcc_hash_map_insert(r->hash, &key, &i);
+		mcc_list_push_back(r->list, &key);
+		mcc_vector_push(r->vec, &key);
+	}
+}
+
+static void teardown(struct round *r)
+{
+	mcc_map_drop(r->map);
+	mcc_btree_map_drop(r->btree);
+	mcc_hash_map_drop(r->hash);
+	mcc_list_drop(r->list);
+	mcc_vector_drop(r->vec);
+}
+
+static void run(const char *name, struct mcc_arena *arena, size_t n)
+{
+	size_t rounds = ELEMENTS / n, i, mark;
+	double t, t_build = 0, t_drop = 0;
+	uint64_t state = 1;
+	struct round r;
+
+	for (i = 0; i < rounds; i++) {
+		mark = mcc_arena_mark(arena);
+		t = now();
+		build(&r, arena, n, &state);
+		t_build += now() - t;
+		t = now();
+		teardown(&r);
+		mcc_arena_release(arena, mark);
+		t_drop += now() - t;
+	}
+	printf("%-8s %12.1f %12.1f\n", name, t_build / rounds * 1e6,
+	       t_drop / rounds * 1e6);
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = max_size_from_args(argc, argv, 1000);
+	struct mcc_arena *arena = mcc_arena_new(0);
+
+	printf("%zu elements per container, us per round\n", n);
+	printf("%-8s %12s %12s\n", "", "build", "teardown");
+	run("heap", NULL, n);
+	run("arena", arena, n);
+	mcc_arena_drop(arena);
+	return 0;
+}
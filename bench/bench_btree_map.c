@@ -0,0 +1,88 @@
+#include "bench.h"
+#include "mcc_btree_map.h"
+#include "mcc_map.h"
+
+/*
+ * mcc_btree_map against the red-black mcc_map on 64-bit keys: random inserts,
+ * point lookups in a different random order and a full in-order scan.
+ *
+ * usage: bench_btree_map [keys] [order]    (default 1e6, derived from K)
+ */
+
+int main(int argc, char **argv)
+{
+	size_t n = max_size_from_args(argc, argv, 1000000), i;
+	size_t order = argc > 2 ? strtoul(argv[2], NULL, 10) : 0;
+	uint64_t *keys = malloc(n * sizeof(uint64_t)), *probes, sum;
+	uint64_t state = 0x9e3779b97f4a7c15ULL, *v;
+	struct mcc_btree_map *btree;
+	struct mcc_btree_map_iter *btree_iter;
+	struct mcc_map *rb;
+	struct mcc_map_iter *rb_iter;
+	struct mcc_pair *pair;
+	double t[2][3];
+
+	probes = malloc(n * sizeof(uint64_t));
+	for (i = 0; i < n; i++)
+		keys[i] = next_random(&state);
+	for (i = 0; i < n; i++)
+		probes[i] = keys[next_random(&state) % n];
+
+	rb = mcc_map_new(mcc_ulong_long(), mcc_ulong_long());
+	if (order)
+		btree = mcc_btree_map_new_with_order(mcc_ulong_long(),
+						     mcc_ulong_long(), order);
+	else
+		btree = mcc_btree_map_new(mcc_ulong_long(), mcc_ulong_long());
+
+	t[0][0] = now();
+	for (i = 0; i < n; i++)
+		mcc_map_insert(rb, &keys[i], &i);
+	t[0][0] = now() - t[0][0];
+
+	t[1][0] = now();
+	for (i = 0; i < n; i++)
+		mcc_btree_map_insert(btree, &keys[i], &i);
+	t[1][0] = now() - t[1][0];
+
+	sum = 0;
+	t[0][1] = now();
+	for (i = 0; i < n; i++) {
+		mcc_map_get(rb, &probes[i], (void **)&v);
+		sum += *v;
+	}
+	t[0][1] = now() - t[0][1];
+
+	t[1][1] = now();
+	for (i = 0; i < n; i++) {
+		mcc_btree_map_get(btree, &probes[i], (void **)&v);
+		sum -= *v;
+	}
+	t[1][1] = now() - t[1][1];
+
+	t[0][2] = now();
+	rb_iter = mcc_map_iter_new(rb);
+	while (mcc_map_iter_next(rb_iter, &pair))
+		sum += *(uint64_t *)pair->value;
+	t[0][2] = now() - t[0][2];
+
+	t[1][2] = now();
+	btree_iter = mcc_btree_map_iter_new(btree);
+	while (mcc_btree_map_iter_next(btree_iter, &pair))
+		sum -= *(uint64_t *)pair->value;
+	t[1][2] = now() - t[1][2];
+
+	printf("%zu keys, ns per operation (checksum %llu)\n", n,
+	       (unsigned long long)sum);
+	puts("          |   insert   lookup     scan");
+	printf("rb tree   | %8.1f %8.1f %8.1f\n", t[0][0] * 1e9 / n,
+	       t[0][1] * 1e9 / n, t[0][2] * 1e9 / n);
+	printf("b-tree    | %8.1f %8.1f %8.1f\n", t[1][0] * 1e9 / n,
+	       t[1][1] * 1e9 / n, t[1][2] * 1e9 / n);
+
+	mcc_map_drop(rb);
+	mcc_btree_map_drop(btree);
+	free(keys);
+	free(probes);
+	return 0;
+}
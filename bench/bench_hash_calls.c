@@ -0,0 +1,92 @@
+#include "bench.h"
+#include "chained_hash_map.h"
+#include "mcc_hash_map.h"
+#include <string.h>
+
+/*
+ * Count the K->hash and K->cmp calls made by mcc_hash_map and the chained
+ * layout on string keys. mcc_hash_map stores the full hash in every slot, so
+ * a resize never hashes a key again and a probe only compares keys whose
+ * hashes are equal.
+ *
+ * usage: bench_hash_calls [entries]    (default 1e6)
+ */
+
+static size_t hash_calls, cmp_calls;
+
+static int counting_cmp(const mcc_str_t *self, const mcc_str_t *other)
+{
+	cmp_calls++;
+	return mcc_str()->cmp(self, other);
+}
+
+static size_t counting_hash(const mcc_str_t *key)
+{
+	hash_calls++;
+	return mcc_str()->hash(key);
+}
+
+static const struct mcc_object_interface counting_str = {
+	.size = sizeof(mcc_str_t),
+	.drop = (mcc_drop_fn)0,
+	.cmp = (mcc_compare_fn)&counting_cmp,
+	.hash = (mcc_hash_fn)&counting_hash,
+};
+
+static void report(const char *name, const char *phase, size_t n)
+{
+	printf("%-8s %-7s | %10zu %10zu | %6.3f %6.3f\n", name, phase,
+	       hash_calls, cmp_calls, (double)hash_calls / n,
+	       (double)cmp_calls / n);
+	hash_calls = cmp_calls = 0;
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = max_size_from_args(argc, argv, 1000000), i;
+	char **keys = malloc(n * sizeof(char *));
+	char **misses = malloc(n * sizeof(char *));
+	struct mcc_hash_map *map = mcc_hash_map_new(&counting_str, mcc_int());
+	struct chained_map *chained = chained_map_new(&counting_str, mcc_int());
+	char buf[64];
+	void *ref;
+
+	for (i = 0; i < n; i++) {
+		snprintf(buf, sizeof(buf), "/api/v1/users/%zu/profile", i);
+		keys[i] = strdup(buf);
+		snprintf(buf, sizeof(buf), "/api/v1/users/%zu/settings", i);
+		misses[i] = strdup(buf);
+	}
+
+	puts("map      phase   |      hash()      cmp() | hash/op cmp/op");
+
+	for (i = 0; i < n; i++)
+		mcc_hash_map_insert(map, &keys[i], &(int){0});
+	report("open", "insert", n);
+	for (i = 0; i < n; i++)
+		mcc_hash_map_get(map, &keys[i], &ref);
+	report("open", "hit", n);
+	for (i = 0; i < n; i++)
+		mcc_hash_map_get(map, &misses[i], &ref);
+	report("open", "miss", n);
+
+	for (i = 0; i < n; i++)
+		chained_map_insert(chained, &keys[i], &(int){0});
+	report("chained", "insert", n);
+	for (i = 0; i < n; i++)
+		chained_map_get(chained, &keys[i]);
+	report("chained", "hit", n);
+	for (i = 0; i < n; i++)
+		chained_map_get(chained, &misses[i]);
+	report("chained", "miss", n);
+
+	chained_map_drop(chained);
+	mcc_hash_map_drop(map);
+	for (i = 0; i < n; i++) {
+		free(keys[i]);
+		free(misses[i]);
+	}
+	free(misses);
+	free(keys);
+	return 0;
+}
@@ -0,0 +1,136 @@
+#include "bench.h"
+#include "chained_hash_map.h"
+
+/*
+ * Bucket occupancy of the built-in hash functions against the identity and
+ * truncating hashes they replaced, for key patterns that share low bits. The
+ * buckets are the low bits of the hash, as in a chained table of the next
+ * power of two size. The last column is the time to insert all keys into the
+ * chained baseline map.
+ *
+ * usage: bench_hash_collisions [keys] (default 2e4)
+ */
+
+static size_t identity_hash(const unsigned long long *key)
+{
+	return *key;
+}
+
+static size_t truncating_hash(const double *key)
+{
+	return *key;
+}
+
+static const struct mcc_object_interface identity = {
+	.size = sizeof(unsigned long long),
+	.cmp = NULL,
+	.hash = (mcc_hash_fn)&identity_hash,
+};
+
+static const struct mcc_object_interface truncating = {
+	.size = sizeof(double),
+	.cmp = NULL,
+	.hash = (mcc_hash_fn)&truncating_hash,
+};
+
+struct pattern {
+	const char *name;
+	bool real;
+	void (*fill)(void *keys, size_t n);
+};
+
+static void fill_multiples(void *keys, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		((unsigned long long *)keys)[i] = i * 1024;
+}
+
+static void fill_aligned(void *keys, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		((unsigned long long *)keys)[i] = 0x7f0000000000ULL + i * 4096;
+}
+
+static void fill_high_bits(void *keys, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		((unsigned long long *)keys)[i] = (unsigned long long)i << 40;
+}
+
+static void fill_unit_interval(void *keys, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		((double *)keys)[i] = 1.0 + (double)i / n;
+}
+
+static const struct pattern patterns[] = {
+	{ "i * 1024", false, fill_multiples },
+	{ "page addresses", false, fill_aligned },
+	{ "i << 40", false, fill_high_bits },
+	{ "[1.0, 2.0)", true, fill_unit_interval },
+};
+
+static void report(const char *name, const struct mcc_object_interface *K,
+		   const struct mcc_object_interface *cmp, const void *keys,
+		   size_t n)
+{
+	struct mcc_object_interface intf = {
+		.size = K->size,
+		.cmp = cmp->cmp,
+		.hash = K->hash,
+	};
+	size_t cap = 1, i, longest = 0, used = 0, *chains;
+	struct chained_map *map;
+	double probes = 0, t;
+
+	while (cap < n)
+		cap <<= 1;
+
+	chains = calloc(cap, sizeof(size_t));
+	for (i = 0; i < n; i++)
+		chains[K->hash((const char *)keys + i * K->size) & (cap - 1)]++;
+	for (i = 0; i < cap; i++) {
+		used += chains[i] != 0;
+		probes += (double)chains[i] * (chains[i] + 1) / 2;
+		if (chains[i] > longest)
+			longest = chains[i];
+	}
+	free(chains);
+
+	map = chained_map_new(&intf, mcc_int());
+	t = now();
+	for (i = 0; i < n; i++)
+		chained_map_insert(map, (const char *)keys + i * K->size,
+				   &(int){0});
+	t = now() - t;
+	chained_map_drop(map);
+
+	printf("  %-10s %8zu %10zu %10.2f %10.3f\n", name, used, longest,
+	       probes / n, t * 1e3);
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = max_size_from_args(argc, argv, 20000), i;
+	void *keys = malloc(n * sizeof(double));
+
+	printf("%zu keys\n", n);
+	printf("  %-10s %8s %10s %10s %10s\n", "hash", "buckets", "longest",
+	       "probes", "insert ms");
+	for (i = 0; i < sizeof(patterns) / sizeof(struct pattern); i++) {
+		const struct mcc_object_interface *K =
+			patterns[i].real ? mcc_double() : mcc_ulong_long();
+
+		printf("%s\n", patterns[i].name);
+		patterns[i].fill(keys, n);
+		report("old", patterns[i].real ? &truncating : &identity, K,
+		       keys, n);
+		report("mixed", K, K, keys, n);
+		mcc_set_hash_seed(0x5eed);
+		report("seeded", K, K, keys, n);
+		mcc_set_hash_seed(0);
+	}
+
+	free(keys);
+	return 0;
+}
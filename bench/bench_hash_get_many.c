@@ -0,0 +1,59 @@
+#include "bench.h"
+#include "mcc_hash_map.h"
+
+/*
+ * Lookups of random present keys through mcc_hash_map_get_many with batches
+ * of 8 to 256 keys, against one mcc_hash_map_get per key. The default map is
+ * far larger than the last level cache, so almost every probe misses.
+ *
+ * usage: bench_hash_get_many [keys] (default 1.6e7)
+ */
+
+#define LOOKUPS (1 << 22)
+
+int main(int argc, char **argv)
+{
+	size_t n = max_size_from_args(argc, argv, 16000000), i, j, batch;
+	uint64_t state = 1, key, sum, *keys = malloc(LOOKUPS * sizeof(uint64_t));
+	struct mcc_hash_map *map;
+	void *refs[256], *ref;
+	double t, scalar;
+
+	map = mcc_hash_map_new(mcc_ulong_long(), mcc_ulong_long());
+	mcc_hash_map_reserve(map, n);
+	for (i = 0; i < n; i++) {
+		key = i;
+		mcc_hash_map_insert(map, &key, &key);
+	}
+	for (i = 0; i < LOOKUPS; i++)
+		keys[i] = next_random(&state) % n;
+
+	sum = 0;
+	t = now();
+	for (i = 0; i < LOOKUPS; i++) {
+		mcc_hash_map_get(map, &keys[i], &ref);
+		sum += *(uint64_t *)ref;
+	}
+	scalar = now() - t;
+	printf("%zu keys, %d lookups (checksum %llu)\n", n, LOOKUPS,
+	       (unsigned long long)sum);
+	printf("%8s %12s %10s\n", "batch", "ns/lookup", "speedup");
+	printf("%8s %12.2f %10s\n", "scalar", scalar / LOOKUPS * 1e9, "1.00");
+
+	for (batch = 8; batch <= 256; batch *= 2) {
+		sum = 0;
+		t = now();
+		for (i = 0; i < LOOKUPS; i += batch) {
+			mcc_hash_map_get_many(map, &keys[i], batch, refs);
+			for (j = 0; j < batch; j++)
+				sum += *(uint64_t *)refs[j];
+		}
+		t = now() - t;
+		printf("%8zu %12.2f %10.2f\n", batch, t / LOOKUPS * 1e9,
+		       scalar / t);
+	}
+
+	mcc_hash_map_drop(map);
+	free(keys);
+	return 0;
+}
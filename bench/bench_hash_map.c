@@ -0,0 +1,75 @@
+#include "bench.h"
+#include "chained_hash_map.h"
+#include "mcc_hash_map.h"
+
+/*
+ * Insert and lookup throughput of mcc_hash_map against the chained layout.
+ *
+ * usage: bench_hash_map [max_entries]    (default 1e7, up to 1e8)
+ */
+
+static void run(size_t n)
+{
+	struct mcc_hash_map *map;
+	struct chained_map *chained;
+	unsigned long long *keys = malloc(n * sizeof(*keys));
+	unsigned long long *probes = malloc(n * sizeof(*probes));
+	uint64_t state = 0x9e3779b97f4a7c15ULL;
+	double t0, t1, t2, t3, t4, t5;
+	size_t i, found = 0;
+	void *ref;
+
+	map = mcc_hash_map_new(mcc_ulong_long(), mcc_int());
+	chained = chained_map_new(mcc_ulong_long(), mcc_int());
+	for (i = 0; i < n; i++)
+		keys[i] = probes[i] = next_random(&state);
+
+	/* Look keys up in a random order, not in allocation order. */
+	for (i = n - 1; i > 0; i--) {
+		size_t j = next_random(&state) % (i + 1);
+		unsigned long long tmp = probes[i];
+		probes[i] = probes[j];
+		probes[j] = tmp;
+	}
+
+	t0 = now();
+	for (i = 0; i < n; i++)
+		mcc_hash_map_insert(map, &keys[i], &(int){0});
+	t1 = now();
+	for (i = 0; i < n; i++)
+		found += !mcc_hash_map_get(map, &probes[i], &ref);
+	t2 = now();
+	for (i = 0; i < n; i++)
+		found += !mcc_hash_map_get(map, &(unsigned long long){~keys[i]},
+					   &ref);
+	t3 = now();
+
+	for (i = 0; i < n; i++)
+		chained_map_insert(chained, &keys[i], &(int){0});
+	t4 = now();
+	for (i = 0; i < n; i++)
+		found += chained_map_get(chained, &probes[i]) != NULL;
+	t5 = now();
+
+	printf("%10zu | %8.1f %8.1f %8.1f | %8.1f %8.1f | %zu\n", n,
+	       n / (t1 - t0) * 1e-6, n / (t2 - t1) * 1e-6,
+	       n / (t3 - t2) * 1e-6, n / (t4 - t3) * 1e-6,
+	       n / (t5 - t4) * 1e-6, found);
+
+	chained_map_drop(chained);
+	mcc_hash_map_drop(map);
+	free(probes);
+	free(keys);
+}
+
+int main(int argc, char **argv)
+{
+	size_t max = max_size_from_args(argc, argv, 10000000);
+
+	puts("                 open addressing (Mops/s) |   chained (Mops/s)");
+	puts("   entries |   insert      hit     miss |   insert      hit "
+	     "| found");
+	for (size_t n = 1000; n <= max; n *= 10)
+		run(n);
+	return 0;
+}
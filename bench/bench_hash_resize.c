@@ -0,0 +1,57 @@
+#include "bench.h"
+#include "mcc_hash_map.h"
+
+/*
+ * Per-insert latency of mcc_hash_map with and without incremental resizing.
+ * Without it, the insert that crosses the load factor moves every entry.
+ *
+ * usage: bench_hash_resize [entries]    (default 1e7)
+ */
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x > y ? 1 : x == y ? 0 : -1;
+}
+
+static void run(const char *name, size_t n, bool incremental)
+{
+	struct mcc_hash_map *map;
+	double *lat = malloc(n * sizeof(double));
+	uint64_t state = 0x9e3779b97f4a7c15ULL;
+	unsigned long long key;
+	double t0, t1, total = 0;
+	size_t i;
+
+	map = mcc_hash_map_new(mcc_ulong_long(), mcc_int());
+	mcc_hash_map_incremental_resize(map, incremental);
+	for (i = 0; i < n; i++) {
+		key = next_random(&state);
+		t0 = now();
+		mcc_hash_map_insert(map, &key, &(int){0});
+		t1 = now();
+		lat[i] = (t1 - t0) * 1e6;
+		total += t1 - t0;
+	}
+
+	qsort(lat, n, sizeof(double), &cmp_double);
+	printf("%-12s | %8.2f | %8.3f %8.3f %8.3f | %10.2f\n", name, total,
+	       lat[(size_t)(n * 0.999)], lat[(size_t)(n * 0.9999)],
+	       lat[(size_t)(n * 0.99999)], lat[n - 1]);
+
+	mcc_hash_map_drop(map);
+	free(lat);
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = max_size_from_args(argc, argv, 10000000);
+
+	printf("%zu inserts, latencies in microseconds\n", n);
+	puts("mode         |  total s |    p99.9   p99.99  p99.999 "
+	     "|        max");
+	run("one-shot", n, false);
+	run("incremental", n, true);
+	return 0;
+}
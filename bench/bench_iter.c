@@ -0,0 +1,142 @@
+#include "bench.h"
+#include "mcc_btree_map.h"
+#include "mcc_hash_map.h"
+#include "mcc_vector.h"
+
+/*
+ * Cost per element of summing a container through mcc_*_iter_next, one call
+ * per element, through mcc_*_iter_next_n with a stack iterator, one call per
+ * BATCH elements, and through mcc_*_for_each, which calls back per element
+ * from inside the loop over the container.
+ *
+ * usage: bench_iter [max_elements]    (default 1e7)
+ */
+
+#define BATCH 64
+
+static volatile long sink;
+
+static int add_elem(void *elem, void *ctx)
+{
+	*(long *)ctx += *(int *)elem;
+	return 0;
+}
+
+static int add_value(struct mcc_pair *pair, void *ctx)
+{
+	*(long *)ctx += *(int *)pair->value;
+	return 0;
+}
+
+static void run_vector(size_t n)
+{
+	struct mcc_vector *v = mcc_vector_new(mcc_int());
+	struct mcc_vector_iter *iter, stack_iter;
+	void *refs[BATCH];
+	double t0, t1, t2, t3;
+	size_t i, m;
+	long sum = 0;
+	int *ref;
+
+	for (i = 0; i < n; i++)
+		mcc_vector_push(v, &(int){i});
+
+	t0 = now();
+	iter = mcc_vector_iter_new(v);
+	while (mcc_vector_iter_next(iter, (void **)&ref))
+		sum += *ref;
+	mcc_vector_iter_drop(iter);
+	t1 = now();
+	mcc_vector_iter_init(&stack_iter, v);
+	while ((m = mcc_vector_iter_next_n(&stack_iter, refs, BATCH))) {
+		for (i = 0; i < m; i++)
+			sum += *(int *)refs[i];
+	}
+	t2 = now();
+	mcc_vector_for_each(v, add_elem, &sum);
+	t3 = now();
+
+	sink = sum;
+	printf("%10zu | vector    %8.2f %8.2f %8.2f\n", n, (t1 - t0) / n * 1e9,
+	       (t2 - t1) / n * 1e9, (t3 - t2) / n * 1e9);
+	mcc_vector_drop(v);
+}
+
+static void run_hash_map(size_t n)
+{
+	struct mcc_hash_map *map = mcc_hash_map_new(mcc_int(), mcc_int());
+	struct mcc_hash_map_iter *iter, stack_iter;
+	struct mcc_pair pairs[BATCH], *pair;
+	double t0, t1, t2, t3;
+	size_t i, m;
+	long sum = 0;
+
+	for (i = 0; i < n; i++)
+		mcc_hash_map_insert(map, &(int){i}, &(int){i});
+
+	t0 = now();
+	iter = mcc_hash_map_iter_new(map);
+	while (mcc_hash_map_iter_next(iter, &pair))
+		sum += *(int *)pair->value;
+	mcc_hash_map_iter_drop(iter);
+	t1 = now();
+	mcc_hash_map_iter_init(&stack_iter, map);
+	while ((m = mcc_hash_map_iter_next_n(&stack_iter, pairs, BATCH))) {
+		for (i = 0; i < m; i++)
+			sum += *(int *)pairs[i].value;
+	}
+	t2 = now();
+	mcc_hash_map_for_each(map, add_value, &sum);
+	t3 = now();
+
+	sink = sum;
+	printf("%10zu | hash_map  %8.2f %8.2f %8.2f\n", n, (t1 - t0) / n * 1e9,
+	       (t2 - t1) / n * 1e9, (t3 - t2) / n * 1e9);
+	mcc_hash_map_drop(map);
+}
+
+static void run_btree_map(size_t n)
+{
+	struct mcc_btree_map *map = mcc_btree_map_new(mcc_int(), mcc_int());
+	struct mcc_btree_map_iter *iter, stack_iter;
+	struct mcc_pair pairs[BATCH], *pair;
+	double t0, t1, t2, t3;
+	size_t i, m;
+	long sum = 0;
+
+	for (i = 0; i < n; i++)
+		mcc_btree_map_insert(map, &(int){i}, &(int){i});
+
+	t0 = now();
+	iter = mcc_btree_map_iter_new(map);
+	while (mcc_btree_map_iter_next(iter, &pair))
+		sum += *(int *)pair->value;
+	mcc_btree_map_iter_drop(iter);
+	t1 = now();
+	mcc_btree_map_iter_init(&stack_iter, map);
+	while ((m = mcc_btree_map_iter_next_n(&stack_iter, pairs, BATCH))) {
+		for (i = 0; i < m; i++)
+			sum += *(int *)pairs[i].value;
+	}
+	t2 = now();
+	mcc_btree_map_for_each(map, add_value, &sum);
+	t3 = now();
+
+	sink = sum;
+	printf("%10zu | btree_map %8.2f %8.2f %8.2f\n", n, (t1 - t0) / n * 1e9,
+	       (t2 - t1) / n * 1e9, (t3 - t2) / n * 1e9);
+	mcc_btree_map_drop(map);
+}
+
+int main(int argc, char **argv)
+{
+	size_t max = max_size_from_args(argc, argv, 10000000);
+
+	puts("  elements | container     next   next_n for_each (ns/element)");
+	for (size_t n = 1000; n <= max; n *= 10) {
+		run_vector(n);
+		run_hash_map(n);
+		run_btree_map(n);
+	}
+	return 0;
+}
@@ -0,0 +1,46 @@
+#include "bench.h"
+#include "mcc_map.h"
+
+/*
+ * Rebuilding a mcc_map from a sorted snapshot of 64-bit keys: n calls to
+ * mcc_map_insert against one call to mcc_map_from_sorted.
+ *
+ * usage: bench_map_from_sorted [keys]    (default 1e6)
+ */
+
+int main(int argc, char **argv)
+{
+	size_t n = max_size_from_args(argc, argv, 1000000), i;
+	uint64_t *keys = malloc(n * sizeof(uint64_t));
+	uint64_t *values = malloc(n * sizeof(uint64_t));
+	uint64_t state = 0x9e3779b97f4a7c15ULL, key = 0;
+	struct mcc_map *map;
+	double t[2];
+
+	for (i = 0; i < n; i++) {
+		key += next_random(&state) % 64 + 1;
+		keys[i] = key;
+		values[i] = i;
+	}
+
+	t[0] = now();
+	map = mcc_map_new(mcc_ulong_long(), mcc_ulong_long());
+	for (i = 0; i < n; i++)
+		mcc_map_insert(map, &keys[i], &values[i]);
+	t[0] = now() - t[0];
+	mcc_map_drop(map);
+
+	t[1] = now();
+	map = mcc_map_from_sorted(mcc_ulong_long(), mcc_ulong_long(), keys,
+				  values, n);
+	t[1] = now() - t[1];
+	mcc_map_drop(map);
+
+	printf("%zu keys\n", n);
+	printf("insert:      %8.2f ms\n", t[0] * 1e3);
+	printf("from_sorted: %8.2f ms\n", t[1] * 1e3);
+
+	free(keys);
+	free(values);
+	return 0;
+}
@@ -0,0 +1,86 @@
+#include "../src/alloc.h"
+#include "../src/node_pool.h"
+#include "bench.h"
+#include "mcc_list.h"
+#include "mcc_map.h"
+
+/*
+ * Insert/remove churn on containers that keep a steady size, which is where
+ * the node pool replaces a malloc/free pair per operation by two free list
+ * operations. The last rows compare the pool with malloc directly, freeing
+ * and reallocating random nodes among n live ones of a map node's size.
+ *
+ * usage: bench_node_pool [live nodes] (default 1e5)
+ */
+
+#define OPS 4000000
+#define NODE_SIZE 64
+
+int main(int argc, char **argv)
+{
+	size_t n = max_size_from_args(argc, argv, 100000), i, j;
+	uint64_t state = 1, key, *keys = malloc(n * sizeof(uint64_t));
+	void **live = malloc(n * sizeof(void *));
+	struct node_pool pool;
+	struct mcc_list *list;
+	struct mcc_map *map;
+	double t;
+
+	printf("%zu live nodes, %d operations, Mops/s\n", n, OPS);
+
+	list = mcc_list_new(mcc_ulong_long());
+	for (i = 0; i < n; i++)
+		mcc_list_push_back(list, &i);
+	t = now();
+	for (i = 0; i < OPS; i++) {
+		mcc_list_pop_front(list);
+		mcc_list_push_back(list, &i);
+	}
+	printf("%-24s %8.2f\n", "mcc_list queue", OPS / (now() - t) / 1e6);
+	mcc_list_drop(list);
+
+	map = mcc_map_new(mcc_ulong_long(), mcc_ulong_long());
+	for (i = 0; i < n; i++) {
+		keys[i] = next_random(&state);
+		mcc_map_insert(map, &keys[i], &i);
+	}
+	t = now();
+	for (i = 0; i < OPS; i++) {
+		j = next_random(&state) % n;
+		mcc_map_remove(map, &keys[j]);
+		key = keys[j] = next_random(&state);
+		mcc_map_insert(map, &key, &i);
+	}
+	printf("%-24s %8.2f\n", "mcc_map remove+insert", OPS / (now() - t) / 1e6);
+	mcc_map_drop(map);
+
+	for (i = 0; i < n; i++)
+		live[i] = malloc(NODE_SIZE);
+	t = now();
+	for (i = 0; i < OPS; i++) {
+		j = next_random(&state) % n;
+		free(live[j]);
+		live[j] = malloc(NODE_SIZE);
+	}
+	printf("%-24s %8.2f\n", "malloc free+alloc", OPS / (now() - t) / 1e6);
+	for (i = 0; i < n; i++)
+		free(live[i]);
+
+	node_pool_init(&pool, NODE_SIZE, &default_allocator);
+	for (i = 0; i < n; i++)
+		live[i] = node_pool_alloc(&pool);
+	t = now();
+	for (i = 0; i < OPS; i++) {
+		j = next_random(&state) % n;
+		node_pool_free(&pool, live[j]);
+		live[j] = node_pool_alloc(&pool);
+	}
+	printf("%-24s %8.2f\n", "node_pool free+alloc", OPS / (now() - t) / 1e6);
+	for (i = 0; i < n; i++)
+		node_pool_free(&pool, live[i]);
+	node_pool_release(&pool);
+
+	free(live);
+	free(keys);
+	return 0;
+}
@@ -0,0 +1,74 @@
+#include "bench.h"
+#include "mcc_vector.h"
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Scaling of mcc_vector_par_sort over 1 to N threads on 16-byte records
+ * ordered by a 64-bit key, against mcc_vector_sort on the calling thread.
+ *
+ * usage: bench_par_sort [elements] [max threads]
+ *        (default 1e7, number of online CPUs)
+ */
+
+struct record {
+	uint64_t key;
+	uint64_t payload;
+};
+
+static int record_cmp(const struct record *self, const struct record *other)
+{
+	return self->key > other->key ? 1 : self->key == other->key ? 0 : -1;
+}
+
+static const struct mcc_object_interface record_ = {
+	.size = sizeof(struct record),
+	.cmp = (mcc_compare_fn)&record_cmp,
+};
+
+static double time_sort(const struct record *records, size_t n,
+			size_t nthreads)
+{
+	struct mcc_vector *vec = mcc_vector_new(&record_);
+	double t;
+
+	mcc_vector_push_many(vec, records, n);
+	t = now();
+	if (nthreads)
+		mcc_vector_par_sort(vec, nthreads);
+	else
+		mcc_vector_sort(vec);
+	t = now() - t;
+	mcc_vector_drop(vec);
+	return t;
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = max_size_from_args(argc, argv, 10000000), i, t;
+	size_t max_threads = argc > 2 ? strtoul(argv[2], NULL, 10)
+				      : (size_t)sysconf(_SC_NPROCESSORS_ONLN);
+	struct record *records = malloc(n * sizeof(struct record));
+	uint64_t state = 0x9e3779b97f4a7c15ULL;
+	double base;
+
+	for (i = 0; i < n; i++) {
+		records[i].key = next_random(&state);
+		records[i].payload = i;
+	}
+
+	base = time_sort(records, n, 0);
+	printf("%zu records, milliseconds\n", n);
+	puts("threads |     time  speedup");
+	printf("sort    | %8.1f %7.2fx\n", base * 1e3, 1.0);
+	/* Powers of two, then max_threads itself. */
+	for (t = 1; t <= max_threads;
+	     t = t < max_threads && t * 2 > max_threads ? max_threads : t * 2) {
+		double d = time_sort(records, n, t);
+
+		printf("%7zu | %8.1f %7.2fx\n", t, d * 1e3, base / d);
+	}
+
+	free(records);
+	return 0;
+}
@@ -0,0 +1,53 @@
+#include "bench.h"
+#include "mcc_priority_queue.h"
+
+/*
+ * Cost per element of loading and draining mcc_priority_queue. Pushing one
+ * element at a time should grow with log n, mcc_priority_queue_push_many()
+ * into an empty queue should stay flat.
+ *
+ * usage: bench_priority_queue [max_elements]    (default 1e7)
+ */
+
+static void run(size_t n)
+{
+	struct mcc_priority_queue *q = mcc_priority_queue_new(mcc_int());
+	int *values = malloc(n * sizeof(int));
+	uint64_t state = 0x9e3779b97f4a7c15ULL;
+	double t0, t1, t2, t3;
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		values[i] = next_random(&state);
+
+	t0 = now();
+	for (i = 0; i < n; i++)
+		mcc_priority_queue_push(q, &values[i]);
+	t1 = now();
+	mcc_priority_queue_clear(q);
+	t2 = now();
+	mcc_priority_queue_push_many(q, values, n);
+	t3 = now();
+
+	printf("%10zu | %8.1f %8.1f |", n, (t1 - t0) / n * 1e9,
+	       (t3 - t2) / n * 1e9);
+
+	t0 = now();
+	while (!mcc_priority_queue_is_empty(q))
+		mcc_priority_queue_pop(q);
+	t1 = now();
+	printf(" %8.1f\n", (t1 - t0) / n * 1e9);
+
+	mcc_priority_queue_drop(q);
+	free(values);
+}
+
+int main(int argc, char **argv)
+{
+	size_t max = max_size_from_args(argc, argv, 10000000);
+
+	puts("  elements |     push push_many |      pop   (ns/element)");
+	for (size_t n = 1000; n <= max; n *= 10)
+		run(n);
+	return 0;
+}
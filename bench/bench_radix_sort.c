@@ -0,0 +1,83 @@
+#include "bench.h"
+#include "mcc_vector.h"
+#include <string.h>
+
+/*
+ * Sort times of 64-bit ids, ints and doubles: libc qsort, the comparison sort
+ * of mcc_vector_sort (forced through a copy of the built-in interface) and
+ * the radix sort mcc_vector_sort picks for the built-in interfaces.
+ *
+ * usage: bench_radix_sort [elements]    (default 1e7)
+ */
+
+static double time_qsort(const void *values, size_t n,
+			 const struct mcc_object_interface *T)
+{
+	void *copy = malloc(n * T->size);
+	double t;
+
+	memcpy(copy, values, n * T->size);
+	t = now();
+	qsort(copy, n, T->size, T->cmp);
+	t = now() - t;
+	free(copy);
+	return t;
+}
+
+static double time_vector(const void *values, size_t n,
+			  const struct mcc_object_interface *T)
+{
+	struct mcc_vector *vec = mcc_vector_new(T);
+	double t;
+
+	mcc_vector_push_many(vec, values, n);
+	t = now();
+	mcc_vector_sort(vec);
+	t = now() - t;
+	mcc_vector_drop(vec);
+	return t;
+}
+
+static void run(const char *name, const void *values, size_t n,
+		const struct mcc_object_interface *T)
+{
+	/* Same behaviour, different address: not recognized as built-in. */
+	struct mcc_object_interface custom = {
+		.size = T->size,
+		.drop = T->drop,
+		.cmp = T->cmp,
+		.hash = T->hash,
+	};
+	double q = time_qsort(values, n, T);
+	double c = time_vector(values, n, &custom);
+	double r = time_vector(values, n, T);
+
+	printf("%-9s | %8.1f %8.1f %8.1f %7.1fx\n", name, q * 1e3, c * 1e3,
+	       r * 1e3, c / r);
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = max_size_from_args(argc, argv, 10000000), i;
+	uint64_t *ids = malloc(n * sizeof(uint64_t));
+	int *ints = malloc(n * sizeof(int));
+	double *doubles = malloc(n * sizeof(double));
+	uint64_t state = 0x9e3779b97f4a7c15ULL;
+
+	for (i = 0; i < n; i++) {
+		ids[i] = next_random(&state);
+		ints[i] = (int)next_random(&state);
+		doubles[i] = (double)(int64_t)next_random(&state) / 1e9;
+	}
+
+	printf("%zu elements, milliseconds\n", n);
+	puts("type      |    qsort      pdq    radix speedup");
+	run("uint64", ids, n, mcc_ulong_long());
+	run("int", ints, n, mcc_int());
+	run("double", doubles, n, mcc_double());
+
+	free(ids);
+	free(ints);
+	free(doubles);
+	return 0;
+}
@@ -0,0 +1,147 @@
+#include "bench.h"
+#include "mcc_concurrent_hash_map.h"
+#include "mcc_rcu_hash_map.h"
+#include <pthread.h>
+#include <unistd.h>
+
+/*
+ * Lookup throughput of mcc_rcu_hash_map against mcc_concurrent_hash_map for
+ * 1 to N reader threads, while one more thread replaces a random value about
+ * every 100 microseconds.
+ *
+ * usage: bench_rcu_hash_map [keys] [max threads]
+ *        (default 1e5, number of online CPUs)
+ */
+
+#define OPS_PER_THREAD 1000000
+
+struct shared {
+	void *map;
+	int (*get)(void *map, const void *key, void *value);
+	int (*insert)(void *map, const void *key, const void *value);
+	uint64_t range;
+	int done;
+};
+
+struct worker {
+	pthread_t thread;
+	struct shared *shared;
+	uint64_t seed;
+};
+
+static int rcu_get(void *map, const void *key, void *value)
+{
+	return mcc_rcu_hash_map_get(map, key, value);
+}
+
+static int rcu_insert(void *map, const void *key, const void *value)
+{
+	return mcc_rcu_hash_map_insert(map, key, value);
+}
+
+static int sharded_get(void *map, const void *key, void *value)
+{
+	return mcc_concurrent_hash_map_get(map, key, value);
+}
+
+static int sharded_insert(void *map, const void *key, const void *value)
+{
+	return mcc_concurrent_hash_map_insert(map, key, value);
+}
+
+static void *run_reader(void *arg)
+{
+	struct worker *w = arg;
+	struct shared *s = w->shared;
+	uint64_t key, value;
+	size_t i;
+
+	for (i = 0; i < OPS_PER_THREAD; i++) {
+		key = next_random(&w->seed) % s->range;
+		s->get(s->map, &key, &value);
+	}
+	return NULL;
+}
+
+static void *run_writer(void *arg)
+{
+	struct worker *w = arg;
+	struct shared *s = w->shared;
+	uint64_t key;
+
+	while (!__atomic_load_n(&s->done, __ATOMIC_ACQUIRE)) {
+		key = next_random(&w->seed) % s->range;
+		s->insert(s->map, &key, &key);
+		usleep(100);
+	}
+	return NULL;
+}
+
+static double run(struct shared *s, size_t nthreads)
+{
+	struct worker *workers = calloc(nthreads + 1, sizeof(struct worker));
+	double t;
+	size_t i;
+
+	s->done = 0;
+	workers[nthreads].shared = s;
+	workers[nthreads].seed = 1;
+	pthread_create(&workers[nthreads].thread, NULL, run_writer,
+		       &workers[nthreads]);
+
+	t = now();
+	for (i = 0; i < nthreads; i++) {
+		workers[i].shared = s;
+		workers[i].seed = 0x9e3779b97f4a7c15ULL * (i + 1);
+		pthread_create(&workers[i].thread, NULL, run_reader,
+			       &workers[i]);
+	}
+	for (i = 0; i < nthreads; i++)
+		pthread_join(workers[i].thread, NULL);
+	t = now() - t;
+
+	__atomic_store_n(&s->done, 1, __ATOMIC_RELEASE);
+	pthread_join(workers[nthreads].thread, NULL);
+	free(workers);
+	return nthreads * OPS_PER_THREAD / t / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = max_size_from_args(argc, argv, 100000), i, nthreads;
+	size_t max_threads = argc > 2 ? strtoul(argv[2], NULL, 10) :
+					(size_t)sysconf(_SC_NPROCESSORS_ONLN);
+	struct mcc_rcu_hash_map *rcu;
+	struct mcc_concurrent_hash_map *sharded;
+	struct shared s = { .range = n };
+	double rcu_mops;
+	uint64_t key;
+
+	rcu = mcc_rcu_hash_map_new(mcc_ulong_long(), mcc_ulong_long());
+	sharded = mcc_concurrent_hash_map_new(mcc_ulong_long(),
+					      mcc_ulong_long());
+	for (i = 0; i < n; i++) {
+		key = i;
+		mcc_rcu_hash_map_insert(rcu, &key, &key);
+		mcc_concurrent_hash_map_insert(sharded, &key, &key);
+	}
+
+	printf("%zu keys, lookups in Mops/s\n", n);
+	printf("%8s %12s %12s\n", "threads", "rcu", "sharded");
+	for (nthreads = 1; nthreads <= max_threads; nthreads *= 2) {
+		s.map = rcu;
+		s.get = rcu_get;
+		s.insert = rcu_insert;
+		rcu_mops = run(&s, nthreads);
+
+		s.map = sharded;
+		s.get = sharded_get;
+		s.insert = sharded_insert;
+		printf("%8zu %12.2f %12.2f\n", nthreads, rcu_mops,
+		       run(&s, nthreads));
+	}
+
+	mcc_rcu_hash_map_drop(rcu);
+	mcc_concurrent_hash_map_drop(sharded);
+	return 0;
+}
@@ -0,0 +1,62 @@
+#include "bench.h"
+#include "mcc_set.h"
+
+/*
+ * Merging smaller mcc_sets into a large one: inserting every element of the
+ * small set one by one against the join-based mcc_set_union.
+ *
+ * usage: bench_set_ops [keys] [threads]    (default 1e6, 1)
+ */
+
+static uint64_t *random_sorted(size_t n, uint64_t *state, uint64_t step)
+{
+	uint64_t *keys = malloc(n * sizeof(uint64_t)), key = 0;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		key += next_random(state) % step + 1;
+		keys[i] = key;
+	}
+	return keys;
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = max_size_from_args(argc, argv, 1000000), m, i, len;
+	size_t nthreads = argc > 2 ? strtoul(argv[2], NULL, 10) : 1;
+	uint64_t state = 0x9e3779b97f4a7c15ULL, *large_keys, *small_keys;
+	struct mcc_set *large, *small;
+	double t[2];
+
+	large_keys = random_sorted(n, &state, 16);
+	printf("%zu keys in the large set\n", n);
+	printf("%10s %12s %12s\n", "small", "insert (ms)", "union (ms)");
+	for (m = n / 1000; m <= n; m *= 10) {
+		small_keys = random_sorted(m, &state, 16 * n / m);
+		large = mcc_set_from_sorted(mcc_ulong_long(), large_keys, n);
+		small = mcc_set_from_sorted(mcc_ulong_long(), small_keys, m);
+
+		t[0] = now();
+		for (i = 0; i < m; i++)
+			mcc_set_insert(large, &small_keys[i]);
+		t[0] = now() - t[0];
+		len = mcc_set_len(large);
+		mcc_set_drop(large);
+
+		large = mcc_set_from_sorted(mcc_ulong_long(), large_keys, n);
+		mcc_set_parallelism(large, nthreads);
+		t[1] = now();
+		mcc_set_union(large, small);
+		t[1] = now() - t[1];
+		if (mcc_set_len(large) != len)
+			printf("mismatch: %zu != %zu\n", mcc_set_len(large), len);
+
+		printf("%10zu %12.2f %12.2f\n", m, t[0] * 1e3, t[1] * 1e3);
+		mcc_set_drop(large);
+		mcc_set_drop(small);
+		free(small_keys);
+	}
+
+	free(large_keys);
+	return 0;
+}
@@ -0,0 +1,132 @@
+#include "bench.h"
+#include "mcc_map.h"
+#include "mcc_skiplist_map.h"
+#include <pthread.h>
+#include <unistd.h>
+
+/*
+ * Throughput of mcc_skiplist_map against a mcc_map behind one mutex, for 1 to
+ * N threads and 50%, 90% and 99% lookups. The rest of the operations are
+ * split evenly between inserts and removes of random 64-bit keys from a range
+ * of twice the initial size.
+ *
+ * usage: bench_skiplist_map [keys] [max threads]
+ *        (default 1e5, number of online CPUs)
+ */
+
+#define OPS_PER_THREAD 200000
+
+struct shared {
+	struct mcc_skiplist_map *skiplist;
+	struct mcc_map *map;
+	pthread_mutex_t lock;
+	uint64_t range;
+	unsigned read_percent;
+};
+
+struct worker {
+	pthread_t thread;
+	struct shared *shared;
+	uint64_t seed;
+};
+
+static void *run_skiplist(void *arg)
+{
+	struct worker *w = arg;
+	struct shared *s = w->shared;
+	uint64_t key, value, r;
+	size_t i;
+
+	for (i = 0; i < OPS_PER_THREAD; i++) {
+		r = next_random(&w->seed);
+		key = r % s->range;
+		r = (r >> 32) % 100;
+		if (r < s->read_percent)
+			mcc_skiplist_map_get(s->skiplist, &key, &value);
+		else if (r & 1)
+			mcc_skiplist_map_insert(s->skiplist, &key, &key);
+		else
+			mcc_skiplist_map_remove(s->skiplist, &key);
+	}
+	return NULL;
+}
+
+static void *run_map(void *arg)
+{
+	struct worker *w = arg;
+	struct shared *s = w->shared;
+	uint64_t key, *value, r;
+	size_t i;
+
+	for (i = 0; i < OPS_PER_THREAD; i++) {
+		r = next_random(&w->seed);
+		key = r % s->range;
+		r = (r >> 32) % 100;
+		pthread_mutex_lock(&s->lock);
+		if (r < s->read_percent)
+			mcc_map_get(s->map, &key, (void **)&value);
+		else if (r & 1)
+			mcc_map_insert(s->map, &key, &key);
+		else
+			mcc_map_remove(s->map, &key);
+		pthread_mutex_unlock(&s->lock);
+	}
+	return NULL;
+}
+
+static double run(struct shared *s, size_t nthreads, void *(*fn)(void *))
+{
+	struct worker *workers = calloc(nthreads, sizeof(struct worker));
+	double t;
+	size_t i;
+
+	t = now();
+	for (i = 0; i < nthreads; i++) {
+		workers[i].shared = s;
+		workers[i].seed = 0x9e3779b97f4a7c15ULL * (i + 1);
+		pthread_create(&workers[i].thread, NULL, fn, &workers[i]);
+	}
+	for (i = 0; i < nthreads; i++)
+		pthread_join(workers[i].thread, NULL);
+	t = now() - t;
+
+	free(workers);
+	return nthreads * OPS_PER_THREAD / t / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+	static const unsigned read_percents[] = { 50, 90, 99 };
+	size_t n = max_size_from_args(argc, argv, 100000), i, j, nthreads;
+	size_t max_threads = argc > 2 ? strtoul(argv[2], NULL, 10) :
+					(size_t)sysconf(_SC_NPROCESSORS_ONLN);
+	uint64_t state = 1, key;
+	struct shared s;
+
+	s.range = 2 * n;
+	pthread_mutex_init(&s.lock, NULL);
+	printf("%zu keys, Mops/s\n", n);
+	printf("%8s %8s %12s %12s\n", "reads", "threads", "skiplist", "mutex+map");
+	for (i = 0; i < sizeof(read_percents) / sizeof(unsigned); i++) {
+		s.read_percent = read_percents[i];
+		for (nthreads = 1; nthreads <= max_threads; nthreads *= 2) {
+			s.skiplist = mcc_skiplist_map_new(mcc_ulong_long(),
+							  mcc_ulong_long());
+			s.map = mcc_map_new(mcc_ulong_long(), mcc_ulong_long());
+			for (j = 0; j < n; j++) {
+				key = next_random(&state) % s.range;
+				mcc_skiplist_map_insert(s.skiplist, &key, &key);
+				mcc_map_insert(s.map, &key, &key);
+			}
+
+			printf("%7u%% %8zu %12.2f %12.2f\n", s.read_percent,
+			       nthreads, run(&s, nthreads, run_skiplist),
+			       run(&s, nthreads, run_map));
+			mcc_skiplist_map_drop(s.skiplist);
+			mcc_map_drop(s.map);
+		}
+	}
+
+	pthread_mutex_destroy(&s.lock);
+	return 0;
+}
@@ -0,0 +1,84 @@
+#include "bench.h"
+#include "mcc_deque.h"
+#include "mcc_vector.h"
+#include <string.h>
+
+/*
+ * Sort times of libc qsort, mcc_vector_sort and mcc_deque_sort on a deque
+ * whose ring buffer wraps around, for several input patterns.
+ *
+ * usage: bench_sort [elements]    (default 1e6)
+ */
+
+enum { RANDOM, SORTED, REVERSED, FEW_UNIQUE, ORGAN_PIPE, SORTED_TAIL };
+
+static const char *names[] = {
+	"random",     "sorted",     "reversed",
+	"few unique", "organ pipe", "sorted+tail",
+};
+
+static int generate(int pattern, size_t i, size_t n, uint64_t *state)
+{
+	switch (pattern) {
+	case SORTED:
+		return i;
+	case REVERSED:
+		return n - i;
+	case FEW_UNIQUE:
+		return next_random(state) % 16;
+	case ORGAN_PIPE:
+		return i < n / 2 ? i : n - i;
+	case SORTED_TAIL:
+		return i < n - n / 100 ? (int)i : (int)(next_random(state) % n);
+	default:
+		return next_random(state);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = max_size_from_args(argc, argv, 1000000), i;
+	int *values = malloc(n * sizeof(int));
+	int *copy = malloc(n * sizeof(int));
+	uint64_t state = 0x9e3779b97f4a7c15ULL;
+	struct mcc_vector *vec;
+	struct mcc_deque *deque;
+	double t0, t1, t2, t3;
+
+	printf("%zu ints, milliseconds\n", n);
+	puts("pattern      |    qsort   vector    deque");
+	for (int p = RANDOM; p <= SORTED_TAIL; p++) {
+		for (i = 0; i < n; i++)
+			values[i] = generate(p, i, n, &state);
+
+		vec = mcc_vector_new(mcc_int());
+		mcc_vector_push_many(vec, values, n);
+		deque = mcc_deque_new(mcc_int());
+		mcc_deque_reserve(deque, n);
+		/* Start in the middle of the buffer so that it wraps around. */
+		for (i = 0; i < n / 2; i++)
+			mcc_deque_push_back(deque, &(int){0});
+		for (i = 0; i < n / 2; i++)
+			mcc_deque_pop_front(deque);
+		for (i = 0; i < n; i++)
+			mcc_deque_push_back(deque, &values[i]);
+		memcpy(copy, values, n * sizeof(int));
+
+		t0 = now();
+		qsort(copy, n, sizeof(int), (__compar_fn_t)mcc_int()->cmp);
+		t1 = now();
+		mcc_vector_sort(vec);
+		t2 = now();
+		mcc_deque_sort(deque);
+		t3 = now();
+
+		printf("%-12s | %8.1f %8.1f %8.1f\n", names[p], (t1 - t0) * 1e3,
+		       (t2 - t1) * 1e3, (t3 - t2) * 1e3);
+		mcc_deque_drop(deque);
+		mcc_vector_drop(vec);
+	}
+
+	free(copy);
+	free(values);
+	return 0;
+}
@@ -0,0 +1,94 @@
+#include "bench.h"
+#include "mcc_list.h"
+#include "mcc_vector.h"
+#include <string.h>
+
+/*
+ * Sort times of log-like records keyed by a timestamp: libc qsort,
+ * mcc_vector_sort, mcc_vector_stable_sort and mcc_list_sort, on random input
+ * and on append-mostly input whose last 1% arrives out of order.
+ *
+ * usage: bench_stable_sort [elements]    (default 1e6)
+ */
+
+struct record {
+	uint64_t timestamp;
+	uint64_t payload;
+};
+
+static int record_cmp(const struct record *self, const struct record *other)
+{
+	if (self->timestamp != other->timestamp)
+		return self->timestamp > other->timestamp ? 1 : -1;
+	return 0;
+}
+
+static const struct mcc_object_interface record_ = {
+	.size = sizeof(struct record),
+	.cmp = (mcc_compare_fn)&record_cmp,
+};
+
+static void run(const char *name, struct record *records, size_t n)
+{
+	struct record *copy = malloc(n * sizeof(struct record));
+	struct mcc_vector *vec;
+	struct mcc_list *list;
+	double t[4];
+	size_t i;
+
+	memcpy(copy, records, n * sizeof(struct record));
+	t[0] = now();
+	qsort(copy, n, sizeof(struct record),
+	      (int (*)(const void *, const void *))record_.cmp);
+	t[0] = now() - t[0];
+
+	vec = mcc_vector_new(&record_);
+	mcc_vector_push_many(vec, records, n);
+	t[1] = now();
+	mcc_vector_sort(vec);
+	t[1] = now() - t[1];
+	mcc_vector_clear(vec);
+	mcc_vector_push_many(vec, records, n);
+	t[2] = now();
+	mcc_vector_stable_sort(vec);
+	t[2] = now() - t[2];
+	mcc_vector_drop(vec);
+
+	list = mcc_list_new(&record_);
+	for (i = 0; i < n; i++)
+		mcc_list_push_back(list, &records[i]);
+	t[3] = now();
+	mcc_list_sort(list);
+	t[3] = now() - t[3];
+	mcc_list_drop(list);
+
+	printf("%-13s | %8.1f %8.1f %8.1f %8.1f\n", name, t[0] * 1e3,
+	       t[1] * 1e3, t[2] * 1e3, t[3] * 1e3);
+	free(copy);
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = max_size_from_args(argc, argv, 1000000), i;
+	struct record *records = malloc(n * sizeof(struct record));
+	uint64_t state = 0x9e3779b97f4a7c15ULL;
+
+	printf("%zu records, milliseconds\n", n);
+	puts("input         |    qsort     sort   stable     list");
+
+	for (i = 0; i < n; i++) {
+		records[i].timestamp = next_random(&state) % n;
+		records[i].payload = i;
+	}
+	run("random", records, n);
+
+	for (i = 0; i < n; i++) {
+		records[i].timestamp =
+			i < n - n / 100 ? i : next_random(&state) % n;
+		records[i].payload = i;
+	}
+	run("append-mostly", records, n);
+
+	free(records);
+	return 0;
+}
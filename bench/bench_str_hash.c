@@ -0,0 +1,70 @@
+#include "bench.h"
+#include "mcc_object.h"
+#include <string.h>
+
+/*
+ * Throughput of the mcc_str hash against the byte at a time h * 31 + c loop
+ * it replaced, for keys of 4 to 1024 bytes. The keys stay in the cache, so
+ * this measures the hash and not the memory.
+ *
+ * usage: bench_str_hash [bytes per length] (default 2.5e8)
+ */
+
+#define NKEYS 256
+
+static size_t old_str_hash(const mcc_str_t *key)
+{
+	const char *c = *key;
+	size_t h = 0;
+
+	while (*c)
+		h = h * 31 + *c++;
+
+	return h;
+}
+
+static double gbps(size_t (*hash)(const mcc_str_t *), mcc_str_t *keys,
+		   size_t len, size_t total)
+{
+	size_t rounds = total / (len * NKEYS) + 1, i, j, sum = 0;
+	volatile size_t sink;
+	double t = now();
+
+	for (i = 0; i < rounds; i++) {
+		for (j = 0; j < NKEYS; j++)
+			sum += hash(&keys[j]);
+	}
+	t = now() - t;
+	sink = sum;
+	(void)sink;
+	return rounds * NKEYS * len / t / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	size_t total = max_size_from_args(argc, argv, 250000000), len, i, j;
+	size_t (*hash)(const mcc_str_t *) =
+		(size_t (*)(const mcc_str_t *))mcc_str()->hash;
+	mcc_str_t keys[NKEYS];
+	uint64_t state = 1;
+	char *buf;
+
+	printf("%8s %12s %12s\n", "bytes", "mcc_str", "h * 31 + c");
+	for (len = 4; len <= 1024; len *= 2) {
+		/* Odd offsets, so that most keys start unaligned. */
+		buf = malloc(NKEYS * (len + 3));
+		for (i = 0; i < NKEYS; i++) {
+			char *key = buf + i * (len + 3) + (i & 1);
+
+			for (j = 0; j < len; j++)
+				key[j] = 'a' + next_random(&state) % 26;
+			key[len] = '\0';
+			keys[i] = key;
+		}
+
+		printf("%8zu %12.2f %12.2f\n", len, gbps(hash, keys, len, total),
+		       gbps(old_str_hash, keys, len, total));
+		free(buf);
+	}
+	return 0;
+}
@@ -0,0 +1,118 @@
+#ifndef _CHAINED_HASH_MAP_H
+#define _CHAINED_HASH_MAP_H
+
+/*
+ * The separate chaining layout that mcc_hash_map used before the open
+ * addressing engine, kept as a baseline for the benchmarks.
+ */
+
+#include "mcc_object.h"
+#include "mcc_utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct chained_entry {
+	struct chained_entry *next;
+	struct mcc_pair pair;
+};
+
+struct chained_map {
+	const struct mcc_object_interface *K;
+	const struct mcc_object_interface *V;
+	struct chained_entry **bkts;
+	size_t len;
+	size_t cap;
+};
+
+static inline struct chained_map *
+chained_map_new(const struct mcc_object_interface *K,
+		const struct mcc_object_interface *V)
+{
+	struct chained_map *self = calloc(1, sizeof(struct chained_map));
+
+	self->bkts = calloc(8, sizeof(struct chained_entry *));
+	self->cap = 8;
+	self->K = K;
+	self->V = V;
+	return self;
+}
+
+static inline struct chained_entry **chained_map_find(struct chained_map *self,
+						      const void *key)
+{
+	size_t h = self->K->hash(key) & (self->cap - 1);
+	struct chained_entry **entry = &self->bkts[h];
+
+	while (*entry) {
+		if (!self->K->cmp(key, (*entry)->pair.key))
+			break;
+		entry = &((*entry)->next);
+	}
+	return entry;
+}
+
+static inline void chained_map_grow(struct chained_map *self)
+{
+	size_t new_cap = self->cap << 1, i, h;
+	struct chained_entry **bkts, *curr, *next;
+
+	bkts = calloc(new_cap, sizeof(struct chained_entry *));
+	for (i = 0; i < self->cap; i++) {
+		for (curr = self->bkts[i]; curr; curr = next) {
+			next = curr->next;
+			h = self->K->hash(curr->pair.key) & (new_cap - 1);
+			curr->next = bkts[h];
+			bkts[h] = curr;
+		}
+	}
+	free(self->bkts);
+	self->bkts = bkts;
+	self->cap = new_cap;
+}
+
+static inline void chained_map_insert(struct chained_map *self,
+				      const void *key, const void *value)
+{
+	struct chained_entry **entry = chained_map_find(self, key);
+	uint8_t *ptr;
+
+	if (*entry) {
+		memcpy((*entry)->pair.value, value, self->V->size);
+		return;
+	}
+
+	*entry = calloc(1, sizeof(struct chained_entry) + self->K->size +
+				   self->V->size);
+	ptr = (uint8_t *)*entry + sizeof(struct chained_entry);
+	memcpy(ptr, key, self->K->size);
+	(*entry)->pair.key = ptr;
+	ptr += self->K->size;
+	memcpy(ptr, value, self->V->size);
+	(*entry)->pair.value = ptr;
+
+	if (++self->len >= (self->cap * 3) >> 2)
+		chained_map_grow(self);
+}
+
+static inline void *chained_map_get(struct chained_map *self, const void *key)
+{
+	struct chained_entry **entry = chained_map_find(self, key);
+
+	return *entry ? (*entry)->pair.value : NULL;
+}
+
+static inline void chained_map_drop(struct chained_map *self)
+{
+	struct chained_entry *curr, *next;
+
+	for (size_t i = 0; i < self->cap; i++) {
+		for (curr = self->bkts[i]; curr; curr = next) {
+			next = curr->next;
+			free(curr);
+		}
+	}
+	free(self->bkts);
+	free(self);
+}
+
+#endif /* _CHAINED_HASH_MAP_H */
@@ -0,0 +1,32 @@
+#ifndef _MCC_ALLOCATOR_H
+#define _MCC_ALLOCATOR_H
+
+#include <stddef.h>
+
+/*
+ * Where a container gets its memory from. ctx is passed to every function.
+ * alloc must return memory aligned to max_align_t, or NULL on failure.
+ * realloc may be NULL, in which case memory is resized with alloc, a copy
+ * and free. free may be NULL for allocators that reclaim memory in bulk,
+ * which also lets containers skip visiting their elements when dropped if
+ * the elements need no drop. Temporary buffers, such as the scratch space of
+ * the sorts of vectors and deques, come from the same allocator and are
+ * always taken and given back on the calling thread.
+ */
+struct mcc_allocator {
+	void *(*alloc)(void *ctx, size_t size);
+	void *(*realloc)(void *ctx, void *ptr, size_t old_size,
+			 size_t new_size);
+	void (*free)(void *ctx, void *ptr);
+	void *ctx;
+};
+
+/*
+ * Sets the allocator of the containers created afterwards with a NULL or no
+ * allocator, which is malloc and friends by default. NULL restores it. Every
+ * container keeps the allocator it was created with, so this must not be
+ * called concurrently with creating containers.
+ */
+void mcc_set_allocator(const struct mcc_allocator *allocator);
+
+#endif /* _MCC_ALLOCATOR_H */
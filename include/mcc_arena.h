@@ -0,0 +1,58 @@
+#ifndef _MCC_ARENA_H
+#define _MCC_ARENA_H
+
+#include "mcc_allocator.h"
+#include <stddef.h>
+
+/*
+ * A bump allocator. Memory is handed out from large blocks and is only given
+ * back all at once, by mcc_arena_release or mcc_arena_drop.
+ *
+ * Every container has a mcc_*_new_in constructor that takes its memory from
+ * an arena, which is the same as passing mcc_arena_allocator to its
+ * mcc_*_new_with_allocator constructor. Dropping such a container still drops
+ * its elements, but if they have no drop function it does not visit them at
+ * all, so throwing away a container of any size costs next to nothing. The
+ * memory comes back when the arena is released past the point the container
+ * was created at.
+ *
+ * An arena is not thread-safe, and neither is using containers of the same
+ * arena from different threads.
+ */
+struct mcc_arena;
+
+/*
+ * block_size is the size of the blocks to allocate from, 0 for a default.
+ * The blocks come from the allocator set by mcc_set_allocator.
+ */
+struct mcc_arena *mcc_arena_new(size_t block_size);
+
+/* Frees all memory of the arena, without dropping anything in it. */
+void mcc_arena_drop(struct mcc_arena *self);
+
+/* Returns NULL if the memory ran out. Memory is aligned to max_align_t. */
+void *mcc_arena_alloc(struct mcc_arena *self, size_t size);
+
+/*
+ * Resizes memory returned by mcc_arena_alloc, which takes no copy if ptr is
+ * the last allocation. ptr may be NULL, as with realloc.
+ */
+void *mcc_arena_realloc(struct mcc_arena *self, void *ptr, size_t old_size,
+			size_t new_size);
+
+/*
+ * An allocator that allocates from self and never frees, valid as long as
+ * self is. Returns NULL if self is NULL.
+ */
+const struct mcc_allocator *mcc_arena_allocator(struct mcc_arena *self);
+
+/* The current position of the arena, to pass to mcc_arena_release later. */
+size_t mcc_arena_mark(struct mcc_arena *self);
+
+/*
+ * Frees everything allocated since mark was taken, 0 for everything. The
+ * containers in that memory must not be used again, not even to drop them.
+ */
+void mcc_arena_release(struct mcc_arena *self, size_t mark);
+
+#endif /* _MCC_ARENA_H */
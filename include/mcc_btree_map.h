@@ -0,0 +1,100 @@
+#ifndef _MCC_BTREE_MAP_H
+#define _MCC_BTREE_MAP_H
+
+#include "mcc_arena.h"
+#include "mcc_object.h"
+#include "mcc_utils.h"
+
+struct mcc_btree_map;
+
+struct mcc_btree_map *mcc_btree_map_new(const struct mcc_object_interface *K,
+					const struct mcc_object_interface *V);
+
+/* Like mcc_btree_map_new, with all memory taken from arena. */
+struct mcc_btree_map *
+mcc_btree_map_new_in(struct mcc_arena *arena,
+		     const struct mcc_object_interface *K,
+		     const struct mcc_object_interface *V);
+
+/*
+ * Like mcc_btree_map_new, with all memory taken from allocator, or from the one
+ * set by mcc_set_allocator if it is NULL.
+ */
+struct mcc_btree_map *
+mcc_btree_map_new_with_allocator(const struct mcc_allocator *allocator,
+				 const struct mcc_object_interface *K,
+				 const struct mcc_object_interface *V);
+
+/*
+ * Like mcc_btree_map_new, but every node holds up to order - 1 keys and has
+ * up to order children instead of a fan-out derived from the key size. The
+ * order must be at least 4.
+ */
+struct mcc_btree_map *
+mcc_btree_map_new_with_order(const struct mcc_object_interface *K,
+			     const struct mcc_object_interface *V,
+			     size_t order);
+
+void mcc_btree_map_drop(struct mcc_btree_map *self);
+
+int mcc_btree_map_insert(struct mcc_btree_map *self, const void *key,
+			 const void *value);
+
+void mcc_btree_map_remove(struct mcc_btree_map *self, const void *key);
+
+void mcc_btree_map_clear(struct mcc_btree_map *self);
+
+int mcc_btree_map_get(struct mcc_btree_map *self, const void *key, void **ref);
+
+int mcc_btree_map_get_key_value(struct mcc_btree_map *self, const void *key,
+				struct mcc_pair **ref);
+
+size_t mcc_btree_map_len(struct mcc_btree_map *self);
+
+bool mcc_btree_map_is_empty(struct mcc_btree_map *self);
+
+/*
+ * Calls fn on every entry in key order. Returns OK, or the first nonzero
+ * value fn returned, at which it stops. fn may change the values but not the
+ * keys.
+ */
+int mcc_btree_map_for_each(struct mcc_btree_map *self, mcc_pair_visit_fn fn,
+			   void *ctx);
+
+/* Folds the entries into acc in key order, see mcc_map_fold. */
+size_t mcc_btree_map_fold(struct mcc_btree_map *self, mcc_pair_fold_fn fn,
+			  void *acc);
+
+struct btree_node;
+
+/*
+ * The fields are private. mcc_btree_map_iter_init sets an iterator up in
+ * place, e.g. on the stack, without allocating, and it needs no drop.
+ */
+struct mcc_btree_map_iter {
+	struct mcc_btree_map_iter *next;
+	struct mcc_btree_map *map;
+	struct btree_node *node;
+	size_t idx;
+	struct mcc_pair pair;
+	bool in_use;
+};
+
+struct mcc_btree_map_iter *mcc_btree_map_iter_new(struct mcc_btree_map *map);
+
+int mcc_btree_map_iter_init(struct mcc_btree_map_iter *self,
+			    struct mcc_btree_map *map);
+
+void mcc_btree_map_iter_drop(struct mcc_btree_map_iter *self);
+
+bool mcc_btree_map_iter_next(struct mcc_btree_map_iter *self,
+			     struct mcc_pair **ref);
+
+/*
+ * Stores the next up to n entries in pairs and returns how many it stored,
+ * which is less than n only at the end.
+ */
+size_t mcc_btree_map_iter_next_n(struct mcc_btree_map_iter *self,
+				 struct mcc_pair *pairs, size_t n);
+
+#endif /* _MCC_BTREE_MAP_H */
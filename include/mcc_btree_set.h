@@ -0,0 +1,71 @@
+#ifndef _MCC_BTREE_SET_H
+#define _MCC_BTREE_SET_H
+
+#include "mcc_arena.h"
+#include "mcc_btree_map.h"
+#include "mcc_object.h"
+
+struct mcc_btree_set;
+
+struct mcc_btree_set *mcc_btree_set_new(const struct mcc_object_interface *T);
+
+/* See mcc_btree_map_new_in. */
+struct mcc_btree_set *
+mcc_btree_set_new_in(struct mcc_arena *arena,
+		     const struct mcc_object_interface *T);
+
+/* See mcc_btree_map_new_with_allocator. */
+struct mcc_btree_set *
+mcc_btree_set_new_with_allocator(const struct mcc_allocator *allocator,
+				 const struct mcc_object_interface *T);
+
+struct mcc_btree_set *
+mcc_btree_set_new_with_order(const struct mcc_object_interface *T,
+			     size_t order);
+
+void mcc_btree_set_drop(struct mcc_btree_set *self);
+
+int mcc_btree_set_insert(struct mcc_btree_set *self, const void *value);
+
+void mcc_btree_set_remove(struct mcc_btree_set *self, const void *value);
+
+void mcc_btree_set_clear(struct mcc_btree_set *self);
+
+int mcc_btree_set_get(struct mcc_btree_set *self, const void *value,
+		      const void **ref);
+
+size_t mcc_btree_set_len(struct mcc_btree_set *self);
+
+bool mcc_btree_set_is_empty(struct mcc_btree_set *self);
+
+/* Like mcc_btree_map_for_each, but only passes the values. */
+int mcc_btree_set_for_each(struct mcc_btree_set *self, mcc_const_visit_fn fn,
+			   void *ctx);
+
+/* Like mcc_btree_map_fold, but only passes the values. */
+size_t mcc_btree_set_fold(struct mcc_btree_set *self, mcc_fold_fn fn,
+			  void *acc);
+
+/*
+ * The fields are private. mcc_btree_set_iter_init sets an iterator up in place,
+ * e.g. on the stack, without allocating, and it needs no drop.
+ */
+struct mcc_btree_set_iter {
+	struct mcc_btree_map_iter btree_map_iter;
+};
+
+struct mcc_btree_set_iter *mcc_btree_set_iter_new(struct mcc_btree_set *set);
+
+int mcc_btree_set_iter_init(struct mcc_btree_set_iter *self,
+			    struct mcc_btree_set *set);
+
+void mcc_btree_set_iter_drop(struct mcc_btree_set_iter *self);
+
+bool mcc_btree_set_iter_next(struct mcc_btree_set_iter *self,
+			     const void **ref);
+
+/* Like mcc_btree_map_iter_next_n, but stores the values. */
+size_t mcc_btree_set_iter_next_n(struct mcc_btree_set_iter *self,
+				 const void **refs, size_t n);
+
+#endif /* _MCC_BTREE_SET_H */
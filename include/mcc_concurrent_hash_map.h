@@ -0,0 +1,64 @@
+#ifndef _MCC_CONCURRENT_HASH_MAP_H
+#define _MCC_CONCURRENT_HASH_MAP_H
+
+#include "mcc_object.h"
+#include "mcc_utils.h"
+
+/*
+ * A hash map that can be shared between threads. It is split into shards
+ * that are locked independently, so only operations on keys in the same
+ * shard wait for each other, and lookups never wait for other lookups. Only
+ * mcc_concurrent_hash_map_new* and mcc_concurrent_hash_map_drop must not run
+ * concurrently with anything else on the same map.
+ */
+struct mcc_concurrent_hash_map;
+
+struct mcc_concurrent_hash_map *
+mcc_concurrent_hash_map_new(const struct mcc_object_interface *K,
+			    const struct mcc_object_interface *V);
+
+/* Like mcc_concurrent_hash_map_new, with nshards rounded up to a power of 2. */
+struct mcc_concurrent_hash_map *
+mcc_concurrent_hash_map_new_with_shards(const struct mcc_object_interface *K,
+					const struct mcc_object_interface *V,
+					size_t nshards);
+
+void mcc_concurrent_hash_map_drop(struct mcc_concurrent_hash_map *self);
+
+int mcc_concurrent_hash_map_insert(struct mcc_concurrent_hash_map *self,
+				   const void *key, const void *value);
+
+/* Returns NONE if the key was not there. */
+int mcc_concurrent_hash_map_remove(struct mcc_concurrent_hash_map *self,
+				   const void *key);
+
+/*
+ * Copies the value of key into value, which may be NULL to only check that
+ * the key exists. The copy is bitwise: any resource the value refers to may
+ * be dropped as soon as another thread removes or replaces it.
+ */
+int mcc_concurrent_hash_map_get(struct mcc_concurrent_hash_map *self,
+				const void *key, void *value);
+
+/* The number of entries, which may be out of date by the time it returns. */
+size_t mcc_concurrent_hash_map_len(struct mcc_concurrent_hash_map *self);
+
+bool mcc_concurrent_hash_map_is_empty(struct mcc_concurrent_hash_map *self);
+
+/*
+ * An iterator walks a copy of all entries taken at one point in time, so it
+ * is not affected by later changes to the map. Like a get, the copy is
+ * bitwise.
+ */
+struct mcc_concurrent_hash_map_iter;
+
+struct mcc_concurrent_hash_map_iter *
+mcc_concurrent_hash_map_iter_new(struct mcc_concurrent_hash_map *map);
+
+void mcc_concurrent_hash_map_iter_drop(
+	struct mcc_concurrent_hash_map_iter *self);
+
+bool mcc_concurrent_hash_map_iter_next(
+	struct mcc_concurrent_hash_map_iter *self, struct mcc_pair **ref);
+
+#endif /* _MCC_CONCURRENT_HASH_MAP_H */
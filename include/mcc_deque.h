@@ -1,12 +1,26 @@
 #ifndef _MCC_DEQUE_H
 #define _MCC_DEQUE_H
 
+#include "mcc_arena.h"
 #include "mcc_object.h"
+#include "mcc_utils.h"
 
 struct mcc_deque;
 
 struct mcc_deque *mcc_deque_new(const struct mcc_object_interface *T);
 
+/* Like mcc_deque_new, with all memory taken from arena. */
+struct mcc_deque *mcc_deque_new_in(struct mcc_arena *arena,
+				   const struct mcc_object_interface *T);
+
+/*
+ * Like mcc_deque_new, with all memory taken from allocator, or from the one set
+ * by mcc_set_allocator if it is NULL.
+ */
+struct mcc_deque *
+mcc_deque_new_with_allocator(const struct mcc_allocator *allocator,
+			     const struct mcc_object_interface *T);
+
 void mcc_deque_drop(struct mcc_deque *self);
 
 int mcc_deque_reserve(struct mcc_deque *self, size_t additional);
@@ -45,14 +59,45 @@ int mcc_deque_reverse(struct mcc_deque *self);
 
 int mcc_deque_sort(struct mcc_deque *self);
 
+int mcc_deque_stable_sort(struct mcc_deque *self);
+
+int mcc_deque_par_sort(struct mcc_deque *self, size_t nthreads);
+
 void *mcc_deque_binary_search(struct mcc_deque *self, const void *key);
 
-struct mcc_deque_iter;
+/*
+ * Calls fn on every element from front to back. Returns OK, or the first
+ * nonzero value fn returned, at which it stops.
+ */
+int mcc_deque_for_each(struct mcc_deque *self, mcc_visit_fn fn, void *ctx);
+
+/* Folds the elements into acc from front to back, see mcc_vector_fold. */
+size_t mcc_deque_fold(struct mcc_deque *self, mcc_fold_fn fn, void *acc);
+
+/*
+ * The fields are private. mcc_deque_iter_init sets an iterator up in place,
+ * e.g. on the stack, without allocating, and it needs no drop.
+ */
+struct mcc_deque_iter {
+	struct mcc_deque_iter *next;
+	struct mcc_deque *deque;
+	size_t curr;
+	bool in_use;
+};
 
 struct mcc_deque_iter *mcc_deque_iter_new(struct mcc_deque *deque);
 
+int mcc_deque_iter_init(struct mcc_deque_iter *self, struct mcc_deque *deque);
+
 void mcc_deque_iter_drop(struct mcc_deque_iter *self);
 
 bool mcc_deque_iter_next(struct mcc_deque_iter *self, void **ref);
 
+/*
+ * Stores the next up to n elements in refs and returns how many it stored,
+ * which is less than n only at the end.
+ */
+size_t mcc_deque_iter_next_n(struct mcc_deque_iter *self, void **refs,
+			     size_t n);
+
 #endif /* _MCC_DEQUE_H */
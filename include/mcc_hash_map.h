@@ -1,6 +1,7 @@
 #ifndef _MCC_HASH_MAP_H
 #define _MCC_HASH_MAP_H
 
+#include "mcc_arena.h"
 #include "mcc_object.h"
 #include "mcc_utils.h"
 
@@ -9,35 +10,119 @@ struct mcc_hash_map;
 struct mcc_hash_map *mcc_hash_map_new(const struct mcc_object_interface *K,
 				      const struct mcc_object_interface *V);
 
+/* Like mcc_hash_map_new, with all memory taken from arena. */
+struct mcc_hash_map *
+mcc_hash_map_new_in(struct mcc_arena *arena,
+		    const struct mcc_object_interface *K,
+		    const struct mcc_object_interface *V);
+
+/*
+ * Like mcc_hash_map_new, with all memory taken from allocator, or from the one
+ * set by mcc_set_allocator if it is NULL.
+ */
+struct mcc_hash_map *
+mcc_hash_map_new_with_allocator(const struct mcc_allocator *allocator,
+				const struct mcc_object_interface *K,
+				const struct mcc_object_interface *V);
+
 void mcc_hash_map_drop(struct mcc_hash_map *self);
 
+/*
+ * Off by default. When enabled, growing the table does not rehash every entry
+ * at once: the old table stays next to the new one and each insert and remove
+ * moves a few of its entries over, so no single insert takes O(n). Until the
+ * old table is drained, lookups may probe both tables and the memory of both
+ * is held. Lookups never move entries, so a map that stops changing keeps its
+ * old table until the next insert, remove or reserve. Disabling finishes a
+ * resize in progress.
+ */
+int mcc_hash_map_incremental_resize(struct mcc_hash_map *self, bool enable);
+
 int mcc_hash_map_reserve(struct mcc_hash_map *self, size_t additional);
 
+/*
+ * The hash the map uses for key. It only depends on the key interface, so a
+ * key hashed once can be passed to the *_hashed functions of every map with
+ * the same K, which then skip K->hash. Passing any other hash is undefined.
+ */
+size_t mcc_hash_map_hash(struct mcc_hash_map *self, const void *key);
+
 int mcc_hash_map_insert(struct mcc_hash_map *self, const void *key,
 			const void *value);
 
+int mcc_hash_map_insert_hashed(struct mcc_hash_map *self, const void *key,
+			       size_t hash, const void *value);
+
 void mcc_hash_map_remove(struct mcc_hash_map *self, const void *key);
 
+void mcc_hash_map_remove_hashed(struct mcc_hash_map *self, const void *key,
+				size_t hash);
+
 void mcc_hash_map_clear(struct mcc_hash_map *self);
 
 int mcc_hash_map_get(struct mcc_hash_map *self, const void *key, void **ref);
 
+int mcc_hash_map_get_hashed(struct mcc_hash_map *self, const void *key,
+			    size_t hash, void **ref);
+
 int mcc_hash_map_get_key_value(struct mcc_hash_map *self, const void *key,
 			       struct mcc_pair **ref);
 
+/*
+ * Looks up the n keys stored one after another at keys, and sets refs[i] to
+ * the value of the i-th key or to NULL if it is not in the map. Much faster
+ * than one mcc_hash_map_get per key when the map does not fit in the cache,
+ * since the memory accesses of a whole batch overlap.
+ */
+int mcc_hash_map_get_many(struct mcc_hash_map *self, const void *keys,
+			  size_t n, void **refs);
+
 size_t mcc_hash_map_capacity(struct mcc_hash_map *self);
 
 size_t mcc_hash_map_len(struct mcc_hash_map *self);
 
 bool mcc_hash_map_is_empty(struct mcc_hash_map *self);
 
-struct mcc_hash_map_iter;
+/*
+ * Calls fn on every entry, in no particular order. Returns OK, or the first
+ * nonzero value fn returned, at which it stops. fn may change the values but
+ * not the keys. Unlike the iterators it writes nothing to the map, so several
+ * threads may run it at once while nothing changes the map.
+ */
+int mcc_hash_map_for_each(struct mcc_hash_map *self, mcc_pair_visit_fn fn,
+			  void *ctx);
+
+/* Folds the entries into acc, see mcc_hash_map_for_each and mcc_map_fold. */
+size_t mcc_hash_map_fold(struct mcc_hash_map *self, mcc_pair_fold_fn fn,
+			 void *acc);
+
+/*
+ * The fields are private. mcc_hash_map_iter_init sets an iterator up in
+ * place, e.g. on the stack, without allocating, and it needs no drop.
+ */
+struct mcc_hash_map_iter {
+	struct mcc_hash_map_iter *next;
+	struct mcc_hash_map *map;
+	struct mcc_pair pair;
+	size_t index;
+	bool in_use;
+};
 
 struct mcc_hash_map_iter *mcc_hash_map_iter_new(struct mcc_hash_map *map);
 
+int mcc_hash_map_iter_init(struct mcc_hash_map_iter *self,
+			   struct mcc_hash_map *map);
+
 void mcc_hash_map_iter_drop(struct mcc_hash_map_iter *self);
 
 bool mcc_hash_map_iter_next(struct mcc_hash_map_iter *self,
 			    struct mcc_pair **ref);
 
+/*
+ * Stores the next up to n entries in pairs and returns how many it stored,
+ * which is less than n only at the end.
+ */
+size_t mcc_hash_map_iter_next_n(struct mcc_hash_map_iter *self,
+				struct mcc_pair *pairs, size_t n);
+
 #endif /* _MCC_HASH_MAP_H */
@@ -1,14 +1,28 @@
 #ifndef _MCC_HASH_SET_H
 #define _MCC_HASH_SET_H
 
+#include "mcc_arena.h"
+#include "mcc_hash_map.h"
 #include "mcc_object.h"
 
 struct mcc_hash_set;
 
 struct mcc_hash_set *mcc_hash_set_new(const struct mcc_object_interface *T);
 
+/* See mcc_hash_map_new_in. */
+struct mcc_hash_set *mcc_hash_set_new_in(struct mcc_arena *arena,
+					 const struct mcc_object_interface *T);
+
+/* See mcc_hash_map_new_with_allocator. */
+struct mcc_hash_set *
+mcc_hash_set_new_with_allocator(const struct mcc_allocator *allocator,
+				const struct mcc_object_interface *T);
+
 void mcc_hash_set_drop(struct mcc_hash_set *self);
 
+/* See mcc_hash_map_incremental_resize. */
+int mcc_hash_set_incremental_resize(struct mcc_hash_set *self, bool enable);
+
 int mcc_hash_set_reserve(struct mcc_hash_set *self, size_t additional);
 
 int mcc_hash_set_insert(struct mcc_hash_set *self, const void *value);
@@ -20,18 +34,45 @@ void mcc_hash_set_clear(struct mcc_hash_set *self);
 int mcc_hash_set_get(struct mcc_hash_set *self, const void *value,
 		     const void **ref);
 
+/*
+ * Sets found[i] to whether the i-th of the n values stored one after another
+ * at values is in the set. See mcc_hash_map_get_many.
+ */
+int mcc_hash_set_contains_many(struct mcc_hash_set *self, const void *values,
+			       size_t n, bool *found);
+
 size_t mcc_hash_set_capacity(struct mcc_hash_set *self);
 
 size_t mcc_hash_set_len(struct mcc_hash_set *self);
 
 bool mcc_hash_set_is_empty(struct mcc_hash_set *self);
 
-struct mcc_hash_set_iter;
+/* Like mcc_hash_map_for_each, but only passes the values. */
+int mcc_hash_set_for_each(struct mcc_hash_set *self, mcc_const_visit_fn fn,
+			  void *ctx);
+
+/* Like mcc_hash_map_fold, but only passes the values. */
+size_t mcc_hash_set_fold(struct mcc_hash_set *self, mcc_fold_fn fn, void *acc);
+
+/*
+ * The fields are private. mcc_hash_set_iter_init sets an iterator up in place,
+ * e.g. on the stack, without allocating, and it needs no drop.
+ */
+struct mcc_hash_set_iter {
+	struct mcc_hash_map_iter hash_map_iter;
+};
 
 struct mcc_hash_set_iter *mcc_hash_set_iter_new(struct mcc_hash_set *set);
 
+int mcc_hash_set_iter_init(struct mcc_hash_set_iter *self,
+			   struct mcc_hash_set *set);
+
 void mcc_hash_set_iter_drop(struct mcc_hash_set_iter *self);
 
 bool mcc_hash_set_iter_next(struct mcc_hash_set_iter *self, const void **ref);
 
+/* Like mcc_hash_map_iter_next_n, but stores the values. */
+size_t mcc_hash_set_iter_next_n(struct mcc_hash_set_iter *self,
+				const void **refs, size_t n);
+
 #endif /* _MCC_HASH_SET_H */
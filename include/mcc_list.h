@@ -1,12 +1,26 @@
 #ifndef _MCC_LIST_H
 #define _MCC_LIST_H
 
+#include "mcc_arena.h"
 #include "mcc_object.h"
+#include "mcc_utils.h"
 
 struct mcc_list;
 
 struct mcc_list *mcc_list_new(const struct mcc_object_interface *T);
 
+/* Like mcc_list_new, with all memory taken from arena. */
+struct mcc_list *mcc_list_new_in(struct mcc_arena *arena,
+				 const struct mcc_object_interface *T);
+
+/*
+ * Like mcc_list_new, with all memory taken from allocator, or from the one set
+ * by mcc_set_allocator if it is NULL.
+ */
+struct mcc_list *
+mcc_list_new_with_allocator(const struct mcc_allocator *allocator,
+			    const struct mcc_object_interface *T);
+
 void mcc_list_drop(struct mcc_list *self);
 
 int mcc_list_push_front(struct mcc_list *self, const void *value);
@@ -33,12 +47,40 @@ bool mcc_list_is_empty(struct mcc_list *self);
 
 int mcc_list_sort(struct mcc_list *self);
 
-struct mcc_list_iter;
+/*
+ * Calls fn on every element from head to tail. Returns OK, or the first
+ * nonzero value fn returned, at which it stops.
+ */
+int mcc_list_for_each(struct mcc_list *self, mcc_visit_fn fn, void *ctx);
+
+/* Folds the elements into acc from head to tail, see mcc_vector_fold. */
+size_t mcc_list_fold(struct mcc_list *self, mcc_fold_fn fn, void *acc);
+
+struct mcc_list_node;
+
+/*
+ * The fields are private. mcc_list_iter_init sets an iterator up in place,
+ * e.g. on the stack, without allocating, and it needs no drop.
+ */
+struct mcc_list_iter {
+	struct mcc_list_iter *next;
+	struct mcc_list *list;
+	struct mcc_list_node *curr;
+	bool in_use;
+};
 
 struct mcc_list_iter *mcc_list_iter_new(struct mcc_list *list);
 
+int mcc_list_iter_init(struct mcc_list_iter *self, struct mcc_list *list);
+
 void mcc_list_iter_drop(struct mcc_list_iter *self);
 
 bool mcc_list_iter_next(struct mcc_list_iter *self, void **ref);
 
+/*
+ * Stores the next up to n elements in refs and returns how many it stored,
+ * which is less than n only at the end.
+ */
+size_t mcc_list_iter_next_n(struct mcc_list_iter *self, void **refs, size_t n);
+
 #endif /* _MCC_LIST_H */
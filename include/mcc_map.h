@@ -1,6 +1,7 @@
 #ifndef _MCC_MAP_H
 #define _MCC_MAP_H
 
+#include "mcc_arena.h"
 #include "mcc_object.h"
 #include "mcc_utils.h"
 
@@ -9,12 +10,45 @@ struct mcc_map;
 struct mcc_map *mcc_map_new(const struct mcc_object_interface *K,
 			    const struct mcc_object_interface *V);
 
+/*
+ * Like mcc_map_new, with all memory taken from arena. Only maps of the same
+ * arena can be joined or combined by the set operations.
+ */
+struct mcc_map *mcc_map_new_in(struct mcc_arena *arena,
+			       const struct mcc_object_interface *K,
+			       const struct mcc_object_interface *V);
+
+/*
+ * Like mcc_map_new, with all memory taken from allocator, or from the one set
+ * by mcc_set_allocator if it is NULL. Only maps with equal allocators can be
+ * joined or combined by the set operations.
+ */
+struct mcc_map *
+mcc_map_new_with_allocator(const struct mcc_allocator *allocator,
+			   const struct mcc_object_interface *K,
+			   const struct mcc_object_interface *V);
+
+/*
+ * Builds a map from n keys in strictly ascending order and their values in
+ * linear time, with all nodes in one allocation. The keys and values are
+ * moved in bitwise, as with mcc_map_insert. values may be NULL if V has a
+ * size of 0. Returns NULL if the keys are out of order or on failure.
+ */
+struct mcc_map *mcc_map_from_sorted(const struct mcc_object_interface *K,
+				    const struct mcc_object_interface *V,
+				    const void *keys, const void *values,
+				    size_t n);
+
 void mcc_map_drop(struct mcc_map *self);
 
 int mcc_map_insert(struct mcc_map *self, const void *key, const void *value);
 
 void mcc_map_remove(struct mcc_map *self, const void *key);
 
+void mcc_map_pop_first(struct mcc_map *self);
+
+void mcc_map_pop_last(struct mcc_map *self);
+
 void mcc_map_clear(struct mcc_map *self);
 
 int mcc_map_get(struct mcc_map *self, const void *key, void **ref);
@@ -22,16 +56,117 @@ int mcc_map_get(struct mcc_map *self, const void *key, void **ref);
 int mcc_map_get_key_value(struct mcc_map *self, const void *key,
 			  struct mcc_pair **ref);
 
+int mcc_map_first(struct mcc_map *self, struct mcc_pair **ref);
+
+int mcc_map_last(struct mcc_map *self, struct mcc_pair **ref);
+
 size_t mcc_map_len(struct mcc_map *self);
 
+/*
+ * Order statistics. Every node stores the size of its subtree, which costs a
+ * size_t per entry and a walk to the root on every insert and remove, and
+ * makes these take O(log n).
+ */
+
+/* Stores the number of keys less than key in rank. */
+int mcc_map_rank(struct mcc_map *self, const void *key, size_t *rank);
+
+/* Gets the entry with the given zero-based index in key order. */
+int mcc_map_select(struct mcc_map *self, size_t index, struct mcc_pair **ref);
+
+/* Stores the number of keys in [lo, hi) in count. */
+int mcc_map_count_range(struct mcc_map *self, const void *lo, const void *hi,
+			size_t *count);
+
 bool mcc_map_is_empty(struct mcc_map *self);
 
-struct mcc_map_iter;
+/*
+ * Moves every entry with a key >= key into a new map with the same allocator
+ * and returns it, or NULL on failure. Takes O(log n). Like the maps of the
+ * other operations that move entries, the two share no state that is not
+ * thread-safe afterwards.
+ */
+struct mcc_map *mcc_map_split(struct mcc_map *self, const void *key);
+
+/*
+ * Moves every entry of other into self, leaving other empty. All keys of
+ * other must be greater than those of self. Takes O(log n).
+ */
+int mcc_map_join(struct mcc_map *self, struct mcc_map *other);
+
+/*
+ * The following operations store the result in self and leave other empty,
+ * dropping the entries that do not make it into the result. When a key is in
+ * both maps, the entry of self is kept. They take O(m log(n/m + 1)) for maps
+ * of sizes m <= n, plus the cost of dropping the discarded entries.
+ */
+int mcc_map_union(struct mcc_map *self, struct mcc_map *other);
+
+int mcc_map_intersection(struct mcc_map *self, struct mcc_map *other);
+
+int mcc_map_difference(struct mcc_map *self, struct mcc_map *other);
+
+/*
+ * Lets union, intersection and difference on self spread large inputs over
+ * up to nthreads threads (1 by default). The compare function of K must be
+ * safe to call concurrently.
+ */
+int mcc_map_parallelism(struct mcc_map *self, size_t nthreads);
+
+/*
+ * Calls fn on every entry in key order. Returns OK, or the first nonzero
+ * value fn returned, at which it stops. fn may change the values but not the
+ * keys.
+ */
+int mcc_map_for_each(struct mcc_map *self, mcc_pair_visit_fn fn, void *ctx);
+
+/* Folds the entries into acc in key order. Returns how many fn accepted. */
+size_t mcc_map_fold(struct mcc_map *self, mcc_pair_fold_fn fn, void *acc);
+
+struct mcc_rb_node;
+
+/*
+ * The fields are private. mcc_map_iter_init sets an iterator up in place,
+ * e.g. on the stack, without allocating, and it needs no drop.
+ */
+struct mcc_map_iter {
+	struct mcc_map_iter *next;
+	struct mcc_map *map;
+	struct mcc_rb_node *curr;
+	bool in_use;
+};
 
 struct mcc_map_iter *mcc_map_iter_new(struct mcc_map *map);
 
+int mcc_map_iter_init(struct mcc_map_iter *self, struct mcc_map *map);
+
 void mcc_map_iter_drop(struct mcc_map_iter *self);
 
 bool mcc_map_iter_next(struct mcc_map_iter *self, struct mcc_pair **ref);
 
+/*
+ * Stores the next up to n entries in pairs and returns how many it stored,
+ * which is less than n only at the end.
+ */
+size_t mcc_map_iter_next_n(struct mcc_map_iter *self, struct mcc_pair *pairs,
+			   size_t n);
+
+bool mcc_map_iter_prev(struct mcc_map_iter *self, struct mcc_pair **ref);
+
+/* Moves the iterator right before the first key >= key. */
+void mcc_map_iter_seek_ge(struct mcc_map_iter *self, const void *key);
+
+/* Moves the iterator right before the first key > key. */
+void mcc_map_iter_seek_gt(struct mcc_map_iter *self, const void *key);
+
+void mcc_map_iter_seek_begin(struct mcc_map_iter *self);
+
+void mcc_map_iter_seek_end(struct mcc_map_iter *self);
+
+/*
+ * Moves the iterator right before the entry with the given zero-based index.
+ * Takes O(log n).
+ */
+void mcc_map_iter_seek_nth(struct mcc_map_iter *self, size_t index);
+
 #endif /* _MCC_MAP_H */
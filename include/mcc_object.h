@@ -36,4 +36,12 @@ const struct mcc_object_interface *mcc_float(void);
 const struct mcc_object_interface *mcc_double(void);
 const struct mcc_object_interface *mcc_long_double(void);
 
+/*
+ * Sets the seed of the hash functions of the interfaces above, which is 0 by
+ * default. Seeding from a random source at startup keeps outside input from
+ * choosing keys that collide. Every hash changes with the seed, so call it
+ * before any hashed container holds keys.
+ */
+void mcc_set_hash_seed(uint64_t seed);
+
 #endif /* _MCC_OBJECT_H */
@@ -1,13 +1,25 @@
 #ifndef _MCC_PRIORITY_QUEUE_H
 #define _MCC_PRIORITY_QUEUE_H
 
+#include "mcc_arena.h"
 #include "mcc_object.h"
+#include "mcc_vector.h"
 
 struct mcc_priority_queue;
 
 struct mcc_priority_queue *
 mcc_priority_queue_new(const struct mcc_object_interface *T);
 
+/* See mcc_vector_new_in. */
+struct mcc_priority_queue *
+mcc_priority_queue_new_in(struct mcc_arena *arena,
+			  const struct mcc_object_interface *T);
+
+/* See mcc_vector_new_with_allocator. */
+struct mcc_priority_queue *
+mcc_priority_queue_new_with_allocator(const struct mcc_allocator *allocator,
+				      const struct mcc_object_interface *T);
+
 void mcc_priority_queue_drop(struct mcc_priority_queue *self);
 
 int mcc_priority_queue_reserve(struct mcc_priority_queue *self,
@@ -15,6 +27,9 @@ int mcc_priority_queue_reserve(struct mcc_priority_queue *self,
 
 int mcc_priority_queue_push(struct mcc_priority_queue *self, const void *value);
 
+int mcc_priority_queue_push_many(struct mcc_priority_queue *self,
+				 const void *values, size_t n);
+
 void mcc_priority_queue_pop(struct mcc_priority_queue *self);
 
 void mcc_priority_queue_clear(struct mcc_priority_queue *self);
@@ -27,14 +42,35 @@ size_t mcc_priority_queue_capacity(struct mcc_priority_queue *self);
 
 bool mcc_priority_queue_is_empty(struct mcc_priority_queue *self);
 
-struct mcc_priority_queue_iter;
+/* Like mcc_vector_for_each, in no particular order. */
+int mcc_priority_queue_for_each(struct mcc_priority_queue *self,
+				mcc_const_visit_fn fn, void *ctx);
+
+/* Like mcc_vector_fold, in no particular order. */
+size_t mcc_priority_queue_fold(struct mcc_priority_queue *self,
+			       mcc_fold_fn fn, void *acc);
+
+/*
+ * The fields are private. mcc_priority_queue_iter_init sets an iterator up
+ * in place, e.g. on the stack, without allocating, and it needs no drop.
+ */
+struct mcc_priority_queue_iter {
+	struct mcc_vector_iter vector_iter;
+};
 
 struct mcc_priority_queue_iter *
 mcc_priority_queue_iter_new(struct mcc_priority_queue *queue);
 
+int mcc_priority_queue_iter_init(struct mcc_priority_queue_iter *self,
+				 struct mcc_priority_queue *queue);
+
 void mcc_priority_queue_iter_drop(struct mcc_priority_queue_iter *self);
 
 bool mcc_priority_queue_iter_next(struct mcc_priority_queue_iter *self,
 				  const void **ref);
 
+/* Like mcc_vector_iter_next_n, in no particular order. */
+size_t mcc_priority_queue_iter_next_n(struct mcc_priority_queue_iter *self,
+				      const void **refs, size_t n);
+
 #endif /* _MCC_PRIORITY_QUEUE_H */
@@ -1,12 +1,22 @@
 #ifndef _MCC_QUEUE_H
 #define _MCC_QUEUE_H
 
+#include "mcc_arena.h"
 #include "mcc_object.h"
 
 struct mcc_queue;
 
 struct mcc_queue *mcc_queue_new(const struct mcc_object_interface *T);
 
+/* See mcc_deque_new_in. */
+struct mcc_queue *mcc_queue_new_in(struct mcc_arena *arena,
+				   const struct mcc_object_interface *T);
+
+/* See mcc_deque_new_with_allocator. */
+struct mcc_queue *
+mcc_queue_new_with_allocator(const struct mcc_allocator *allocator,
+			     const struct mcc_object_interface *T);
+
 void mcc_queue_drop(struct mcc_queue *self);
 
 int mcc_queue_push(struct mcc_queue *self, const void *value);
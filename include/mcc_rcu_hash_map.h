@@ -0,0 +1,61 @@
+#ifndef _MCC_RCU_HASH_MAP_H
+#define _MCC_RCU_HASH_MAP_H
+
+#include "mcc_object.h"
+#include "mcc_utils.h"
+
+/*
+ * A hash map for data that is read far more often than it is changed. Lookups
+ * and iteration never lock and never write to memory shared with other
+ * threads, so they scale with the number of readers. Changes are serialized
+ * by a lock and are much slower than on a mcc_hash_map. Only
+ * mcc_rcu_hash_map_new and mcc_rcu_hash_map_drop must not run concurrently
+ * with anything else on the same map. Removed keys and replaced values are
+ * dropped later by a thread that changes a map, possibly during one of its
+ * lookups; lookups of threads that only read never do this.
+ */
+struct mcc_rcu_hash_map;
+
+struct mcc_rcu_hash_map *
+mcc_rcu_hash_map_new(const struct mcc_object_interface *K,
+		     const struct mcc_object_interface *V);
+
+void mcc_rcu_hash_map_drop(struct mcc_rcu_hash_map *self);
+
+int mcc_rcu_hash_map_insert(struct mcc_rcu_hash_map *self, const void *key,
+			    const void *value);
+
+/* Returns NONE if the key was not there. */
+int mcc_rcu_hash_map_remove(struct mcc_rcu_hash_map *self, const void *key);
+
+/*
+ * Copies the value of key into value, which may be NULL to only check that
+ * the key exists. The copy is bitwise: any resource the value refers to may
+ * be dropped as soon as another thread removes or replaces it.
+ */
+int mcc_rcu_hash_map_get(struct mcc_rcu_hash_map *self, const void *key,
+			 void *value);
+
+/* The number of entries, which may be out of date by the time it returns. */
+size_t mcc_rcu_hash_map_len(struct mcc_rcu_hash_map *self);
+
+bool mcc_rcu_hash_map_is_empty(struct mcc_rcu_hash_map *self);
+
+/*
+ * An iterator sees every entry that stays in the map while it is used, and
+ * may or may not see the ones inserted or removed meanwhile. The pairs it
+ * returns stay valid until it is dropped, which must happen on the thread
+ * that created it. Holding on to an iterator for long delays the reclamation
+ * of removed entries.
+ */
+struct mcc_rcu_hash_map_iter;
+
+struct mcc_rcu_hash_map_iter *
+mcc_rcu_hash_map_iter_new(struct mcc_rcu_hash_map *map);
+
+void mcc_rcu_hash_map_iter_drop(struct mcc_rcu_hash_map_iter *self);
+
+bool mcc_rcu_hash_map_iter_next(struct mcc_rcu_hash_map_iter *self,
+				struct mcc_pair **ref);
+
+#endif /* _MCC_RCU_HASH_MAP_H */
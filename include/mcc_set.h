@@ -1,32 +1,105 @@
 #ifndef _MCC_SET_H
 #define _MCC_SET_H
 
+#include "mcc_arena.h"
+#include "mcc_map.h"
 #include "mcc_object.h"
 
 struct mcc_set;
 
 struct mcc_set *mcc_set_new(const struct mcc_object_interface *T);
 
+/* See mcc_map_new_in. */
+struct mcc_set *mcc_set_new_in(struct mcc_arena *arena,
+			       const struct mcc_object_interface *T);
+
+/* See mcc_map_new_with_allocator. */
+struct mcc_set *
+mcc_set_new_with_allocator(const struct mcc_allocator *allocator,
+			   const struct mcc_object_interface *T);
+
+/* See mcc_map_from_sorted. */
+struct mcc_set *mcc_set_from_sorted(const struct mcc_object_interface *T,
+				    const void *values, size_t n);
+
 void mcc_set_drop(struct mcc_set *self);
 
 int mcc_set_insert(struct mcc_set *self, const void *value);
 
 void mcc_set_remove(struct mcc_set *self, const void *value);
 
+void mcc_set_pop_first(struct mcc_set *self);
+
+void mcc_set_pop_last(struct mcc_set *self);
+
 void mcc_set_clear(struct mcc_set *self);
 
 int mcc_set_get(struct mcc_set *self, const void *value, const void **ref);
 
+int mcc_set_first(struct mcc_set *self, const void **ref);
+
+int mcc_set_last(struct mcc_set *self, const void **ref);
+
 size_t mcc_set_len(struct mcc_set *self);
 
 bool mcc_set_is_empty(struct mcc_set *self);
 
-struct mcc_set_iter;
+int mcc_set_rank(struct mcc_set *self, const void *value, size_t *rank);
+
+int mcc_set_select(struct mcc_set *self, size_t index, const void **ref);
+
+int mcc_set_count_range(struct mcc_set *self, const void *lo, const void *hi,
+			size_t *count);
+
+/* See mcc_map_split and the functions after it. */
+struct mcc_set *mcc_set_split(struct mcc_set *self, const void *value);
+
+int mcc_set_join(struct mcc_set *self, struct mcc_set *other);
+
+int mcc_set_union(struct mcc_set *self, struct mcc_set *other);
+
+int mcc_set_intersection(struct mcc_set *self, struct mcc_set *other);
+
+int mcc_set_difference(struct mcc_set *self, struct mcc_set *other);
+
+int mcc_set_parallelism(struct mcc_set *self, size_t nthreads);
+
+/* Like mcc_map_for_each, but only passes the values. */
+int mcc_set_for_each(struct mcc_set *self, mcc_const_visit_fn fn, void *ctx);
+
+/* Like mcc_map_fold, but only passes the values. */
+size_t mcc_set_fold(struct mcc_set *self, mcc_fold_fn fn, void *acc);
+
+/*
+ * The fields are private. mcc_set_iter_init sets an iterator up in place,
+ * e.g. on the stack, without allocating, and it needs no drop.
+ */
+struct mcc_set_iter {
+	struct mcc_map_iter map_iter;
+};
 
 struct mcc_set_iter *mcc_set_iter_new(struct mcc_set *set);
 
+int mcc_set_iter_init(struct mcc_set_iter *self, struct mcc_set *set);
+
 void mcc_set_iter_drop(struct mcc_set_iter *self);
 
 bool mcc_set_iter_next(struct mcc_set_iter *self, const void **ref);
 
+/* Like mcc_map_iter_next_n, but stores the values. */
+size_t mcc_set_iter_next_n(struct mcc_set_iter *self, const void **refs,
+			   size_t n);
+
+bool mcc_set_iter_prev(struct mcc_set_iter *self, const void **ref);
+
+void mcc_set_iter_seek_ge(struct mcc_set_iter *self, const void *value);
+
+void mcc_set_iter_seek_gt(struct mcc_set_iter *self, const void *value);
+
+void mcc_set_iter_seek_begin(struct mcc_set_iter *self);
+
+void mcc_set_iter_seek_end(struct mcc_set_iter *self);
+
+void mcc_set_iter_seek_nth(struct mcc_set_iter *self, size_t index);
+
 #endif /* _MCC_SET_H */
@@ -0,0 +1,66 @@
+#ifndef _MCC_SKIPLIST_MAP_H
+#define _MCC_SKIPLIST_MAP_H
+
+#include "mcc_object.h"
+#include "mcc_utils.h"
+
+/*
+ * An ordered map that can be used from many threads at once without locking.
+ * Only mcc_skiplist_map_new and mcc_skiplist_map_drop must not run
+ * concurrently with anything else on the same map. Removed keys and values
+ * are dropped later by a thread that changes a map, possibly during one of
+ * its lookups; lookups of threads that only read never do this.
+ */
+struct mcc_skiplist_map;
+
+struct mcc_skiplist_map *
+mcc_skiplist_map_new(const struct mcc_object_interface *K,
+		     const struct mcc_object_interface *V);
+
+void mcc_skiplist_map_drop(struct mcc_skiplist_map *self);
+
+int mcc_skiplist_map_insert(struct mcc_skiplist_map *self, const void *key,
+			    const void *value);
+
+/* Returns NONE if the key was not there. */
+int mcc_skiplist_map_remove(struct mcc_skiplist_map *self, const void *key);
+
+/*
+ * Copies the value of key into value, which may be NULL to only check that
+ * the key exists. The copy is bitwise: any resource the value refers to may
+ * be dropped as soon as another thread removes or replaces it.
+ */
+int mcc_skiplist_map_get(struct mcc_skiplist_map *self, const void *key,
+			 void *value);
+
+/* The number of entries, which may be out of date by the time it returns. */
+size_t mcc_skiplist_map_len(struct mcc_skiplist_map *self);
+
+bool mcc_skiplist_map_is_empty(struct mcc_skiplist_map *self);
+
+/*
+ * An iterator sees every entry that stays in the map while it is used, and
+ * may or may not see the ones inserted or removed meanwhile. The pairs it
+ * returns stay valid until it is dropped, which must happen on the thread
+ * that created it. Holding on to an iterator for long delays the reclamation
+ * of removed entries.
+ */
+struct mcc_skiplist_map_iter;
+
+struct mcc_skiplist_map_iter *
+mcc_skiplist_map_iter_new(struct mcc_skiplist_map *map);
+
+void mcc_skiplist_map_iter_drop(struct mcc_skiplist_map_iter *self);
+
+bool mcc_skiplist_map_iter_next(struct mcc_skiplist_map_iter *self,
+				struct mcc_pair **ref);
+
+/* Moves the iterator right before the first key >= key. */
+void mcc_skiplist_map_iter_seek_ge(struct mcc_skiplist_map_iter *self,
+				   const void *key);
+
+/* Moves the iterator right before the first key > key. */
+void mcc_skiplist_map_iter_seek_gt(struct mcc_skiplist_map_iter *self,
+				   const void *key);
+
+#endif /* _MCC_SKIPLIST_MAP_H */
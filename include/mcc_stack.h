@@ -1,12 +1,22 @@
 #ifndef _MCC_STACK_H
 #define _MCC_STACK_H
 
+#include "mcc_arena.h"
 #include "mcc_object.h"
 
 struct mcc_stack;
 
 struct mcc_stack *mcc_stack_new(const struct mcc_object_interface *T);
 
+/* See mcc_vector_new_in. */
+struct mcc_stack *mcc_stack_new_in(struct mcc_arena *arena,
+				   const struct mcc_object_interface *T);
+
+/* See mcc_vector_new_with_allocator. */
+struct mcc_stack *
+mcc_stack_new_with_allocator(const struct mcc_allocator *allocator,
+			     const struct mcc_object_interface *T);
+
 void mcc_stack_drop(struct mcc_stack *self);
 
 int mcc_stack_push(struct mcc_stack *self, const void *value);
@@ -1,6 +1,7 @@
 #ifndef _MCC_UTILS_H
 #define _MCC_UTILS_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 struct mcc_pair {
@@ -8,4 +9,20 @@ struct mcc_pair {
 	void *value;
 };
 
+/*
+ * Callbacks of mcc_*_for_each, which stops at the first one that returns
+ * nonzero and returns that value. ctx is passed through untouched.
+ */
+typedef int (*mcc_visit_fn)(void *elem, void *ctx);
+typedef int (*mcc_const_visit_fn)(const void *elem, void *ctx);
+typedef int (*mcc_pair_visit_fn)(struct mcc_pair *pair, void *ctx);
+
+/*
+ * Callbacks of mcc_*_fold, which combine an element into acc and return
+ * false to stop the fold early. Like the callbacks above, they take the
+ * element first.
+ */
+typedef bool (*mcc_fold_fn)(const void *elem, void *acc);
+typedef bool (*mcc_pair_fold_fn)(const struct mcc_pair *pair, void *acc);
+
 #endif /* _MCC_UTILS_H */
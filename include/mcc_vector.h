@@ -1,12 +1,26 @@
 #ifndef _MCC_VECTOR_H
 #define _MCC_VECTOR_H
 
+#include "mcc_arena.h"
 #include "mcc_object.h"
+#include "mcc_utils.h"
 
 struct mcc_vector;
 
 struct mcc_vector *mcc_vector_new(const struct mcc_object_interface *T);
 
+/* Like mcc_vector_new, with all memory taken from arena. */
+struct mcc_vector *mcc_vector_new_in(struct mcc_arena *arena,
+				     const struct mcc_object_interface *T);
+
+/*
+ * Like mcc_vector_new, with all memory taken from allocator, or from the one
+ * set by mcc_set_allocator if it is NULL.
+ */
+struct mcc_vector *
+mcc_vector_new_with_allocator(const struct mcc_allocator *allocator,
+			      const struct mcc_object_interface *T);
+
 void mcc_vector_drop(struct mcc_vector *self);
 
 int mcc_vector_reserve(struct mcc_vector *self, size_t additional);
@@ -21,6 +35,8 @@ int mcc_vector_push(struct mcc_vector *self, const void *value);
 
 void mcc_vector_pop(struct mcc_vector *self);
 
+int mcc_vector_push_many(struct mcc_vector *self, const void *values, size_t n);
+
 int mcc_vector_insert(struct mcc_vector *self, size_t index, const void *value);
 
 void mcc_vector_remove(struct mcc_vector *self, size_t index);
@@ -47,14 +63,46 @@ int mcc_vector_reverse(struct mcc_vector *self);
 
 int mcc_vector_sort(struct mcc_vector *self);
 
+int mcc_vector_stable_sort(struct mcc_vector *self);
+
+int mcc_vector_par_sort(struct mcc_vector *self, size_t nthreads);
+
 void *mcc_vector_binary_search(struct mcc_vector *self, const void *key);
 
-struct mcc_vector_iter;
+/*
+ * Calls fn on every element in order. Returns OK, or the first nonzero value
+ * fn returned, at which it stops.
+ */
+int mcc_vector_for_each(struct mcc_vector *self, mcc_visit_fn fn, void *ctx);
+
+/* Folds the elements into acc in order. Returns how many fn accepted. */
+size_t mcc_vector_fold(struct mcc_vector *self, mcc_fold_fn fn, void *acc);
+
+/*
+ * The fields are private. mcc_vector_iter_init sets an iterator up in place,
+ * e.g. on the stack, without allocating, and it needs no drop.
+ */
+struct mcc_vector_iter {
+	struct mcc_vector_iter *next;
+	struct mcc_vector *vector;
+	size_t curr;
+	bool in_use;
+};
 
 struct mcc_vector_iter *mcc_vector_iter_new(struct mcc_vector *vector);
 
+int mcc_vector_iter_init(struct mcc_vector_iter *self,
+			 struct mcc_vector *vector);
+
 void mcc_vector_iter_drop(struct mcc_vector_iter *self);
 
 bool mcc_vector_iter_next(struct mcc_vector_iter *self, void **ref);
 
+/*
+ * Stores the next up to n elements in refs and returns how many it stored,
+ * which is less than n only at the end.
+ */
+size_t mcc_vector_iter_next_n(struct mcc_vector_iter *self, void **refs,
+			      size_t n);
+
 #endif /* _MCC_VECTOR_H */
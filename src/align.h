@@ -0,0 +1,28 @@
+#ifndef _ALIGN_H
+#define _ALIGN_H
+
+#include <stddef.h>
+
+/*
+ * The natural alignment of an object of the given size, capped to the
+ * alignment of a pointer.
+ */
+static inline size_t align_of(size_t size)
+{
+	size_t align = 1;
+
+	if (!size)
+		return 1;
+
+	while (align < sizeof(void *) && !(size & align))
+		align <<= 1;
+	return align;
+}
+
+/* Rounds n up to a multiple of align, which must be a power of two. */
+static inline size_t round_up(size_t n, size_t align)
+{
+	return (n + align - 1) & ~(align - 1);
+}
+
+#endif /* _ALIGN_H */
@@ -0,0 +1,75 @@
+#ifndef _ALLOC_H
+#define _ALLOC_H
+
+#include "mcc_allocator.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The allocator set by mcc_set_allocator. */
+extern struct mcc_allocator default_allocator;
+
+/*
+ * Containers keep a copy of their allocator, so that it can not change or go
+ * away under them.
+ */
+static inline bool allocator_init(struct mcc_allocator *self,
+				  const struct mcc_allocator *allocator)
+{
+	if (allocator && !allocator->alloc)
+		return false;
+
+	*self = allocator ? *allocator : default_allocator;
+	return true;
+}
+
+static inline bool allocator_equal(const struct mcc_allocator *a,
+				   const struct mcc_allocator *b)
+{
+	return a->alloc == b->alloc && a->realloc == b->realloc &&
+	       a->free == b->free && a->ctx == b->ctx;
+}
+
+/* Whether freeing does anything, see struct mcc_allocator. */
+static inline bool allocator_frees(const struct mcc_allocator *a)
+{
+	return a->free != NULL;
+}
+
+static inline void *mem_alloc(const struct mcc_allocator *a, size_t size)
+{
+	return a->alloc(a->ctx, size);
+}
+
+static inline void *mem_calloc(const struct mcc_allocator *a, size_t size)
+{
+	void *ptr = a->alloc(a->ctx, size);
+
+	if (ptr)
+		memset(ptr, 0, size);
+	return ptr;
+}
+
+static inline void mem_free(const struct mcc_allocator *a, void *ptr)
+{
+	if (a->free && ptr)
+		a->free(a->ctx, ptr);
+}
+
+static inline void *mem_realloc(const struct mcc_allocator *a, void *ptr,
+				size_t old_size, size_t new_size)
+{
+	void *new_ptr;
+
+	if (a->realloc)
+		return a->realloc(a->ctx, ptr, old_size, new_size);
+
+	new_ptr = a->alloc(a->ctx, new_size);
+	if (new_ptr && ptr) {
+		memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+		mem_free(a, ptr);
+	}
+	return new_ptr;
+}
+
+#endif /* _ALLOC_H */
@@ -0,0 +1,36 @@
+#include "alloc.h"
+
+static void *heap_alloc(void *ctx, size_t size)
+{
+	return malloc(size);
+}
+
+static void *heap_realloc(void *ctx, void *ptr, size_t old_size,
+			  size_t new_size)
+{
+	return realloc(ptr, new_size);
+}
+
+static void heap_free(void *ctx, void *ptr)
+{
+	free(ptr);
+}
+
+static const struct mcc_allocator heap = {
+	.alloc = heap_alloc,
+	.realloc = heap_realloc,
+	.free = heap_free,
+	.ctx = NULL,
+};
+
+struct mcc_allocator default_allocator = {
+	.alloc = heap_alloc,
+	.realloc = heap_realloc,
+	.free = heap_free,
+	.ctx = NULL,
+};
+
+void mcc_set_allocator(const struct mcc_allocator *allocator)
+{
+	default_allocator = allocator && allocator->alloc ? *allocator : heap;
+}
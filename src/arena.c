@@ -0,0 +1,196 @@
+#include "alloc.h"
+#include "mcc_arena.h"
+#include "mcc_err.h"
+#include <stdalign.h>
+#include <stdint.h>
+
+#define DEFAULT_BLOCK_SIZE (64 * 1024)
+#define ALIGN alignof(max_align_t)
+#define ALIGN_UP(SIZE) (((SIZE) + ALIGN - 1) & ~(ALIGN - 1))
+
+/*
+ * Blocks form a stack. Positions are offsets into the concatenation of all
+ * blocks, so a mark stays valid while later blocks come and go: start is the
+ * position of the first byte of a block.
+ */
+struct arena_block {
+	struct arena_block *prev;
+	size_t start;
+	size_t size;
+};
+
+#define HEADER_SIZE ALIGN_UP(sizeof(struct arena_block))
+
+struct mcc_arena {
+	struct arena_block *top;
+	/* The largest block released last, kept to avoid malloc churn. */
+	struct arena_block *spare;
+	size_t used;
+	size_t block_size;
+	/* Where the blocks come from. */
+	struct mcc_allocator parent;
+	/* What containers allocate from self through. */
+	struct mcc_allocator allocator;
+};
+
+static inline uint8_t *data_of(struct arena_block *block)
+{
+	return (uint8_t *)block + HEADER_SIZE;
+}
+
+static void *arena_alloc(void *ctx, size_t size)
+{
+	return mcc_arena_alloc(ctx, size);
+}
+
+static void *arena_realloc(void *ctx, void *ptr, size_t old_size,
+			   size_t new_size)
+{
+	return mcc_arena_realloc(ctx, ptr, old_size, new_size);
+}
+
+struct mcc_arena *mcc_arena_new(size_t block_size)
+{
+	struct mcc_allocator parent = default_allocator;
+	struct mcc_arena *self;
+
+	self = mem_calloc(&parent, sizeof(struct mcc_arena));
+	if (!self)
+		return NULL;
+
+	self->block_size = block_size ? ALIGN_UP(block_size) :
+					DEFAULT_BLOCK_SIZE;
+	self->parent = parent;
+	self->allocator.alloc = arena_alloc;
+	self->allocator.realloc = arena_realloc;
+	self->allocator.free = NULL;
+	self->allocator.ctx = self;
+	return self;
+}
+
+void mcc_arena_drop(struct mcc_arena *self)
+{
+	struct arena_block *block;
+
+	if (!self)
+		return;
+
+	while (self->top) {
+		block = self->top;
+		self->top = block->prev;
+		mem_free(&self->parent, block);
+	}
+	mem_free(&self->parent, self->spare);
+	mem_free(&self->parent, self);
+}
+
+static int push_block(struct mcc_arena *self, size_t min_size)
+{
+	struct arena_block *block;
+	size_t size = min_size > self->block_size ? min_size : self->block_size;
+
+	if (self->spare && self->spare->size >= min_size) {
+		block = self->spare;
+		self->spare = NULL;
+	} else {
+		if (size > SIZE_MAX - HEADER_SIZE)
+			return CANNOT_ALLOCATE_MEMORY;
+		block = mem_alloc(&self->parent, HEADER_SIZE + size);
+		if (!block)
+			return CANNOT_ALLOCATE_MEMORY;
+		block->size = size;
+	}
+
+	block->start = self->top ? self->top->start + self->top->size : 0;
+	block->prev = self->top;
+	self->top = block;
+	self->used = 0;
+	return OK;
+}
+
+void *mcc_arena_alloc(struct mcc_arena *self, size_t size)
+{
+	void *ptr;
+
+	if (!self || size > SIZE_MAX - ALIGN)
+		return NULL;
+
+	size = size ? ALIGN_UP(size) : ALIGN;
+	if (!self->top || self->top->size - self->used < size) {
+		if (push_block(self, size))
+			return NULL;
+	}
+
+	ptr = data_of(self->top) + self->used;
+	self->used += size;
+	return ptr;
+}
+
+void *mcc_arena_realloc(struct mcc_arena *self, void *ptr, size_t old_size,
+			size_t new_size)
+{
+	uint8_t *data, *new_ptr;
+	size_t offset, end, size;
+
+	if (!self || new_size > SIZE_MAX - ALIGN)
+		return NULL;
+
+	if (!ptr)
+		return mcc_arena_alloc(self, new_size);
+
+	/* The last allocation can grow or shrink where it is. */
+	data = self->top ? data_of(self->top) : NULL;
+	if (data && (uint8_t *)ptr >= data &&
+	    (uint8_t *)ptr < data + self->top->size) {
+		offset = (uint8_t *)ptr - data;
+		end = offset + (old_size ? ALIGN_UP(old_size) : ALIGN);
+		size = new_size ? ALIGN_UP(new_size) : ALIGN;
+		if (end == self->used &&
+		    size <= self->top->size - offset) {
+			self->used = offset + size;
+			return ptr;
+		}
+	}
+
+	if (new_size <= old_size)
+		return ptr;
+
+	new_ptr = mcc_arena_alloc(self, new_size);
+	if (new_ptr)
+		memcpy(new_ptr, ptr, old_size);
+	return new_ptr;
+}
+
+const struct mcc_allocator *mcc_arena_allocator(struct mcc_arena *self)
+{
+	return self ? &self->allocator : NULL;
+}
+
+size_t mcc_arena_mark(struct mcc_arena *self)
+{
+	return self && self->top ? self->top->start + self->used : 0;
+}
+
+void mcc_arena_release(struct mcc_arena *self, size_t mark)
+{
+	struct arena_block *block;
+
+	if (!self)
+		return;
+
+	while (self->top && self->top->start > mark) {
+		block = self->top;
+		self->top = block->prev;
+		if (!self->spare || block->size > self->spare->size) {
+			mem_free(&self->parent, self->spare);
+			self->spare = block;
+		} else {
+			mem_free(&self->parent, block);
+		}
+	}
+
+	if (!self->top)
+		self->used = 0;
+	else if (mark - self->top->start < self->used)
+		self->used = mark - self->top->start;
+}
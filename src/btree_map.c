@@ -0,0 +1,779 @@
+#include "align.h"
+#include "alloc.h"
+#include "mcc_btree_map.h"
+#include "mcc_err.h"
+#include "memswap.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A B-tree whose nodes store their keys contiguously, followed by their
+ * values and, for internal nodes, their children. Every key is stored exactly
+ * once, so there are no separator copies to keep alive. Each array has room
+ * for one entry more than a node may hold: an insertion first overflows the
+ * node, which is then split.
+ */
+
+enum {
+	MIN_ORDER = 4,
+	MAX_DEFAULT_ORDER = 128,
+	MIN_DEFAULT_ORDER = 8,
+	DEFAULT_KEY_BYTES = 512, /* keys of a node span about 8 cache lines */
+	MAX_HEIGHT = sizeof(size_t) * 8,
+};
+
+struct btree_node {
+	struct btree_node *parent;
+	size_t parent_idx;
+	size_t len;
+	bool leaf;
+};
+
+struct mcc_btree_map {
+	const struct mcc_object_interface *K;
+	const struct mcc_object_interface *V;
+	struct mcc_allocator allocator;
+	struct mcc_btree_map_iter *iters;
+	struct btree_node *root;
+	size_t len;
+	size_t max_keys;
+	size_t min_keys;
+	size_t key_offset;
+	size_t val_offset;
+	size_t child_offset;
+	struct mcc_pair pair;
+};
+
+static inline void *key_at(struct mcc_btree_map *self, struct btree_node *node,
+			   size_t i)
+{
+	return (uint8_t *)node + self->key_offset + i * self->K->size;
+}
+
+static inline void *value_at(struct mcc_btree_map *self,
+			     struct btree_node *node, size_t i)
+{
+	return (uint8_t *)node + self->val_offset + i * self->V->size;
+}
+
+static inline struct btree_node **children(struct mcc_btree_map *self,
+					   struct btree_node *node)
+{
+	return (struct btree_node **)((uint8_t *)node + self->child_offset);
+}
+
+static inline size_t node_size(struct mcc_btree_map *self, bool leaf)
+{
+	if (leaf)
+		return self->child_offset;
+	return self->child_offset + (self->max_keys + 2) * sizeof(void *);
+}
+
+static void init_node(struct btree_node *node, bool leaf)
+{
+	node->parent = NULL;
+	node->parent_idx = 0;
+	node->len = 0;
+	node->leaf = leaf;
+}
+
+static inline void set_child(struct mcc_btree_map *self,
+			     struct btree_node *node, size_t i,
+			     struct btree_node *child)
+{
+	children(self, node)[i] = child;
+	child->parent = node;
+	child->parent_idx = i;
+}
+
+static void move_entries(struct mcc_btree_map *self, struct btree_node *dst,
+			 size_t di, struct btree_node *src, size_t si, size_t n)
+{
+	memmove(key_at(self, dst, di), key_at(self, src, si),
+		n * self->K->size);
+	memmove(value_at(self, dst, di), value_at(self, src, si),
+		n * self->V->size);
+}
+
+static void move_children(struct mcc_btree_map *self, struct btree_node *dst,
+			  size_t di, struct btree_node *src, size_t si,
+			  size_t n)
+{
+	struct btree_node **c = children(self, dst);
+	size_t i;
+
+	memmove(&c[di], &children(self, src)[si], n * sizeof(*c));
+	for (i = di; i < di + n; i++) {
+		c[i]->parent = dst;
+		c[i]->parent_idx = i;
+	}
+}
+
+static void destroy_tree(struct mcc_btree_map *self, struct btree_node *node)
+{
+	size_t i;
+
+	if (!node)
+		return;
+
+	for (i = 0; i < node->len; i++) {
+		if (self->K->drop)
+			self->K->drop(key_at(self, node, i));
+		if (self->V->drop)
+			self->V->drop(value_at(self, node, i));
+	}
+
+	if (!node->leaf) {
+		for (i = 0; i <= node->len; i++)
+			destroy_tree(self, children(self, node)[i]);
+	}
+	mem_free(&self->allocator, node);
+}
+
+/*
+ * Binary search within a node. Returns whether key is there, and sets *idx to
+ * its index or to the index of the child it would be found under.
+ */
+static bool search(struct mcc_btree_map *self, struct btree_node *node,
+		   const void *key, size_t *idx)
+{
+	size_t lo = 0, hi = node->len, mid;
+	int res;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		res = self->K->cmp(key, key_at(self, node, mid));
+		if (res > 0) {
+			lo = mid + 1;
+		} else if (res < 0) {
+			hi = mid;
+		} else {
+			*idx = mid;
+			return true;
+		}
+	}
+	*idx = lo;
+	return false;
+}
+
+static struct btree_node *find(struct mcc_btree_map *self, const void *key,
+			       size_t *idx)
+{
+	struct btree_node *node = self->root;
+
+	while (node) {
+		if (search(self, node, key, idx))
+			return node;
+		if (node->leaf)
+			return NULL;
+		node = children(self, node)[*idx];
+	}
+	return NULL;
+}
+
+/* Inserts an entry at idx, with right as its right child in internal nodes. */
+static void insert_entry(struct mcc_btree_map *self, struct btree_node *node,
+			 size_t idx, const void *key, const void *value,
+			 struct btree_node *right)
+{
+	size_t n = node->len - idx;
+
+	move_entries(self, node, idx + 1, node, idx, n);
+	memcpy(key_at(self, node, idx), key, self->K->size);
+	memcpy(value_at(self, node, idx), value, self->V->size);
+	if (!node->leaf) {
+		move_children(self, node, idx + 2, node, idx + 1, n);
+		set_child(self, node, idx + 1, right);
+	}
+	node->len++;
+}
+
+/*
+ * Splits overflowing nodes from node up to the root, moving the median of
+ * each one up into its parent. New nodes are taken from spare, which the
+ * caller has allocated beforehand so that this step cannot fail.
+ */
+static void split(struct mcc_btree_map *self, struct btree_node *node,
+		  struct btree_node **spare)
+{
+	struct btree_node *right, *parent;
+	size_t mid, n;
+
+	while (node->len > self->max_keys) {
+		mid = node->len / 2;
+		n = node->len - mid - 1;
+
+		right = *spare++;
+		init_node(right, node->leaf);
+		move_entries(self, right, 0, node, mid + 1, n);
+		if (!node->leaf)
+			move_children(self, right, 0, node, mid + 1, n + 1);
+		right->len = n;
+		node->len = mid;
+
+		parent = node->parent;
+		if (!parent) {
+			parent = *spare++;
+			init_node(parent, false);
+			set_child(self, parent, 0, node);
+			self->root = parent;
+		}
+
+		insert_entry(self, parent, node->parent_idx,
+			     key_at(self, node, mid), value_at(self, node, mid),
+			     right);
+		node = parent;
+	}
+}
+
+static void remove_entry(struct mcc_btree_map *self, struct btree_node *node,
+			 size_t idx)
+{
+	size_t n = node->len - idx - 1;
+
+	move_entries(self, node, idx, node, idx + 1, n);
+	if (!node->leaf)
+		move_children(self, node, idx + 1, node, idx + 2, n);
+	node->len--;
+}
+
+/* Moves the last entry of child k up and its separator down into k + 1. */
+static void rotate_right(struct mcc_btree_map *self,
+			 struct btree_node *parent, size_t k)
+{
+	struct btree_node *left = children(self, parent)[k];
+	struct btree_node *right = children(self, parent)[k + 1];
+
+	move_entries(self, right, 1, right, 0, right->len);
+	move_entries(self, right, 0, parent, k, 1);
+	move_entries(self, parent, k, left, left->len - 1, 1);
+	if (!right->leaf) {
+		move_children(self, right, 1, right, 0, right->len + 1);
+		set_child(self, right, 0, children(self, left)[left->len]);
+	}
+	left->len--;
+	right->len++;
+}
+
+/* Moves the first entry of child k + 1 up and its separator down into k. */
+static void rotate_left(struct mcc_btree_map *self, struct btree_node *parent,
+			size_t k)
+{
+	struct btree_node *left = children(self, parent)[k];
+	struct btree_node *right = children(self, parent)[k + 1];
+
+	move_entries(self, left, left->len, parent, k, 1);
+	move_entries(self, parent, k, right, 0, 1);
+	move_entries(self, right, 0, right, 1, right->len - 1);
+	if (!left->leaf) {
+		set_child(self, left, left->len + 1, children(self, right)[0]);
+		move_children(self, right, 0, right, 1, right->len);
+	}
+	left->len++;
+	right->len--;
+}
+
+/* Merges child k + 1 and the separator between them into child k. */
+static void merge(struct mcc_btree_map *self, struct btree_node *parent,
+		  size_t k)
+{
+	struct btree_node *left = children(self, parent)[k];
+	struct btree_node *right = children(self, parent)[k + 1];
+
+	move_entries(self, left, left->len, parent, k, 1);
+	move_entries(self, left, left->len + 1, right, 0, right->len);
+	if (!left->leaf)
+		move_children(self, left, left->len + 1, right, 0,
+			      right->len + 1);
+	left->len += right->len + 1;
+	mem_free(&self->allocator, right);
+
+	move_entries(self, parent, k, parent, k + 1, parent->len - k - 1);
+	move_children(self, parent, k + 1, parent, k + 2, parent->len - k - 1);
+	parent->len--;
+}
+
+/* Restores the minimum occupancy from node up to the root. */
+static void rebalance(struct mcc_btree_map *self, struct btree_node *node)
+{
+	struct btree_node *parent, *left, *right, *root;
+	size_t i;
+
+	while (node != self->root && node->len < self->min_keys) {
+		parent = node->parent;
+		i = node->parent_idx;
+		left = i > 0 ? children(self, parent)[i - 1] : NULL;
+		right = i < parent->len ? children(self, parent)[i + 1] : NULL;
+
+		if (left && left->len > self->min_keys) {
+			rotate_right(self, parent, i - 1);
+			return;
+		}
+		if (right && right->len > self->min_keys) {
+			rotate_left(self, parent, i);
+			return;
+		}
+
+		merge(self, parent, left ? i - 1 : i);
+		node = parent;
+	}
+
+	root = self->root;
+	if (root->len)
+		return;
+
+	if (root->leaf) {
+		self->root = NULL;
+	} else {
+		self->root = children(self, root)[0];
+		self->root->parent = NULL;
+		self->root->parent_idx = 0;
+	}
+	mem_free(&self->allocator, root);
+}
+
+static struct mcc_btree_map *create(const struct mcc_allocator *allocator,
+				    const struct mcc_object_interface *K,
+				    const struct mcc_object_interface *V,
+				    size_t order)
+{
+	struct mcc_allocator a;
+	struct mcc_btree_map *self;
+	size_t cap = order;
+
+	if (!K || !V || order < MIN_ORDER || !allocator_init(&a, allocator))
+		return NULL;
+
+	self = mem_calloc(&a, sizeof(struct mcc_btree_map));
+	if (!self)
+		return NULL;
+
+	self->K = K;
+	self->V = V;
+	self->allocator = a;
+	self->max_keys = order - 1;
+	self->min_keys = self->max_keys / 2;
+	self->key_offset =
+		round_up(sizeof(struct btree_node), align_of(K->size));
+	self->val_offset =
+		round_up(self->key_offset + cap * K->size, align_of(V->size));
+	self->child_offset =
+		round_up(self->val_offset + cap * V->size, sizeof(void *));
+	return self;
+}
+
+struct mcc_btree_map *mcc_btree_map_new(const struct mcc_object_interface *K,
+					const struct mcc_object_interface *V)
+{
+	return mcc_btree_map_new_with_allocator(NULL, K, V);
+}
+
+struct mcc_btree_map *
+mcc_btree_map_new_in(struct mcc_arena *arena,
+		     const struct mcc_object_interface *K,
+		     const struct mcc_object_interface *V)
+{
+	return mcc_btree_map_new_with_allocator(mcc_arena_allocator(arena), K,
+						V);
+}
+
+struct mcc_btree_map *
+mcc_btree_map_new_with_allocator(const struct mcc_allocator *allocator,
+				 const struct mcc_object_interface *K,
+				 const struct mcc_object_interface *V)
+{
+	size_t order;
+
+	if (!K || !V)
+		return NULL;
+
+	order = DEFAULT_KEY_BYTES / (K->size ? K->size : 1);
+	if (order < MIN_DEFAULT_ORDER)
+		order = MIN_DEFAULT_ORDER;
+	if (order > MAX_DEFAULT_ORDER)
+		order = MAX_DEFAULT_ORDER;
+	return create(allocator, K, V, order);
+}
+
+struct mcc_btree_map *
+mcc_btree_map_new_with_order(const struct mcc_object_interface *K,
+			     const struct mcc_object_interface *V,
+			     size_t order)
+{
+	return create(NULL, K, V, order);
+}
+
+void mcc_btree_map_drop(struct mcc_btree_map *self)
+{
+	struct mcc_btree_map_iter *tmp;
+
+	if (!self)
+		return;
+
+	/* Memory that is not freed need not be cleared either. */
+	if (allocator_frees(&self->allocator) || self->K->drop ||
+	    self->V->drop)
+		mcc_btree_map_clear(self);
+
+	while (self->iters) {
+		tmp = self->iters;
+		self->iters = self->iters->next;
+		mem_free(&self->allocator, tmp);
+	}
+
+	mem_free(&self->allocator, self);
+}
+
+int mcc_btree_map_insert(struct mcc_btree_map *self, const void *key,
+			 const void *value)
+{
+	struct btree_node *spare[MAX_HEIGHT + 1], *node, *tmp;
+	size_t idx, n, i;
+
+	if (!self || !key || !value)
+		return INVALID_ARGUMENTS;
+
+	if (!self->root) {
+		self->root = mem_alloc(&self->allocator, node_size(self, true));
+		if (!self->root)
+			return CANNOT_ALLOCATE_MEMORY;
+		init_node(self->root, true);
+	}
+
+	node = self->root;
+	while (!search(self, node, key, &idx)) {
+		if (node->leaf)
+			goto insert_new_entry;
+		node = children(self, node)[idx];
+	}
+
+	/* Update the value. */
+	if (!self->V->size)
+		return OK;
+
+	if (self->V->drop)
+		self->V->drop(value_at(self, node, idx));
+	memcpy(value_at(self, node, idx), value, self->V->size);
+	return OK;
+
+insert_new_entry:
+	/*
+	 * Every full node on the way up splits, and a full root also needs a
+	 * new root above it. Allocate all of them before touching the tree.
+	 */
+	for (n = 0, tmp = node; tmp && tmp->len == self->max_keys;
+	     tmp = tmp->parent)
+		n++;
+	if (n && !tmp)
+		n++;
+
+	for (i = 0; i < n; i++) {
+		spare[i] = mem_alloc(&self->allocator, node_size(self, i == 0));
+		if (!spare[i]) {
+			while (i--)
+				mem_free(&self->allocator, spare[i]);
+			return CANNOT_ALLOCATE_MEMORY;
+		}
+	}
+
+	insert_entry(self, node, idx, key, value, NULL);
+	split(self, node, spare);
+	self->len++;
+	return OK;
+}
+
+void mcc_btree_map_remove(struct mcc_btree_map *self, const void *key)
+{
+	struct btree_node *node, *leaf;
+	size_t idx;
+
+	if (!self || !key)
+		return;
+
+	node = find(self, key, &idx);
+	if (!node)
+		return;
+
+	if (!node->leaf) {
+		/* Swap with the predecessor, the last entry of a leaf. */
+		leaf = children(self, node)[idx];
+		while (!leaf->leaf)
+			leaf = children(self, leaf)[leaf->len];
+
+		memswap(key_at(self, node, idx),
+			key_at(self, leaf, leaf->len - 1), self->K->size);
+		memswap(value_at(self, node, idx),
+			value_at(self, leaf, leaf->len - 1), self->V->size);
+		node = leaf;
+		idx = leaf->len - 1;
+	}
+
+	if (self->K->drop)
+		self->K->drop(key_at(self, node, idx));
+	if (self->V->drop)
+		self->V->drop(value_at(self, node, idx));
+
+	remove_entry(self, node, idx);
+	rebalance(self, node);
+	self->len--;
+}
+
+void mcc_btree_map_clear(struct mcc_btree_map *self)
+{
+	if (!self)
+		return;
+
+	destroy_tree(self, self->root);
+	self->root = NULL;
+	self->len = 0;
+}
+
+int mcc_btree_map_get(struct mcc_btree_map *self, const void *key, void **ref)
+{
+	struct btree_node *node;
+	size_t idx;
+
+	if (!self || !key || !ref)
+		return INVALID_ARGUMENTS;
+
+	node = find(self, key, &idx);
+	if (!node)
+		return NONE;
+
+	*ref = value_at(self, node, idx);
+	return OK;
+}
+
+int mcc_btree_map_get_key_value(struct mcc_btree_map *self, const void *key,
+				struct mcc_pair **ref)
+{
+	struct btree_node *node;
+	size_t idx;
+
+	if (!self || !key || !ref)
+		return INVALID_ARGUMENTS;
+
+	node = find(self, key, &idx);
+	if (!node)
+		return NONE;
+
+	self->pair.key = key_at(self, node, idx);
+	self->pair.value = value_at(self, node, idx);
+	*ref = &self->pair;
+	return OK;
+}
+
+size_t mcc_btree_map_len(struct mcc_btree_map *self)
+{
+	return !self ? 0 : self->len;
+}
+
+bool mcc_btree_map_is_empty(struct mcc_btree_map *self)
+{
+	return !self ? true : self->len == 0;
+}
+
+/*
+ * Walks a subtree in order, reading the keys and values of each node straight
+ * from its arrays. The recursion goes no deeper than the height of the tree.
+ */
+static int for_each_in(struct mcc_btree_map *self, struct btree_node *node,
+		       mcc_pair_visit_fn fn, void *ctx)
+{
+	struct btree_node **child = node->leaf ? NULL : children(self, node);
+	struct mcc_pair pair;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < node->len; i++) {
+		if (child) {
+			ret = for_each_in(self, child[i], fn, ctx);
+			if (ret)
+				return ret;
+		}
+		pair.key = key_at(self, node, i);
+		pair.value = value_at(self, node, i);
+		ret = fn(&pair, ctx);
+		if (ret)
+			return ret;
+	}
+	return child ? for_each_in(self, child[i], fn, ctx) : OK;
+}
+
+int mcc_btree_map_for_each(struct mcc_btree_map *self, mcc_pair_visit_fn fn,
+			   void *ctx)
+{
+	if (!self || !fn)
+		return INVALID_ARGUMENTS;
+
+	return self->root ? for_each_in(self, self->root, fn, ctx) : OK;
+}
+
+static bool fold_in(struct mcc_btree_map *self, struct btree_node *node,
+		    mcc_pair_fold_fn fn, void *acc, size_t *n)
+{
+	struct btree_node **child = node->leaf ? NULL : children(self, node);
+	struct mcc_pair pair;
+	size_t i;
+
+	for (i = 0; i < node->len; i++) {
+		if (child && !fold_in(self, child[i], fn, acc, n))
+			return false;
+		pair.key = key_at(self, node, i);
+		pair.value = value_at(self, node, i);
+		if (!fn(&pair, acc))
+			return false;
+		++*n;
+	}
+	return !child || fold_in(self, child[i], fn, acc, n);
+}
+
+size_t mcc_btree_map_fold(struct mcc_btree_map *self, mcc_pair_fold_fn fn,
+			  void *acc)
+{
+	size_t n = 0;
+
+	if (!self || !fn)
+		return 0;
+
+	if (self->root)
+		fold_in(self, self->root, fn, acc, &n);
+	return n;
+}
+
+static struct btree_node *first_leaf(struct mcc_btree_map *map)
+{
+	struct btree_node *node = map->root;
+
+	while (node && !node->leaf)
+		node = children(map, node)[0];
+	return node;
+}
+
+/* Moves *node and *idx from an entry to the one after it, NULL at the end. */
+static inline void step(struct mcc_btree_map *map, struct btree_node **node,
+			size_t *idx)
+{
+	if (!(*node)->leaf) {
+		/* The successor is the first entry of the next subtree. */
+		*node = children(map, *node)[*idx + 1];
+		while (!(*node)->leaf)
+			*node = children(map, *node)[0];
+		*idx = 0;
+	} else {
+		/* Or the separator after the first finished subtree above. */
+		++*idx;
+		while (*node && *idx == (*node)->len) {
+			*idx = (*node)->parent_idx;
+			*node = (*node)->parent;
+		}
+	}
+}
+
+struct mcc_btree_map_iter *mcc_btree_map_iter_new(struct mcc_btree_map *map)
+{
+	struct mcc_btree_map_iter *self;
+
+	if (!map)
+		return NULL;
+
+	self = map->iters;
+	while (self) {
+		if (!self->in_use)
+			goto reset_iterator;
+		self = self->next;
+	}
+
+	self = mem_calloc(&map->allocator, sizeof(struct mcc_btree_map_iter));
+	if (!self)
+		return NULL;
+
+	self->next = map->iters;
+	map->iters = self;
+	self->map = map;
+reset_iterator:
+	self->node = first_leaf(map);
+	self->idx = 0;
+	self->in_use = true;
+	return self;
+}
+
+int mcc_btree_map_iter_init(struct mcc_btree_map_iter *self,
+			    struct mcc_btree_map *map)
+{
+	if (!self || !map)
+		return INVALID_ARGUMENTS;
+
+	self->next = NULL;
+	self->map = map;
+	self->node = first_leaf(map);
+	self->idx = 0;
+	self->in_use = false;
+	return OK;
+}
+
+void mcc_btree_map_iter_drop(struct mcc_btree_map_iter *self)
+{
+	if (self)
+		self->in_use = false;
+}
+
+bool mcc_btree_map_iter_next(struct mcc_btree_map_iter *self,
+			     struct mcc_pair **ref)
+{
+	struct mcc_btree_map *map;
+	struct btree_node *node;
+	size_t idx;
+
+	if (!self || !ref || !self->node)
+		return false;
+
+	map = self->map;
+	node = self->node;
+	idx = self->idx;
+	self->pair.key = key_at(map, node, idx);
+	self->pair.value = value_at(map, node, idx);
+	*ref = &self->pair;
+
+	step(map, &node, &idx);
+	self->node = node;
+	self->idx = idx;
+	return true;
+}
+
+/* Takes the entries of a leaf in one run, without stepping over each. */
+size_t mcc_btree_map_iter_next_n(struct mcc_btree_map_iter *self,
+				 struct mcc_pair *pairs, size_t n)
+{
+	struct mcc_btree_map *map;
+	struct btree_node *node;
+	size_t i = 0, idx;
+
+	if (!self || !pairs)
+		return 0;
+
+	map = self->map;
+	node = self->node;
+	idx = self->idx;
+	while (i < n && node) {
+		if (node->leaf) {
+			for (; i < n && idx < node->len; i++, idx++) {
+				pairs[i].key = key_at(map, node, idx);
+				pairs[i].value = value_at(map, node, idx);
+			}
+			if (idx < node->len)
+				break;
+			/* Step from the last entry, which was just taken. */
+			idx--;
+		} else {
+			pairs[i].key = key_at(map, node, idx);
+			pairs[i].value = value_at(map, node, idx);
+			i++;
+		}
+		step(map, &node, &idx);
+	}
+
+	self->node = node;
+	self->idx = idx;
+	return i;
+}
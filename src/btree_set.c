@@ -0,0 +1,179 @@
+#include "mcc_btree_map.h"
+#include "mcc_btree_set.h"
+#include "mcc_err.h"
+
+#define MAP(PTR) ((struct mcc_btree_map *)(PTR))
+#define MAP_ITER(PTR) ((struct mcc_btree_map_iter *)(PTR))
+#define SET(PTR) ((struct mcc_btree_set *)(PTR))
+#define SET_ITER(PTR) ((struct mcc_btree_set_iter *)(PTR))
+
+/* Number of entries next_n takes from the map at a time. */
+#define ITER_BATCH 32
+
+static const struct mcc_object_interface none = {
+	.size = 0,
+	.drop = (mcc_drop_fn)0,
+	.cmp = (mcc_compare_fn)0,
+	.hash = (mcc_hash_fn)0,
+};
+
+struct mcc_btree_set *mcc_btree_set_new(const struct mcc_object_interface *T)
+{
+	return SET(mcc_btree_map_new(T, &none));
+}
+
+struct mcc_btree_set *
+mcc_btree_set_new_in(struct mcc_arena *arena,
+		     const struct mcc_object_interface *T)
+{
+	return SET(mcc_btree_map_new_in(arena, T, &none));
+}
+
+struct mcc_btree_set *
+mcc_btree_set_new_with_allocator(const struct mcc_allocator *allocator,
+				 const struct mcc_object_interface *T)
+{
+	return SET(mcc_btree_map_new_with_allocator(allocator, T, &none));
+}
+
+struct mcc_btree_set *
+mcc_btree_set_new_with_order(const struct mcc_object_interface *T,
+			     size_t order)
+{
+	return SET(mcc_btree_map_new_with_order(T, &none, order));
+}
+
+void mcc_btree_set_drop(struct mcc_btree_set *self)
+{
+	mcc_btree_map_drop(MAP(self));
+}
+
+int mcc_btree_set_insert(struct mcc_btree_set *self, const void *value)
+{
+	return mcc_btree_map_insert(MAP(self), value, &none);
+}
+
+void mcc_btree_set_remove(struct mcc_btree_set *self, const void *value)
+{
+	mcc_btree_map_remove(MAP(self), value);
+}
+
+void mcc_btree_set_clear(struct mcc_btree_set *self)
+{
+	mcc_btree_map_clear(MAP(self));
+}
+
+int mcc_btree_set_get(struct mcc_btree_set *self, const void *value,
+		      const void **ref)
+{
+	struct mcc_pair *pair;
+	int err;
+
+	err = mcc_btree_map_get_key_value(MAP(self), value, &pair);
+	if (!err)
+		*ref = pair->key;
+	return err;
+}
+
+size_t mcc_btree_set_len(struct mcc_btree_set *self)
+{
+	return mcc_btree_map_len(MAP(self));
+}
+
+bool mcc_btree_set_is_empty(struct mcc_btree_set *self)
+{
+	return mcc_btree_map_is_empty(MAP(self));
+}
+
+struct mcc_btree_set_iter *mcc_btree_set_iter_new(struct mcc_btree_set *set)
+{
+	return SET_ITER(mcc_btree_map_iter_new(MAP(set)));
+}
+
+int mcc_btree_set_iter_init(struct mcc_btree_set_iter *self,
+			    struct mcc_btree_set *set)
+{
+	return mcc_btree_map_iter_init(MAP_ITER(self), MAP(set));
+}
+
+void mcc_btree_set_iter_drop(struct mcc_btree_set_iter *self)
+{
+	mcc_btree_map_iter_drop(MAP_ITER(self));
+}
+
+bool mcc_btree_set_iter_next(struct mcc_btree_set_iter *self,
+			     const void **ref)
+{
+	struct mcc_pair *pair;
+
+	if (mcc_btree_map_iter_next(MAP_ITER(self), &pair)) {
+		*ref = pair->key;
+		return true;
+	} else {
+		return false;
+	}
+}
+
+size_t mcc_btree_set_iter_next_n(struct mcc_btree_set_iter *self,
+				 const void **refs, size_t n)
+{
+	struct mcc_pair pairs[ITER_BATCH];
+	size_t i, m, total = 0;
+
+	if (!refs)
+		return 0;
+
+	while (total < n) {
+		m = n - total < ITER_BATCH ? n - total : ITER_BATCH;
+		m = mcc_btree_map_iter_next_n(MAP_ITER(self), pairs, m);
+		for (i = 0; i < m; i++)
+			refs[total + i] = pairs[i].key;
+		total += m;
+		if (m < ITER_BATCH)
+			break;
+	}
+	return total;
+}
+
+struct visit_values {
+	mcc_const_visit_fn fn;
+	void *ctx;
+};
+
+static int visit_value(struct mcc_pair *pair, void *ctx)
+{
+	struct visit_values *v = ctx;
+
+	return v->fn(pair->key, v->ctx);
+}
+
+int mcc_btree_set_for_each(struct mcc_btree_set *self, mcc_const_visit_fn fn,
+			   void *ctx)
+{
+	struct visit_values v = {fn, ctx};
+
+	if (!fn)
+		return INVALID_ARGUMENTS;
+
+	return mcc_btree_map_for_each(MAP(self), visit_value, &v);
+}
+
+struct fold_values {
+	mcc_fold_fn fn;
+	void *acc;
+};
+
+static bool fold_value(const struct mcc_pair *pair, void *acc)
+{
+	struct fold_values *f = acc;
+
+	return f->fn(pair->key, f->acc);
+}
+
+size_t mcc_btree_set_fold(struct mcc_btree_set *self, mcc_fold_fn fn,
+			  void *acc)
+{
+	struct fold_values f = {fn, acc};
+
+	return fn ? mcc_btree_map_fold(MAP(self), fold_value, &f) : 0;
+}
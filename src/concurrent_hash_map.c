@@ -0,0 +1,286 @@
+#include "align.h"
+#include "hash_map.h"
+#include "mcc_concurrent_hash_map.h"
+#include "mcc_err.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Every shard is a mcc_hash_map behind a reader-writer lock, so each one
+ * grows on its own and a resize only stalls the keys of one shard. A key is
+ * hashed once: the top bits of its hash pick the shard, and the same hash is
+ * passed on to the shard, whose table only uses the low bits. Shards are
+ * cache line aligned so that taking one lock does not bounce the line of its
+ * neighbours.
+ */
+
+#define DEFAULT_SHARDS 64
+#define CACHE_LINE 64
+
+struct shard {
+	pthread_rwlock_t lock;
+	struct mcc_hash_map *map;
+} __attribute__((aligned(CACHE_LINE)));
+
+struct mcc_concurrent_hash_map_iter {
+	uint8_t *entries;
+	size_t len;
+	size_t index;
+	size_t stride;
+	size_t key_size;
+	size_t val_size;
+	size_t val_offset;
+	struct mcc_pair pair;
+};
+
+struct mcc_concurrent_hash_map {
+	const struct mcc_object_interface *K;
+	const struct mcc_object_interface *V;
+	struct shard *shards;
+	size_t nshards;
+	unsigned int shift;
+};
+
+static inline struct shard *shard_of(struct mcc_concurrent_hash_map *self,
+				     uint64_t hash)
+{
+	if (self->nshards == 1)
+		return self->shards;
+
+	return &self->shards[hash >> self->shift];
+}
+
+struct mcc_concurrent_hash_map *
+mcc_concurrent_hash_map_new(const struct mcc_object_interface *K,
+			    const struct mcc_object_interface *V)
+{
+	return mcc_concurrent_hash_map_new_with_shards(K, V, DEFAULT_SHARDS);
+}
+
+struct mcc_concurrent_hash_map *
+mcc_concurrent_hash_map_new_with_shards(const struct mcc_object_interface *K,
+					const struct mcc_object_interface *V,
+					size_t nshards)
+{
+	struct mcc_concurrent_hash_map *self;
+	size_t i;
+
+	if (!K || !V || !nshards)
+		return NULL;
+
+	self = calloc(1, sizeof(struct mcc_concurrent_hash_map));
+	if (!self)
+		return NULL;
+
+	self->K = K;
+	self->V = V;
+	self->nshards = 1;
+	self->shift = 64;
+	while (self->nshards < nshards) {
+		self->nshards <<= 1;
+		self->shift--;
+	}
+
+	self->shards = aligned_alloc(CACHE_LINE,
+				     self->nshards * sizeof(struct shard));
+	if (!self->shards)
+		goto fail;
+
+	for (i = 0; i < self->nshards; i++) {
+		self->shards[i].map = mcc_hash_map_new(K, V);
+		if (!self->shards[i].map)
+			goto fail_shards;
+		pthread_rwlock_init(&self->shards[i].lock, NULL);
+	}
+
+	return self;
+
+fail_shards:
+	while (i--) {
+		pthread_rwlock_destroy(&self->shards[i].lock);
+		mcc_hash_map_drop(self->shards[i].map);
+	}
+	free(self->shards);
+fail:
+	free(self);
+	return NULL;
+}
+
+void mcc_concurrent_hash_map_drop(struct mcc_concurrent_hash_map *self)
+{
+	size_t i;
+
+	if (!self)
+		return;
+
+	for (i = 0; i < self->nshards; i++) {
+		pthread_rwlock_destroy(&self->shards[i].lock);
+		mcc_hash_map_drop(self->shards[i].map);
+	}
+	free(self->shards);
+	free(self);
+}
+
+int mcc_concurrent_hash_map_insert(struct mcc_concurrent_hash_map *self,
+				   const void *key, const void *value)
+{
+	struct shard *shard;
+	size_t hash;
+	int err;
+
+	if (!self || !key || !value)
+		return INVALID_ARGUMENTS;
+
+	hash = mcc_hash_map_hash(self->shards[0].map, key);
+	shard = shard_of(self, hash);
+	pthread_rwlock_wrlock(&shard->lock);
+	err = mcc_hash_map_insert_hashed(shard->map, key, hash, value);
+	pthread_rwlock_unlock(&shard->lock);
+	return err;
+}
+
+int mcc_concurrent_hash_map_remove(struct mcc_concurrent_hash_map *self,
+				   const void *key)
+{
+	struct shard *shard;
+	size_t hash, len;
+
+	if (!self || !key)
+		return INVALID_ARGUMENTS;
+
+	hash = mcc_hash_map_hash(self->shards[0].map, key);
+	shard = shard_of(self, hash);
+	pthread_rwlock_wrlock(&shard->lock);
+	len = mcc_hash_map_len(shard->map);
+	mcc_hash_map_remove_hashed(shard->map, key, hash);
+	len -= mcc_hash_map_len(shard->map);
+	pthread_rwlock_unlock(&shard->lock);
+	return len ? OK : NONE;
+}
+
+int mcc_concurrent_hash_map_get(struct mcc_concurrent_hash_map *self,
+				const void *key, void *value)
+{
+	struct shard *shard;
+	size_t hash;
+	void *ref;
+	int err;
+
+	if (!self || !key)
+		return INVALID_ARGUMENTS;
+
+	/*
+	 * Gets on a mcc_hash_map never write to it, not even to move entries
+	 * during an incremental resize, so readers can share the lock.
+	 */
+	hash = mcc_hash_map_hash(self->shards[0].map, key);
+	shard = shard_of(self, hash);
+	pthread_rwlock_rdlock(&shard->lock);
+	err = mcc_hash_map_get_hashed(shard->map, key, hash, &ref);
+	if (!err && value)
+		memcpy(value, ref, self->V->size);
+	pthread_rwlock_unlock(&shard->lock);
+	return err;
+}
+
+size_t mcc_concurrent_hash_map_len(struct mcc_concurrent_hash_map *self)
+{
+	size_t i, len = 0;
+
+	if (!self)
+		return 0;
+
+	for (i = 0; i < self->nshards; i++) {
+		pthread_rwlock_rdlock(&self->shards[i].lock);
+		len += mcc_hash_map_len(self->shards[i].map);
+		pthread_rwlock_unlock(&self->shards[i].lock);
+	}
+	return len;
+}
+
+bool mcc_concurrent_hash_map_is_empty(struct mcc_concurrent_hash_map *self)
+{
+	return mcc_concurrent_hash_map_len(self) == 0;
+}
+
+static int copy_entry(struct mcc_pair *pair, void *arg)
+{
+	struct mcc_concurrent_hash_map_iter *iter = arg;
+	uint8_t *entry = iter->entries + iter->len * iter->stride;
+
+	memcpy(entry, pair->key, iter->key_size);
+	memcpy(entry + iter->val_offset, pair->value, iter->val_size);
+	iter->len++;
+	return OK;
+}
+
+struct mcc_concurrent_hash_map_iter *
+mcc_concurrent_hash_map_iter_new(struct mcc_concurrent_hash_map *map)
+{
+	struct mcc_concurrent_hash_map_iter *self;
+	size_t i, len = 0;
+
+	if (!map)
+		return NULL;
+
+	self = calloc(1, sizeof(struct mcc_concurrent_hash_map_iter));
+	if (!self)
+		return NULL;
+
+	self->key_size = map->K->size;
+	self->val_size = map->V->size;
+	self->val_offset = round_up(self->key_size, sizeof(void *));
+	self->stride = self->val_offset +
+		       round_up(self->val_size, sizeof(void *));
+
+	/*
+	 * Writers only ever hold one lock, so taking all of them in order
+	 * cannot deadlock and freezes the whole map for the copy.
+	 */
+	for (i = 0; i < map->nshards; i++) {
+		pthread_rwlock_rdlock(&map->shards[i].lock);
+		len += mcc_hash_map_len(map->shards[i].map);
+	}
+
+	self->entries = malloc(len * self->stride + 1);
+	if (self->entries) {
+		for (i = 0; i < map->nshards; i++)
+			mcc_hash_map_for_each(map->shards[i].map, copy_entry,
+					      self);
+	}
+
+	for (i = 0; i < map->nshards; i++)
+		pthread_rwlock_unlock(&map->shards[i].lock);
+
+	if (!self->entries) {
+		free(self);
+		return NULL;
+	}
+	return self;
+}
+
+void mcc_concurrent_hash_map_iter_drop(
+	struct mcc_concurrent_hash_map_iter *self)
+{
+	if (!self)
+		return;
+
+	free(self->entries);
+	free(self);
+}
+
+bool mcc_concurrent_hash_map_iter_next(
+	struct mcc_concurrent_hash_map_iter *self, struct mcc_pair **ref)
+{
+	uint8_t *entry;
+
+	if (!self || !ref || self->index >= self->len)
+		return false;
+
+	entry = self->entries + self->index++ * self->stride;
+	self->pair.key = entry;
+	self->pair.value = entry + self->val_offset;
+	*ref = &self->pair;
+	return true;
+}
@@ -1,17 +1,13 @@
+#include "alloc.h"
 #include "mcc_deque.h"
 #include "mcc_err.h"
 #include "memswap.h"
+#include "sort.h"
 #include <stdlib.h>
 
-struct mcc_deque_iter {
-	struct mcc_deque_iter *next;
-	struct mcc_deque *deque;
-	size_t curr;
-	bool in_use;
-};
-
 struct mcc_deque {
 	const struct mcc_object_interface *T;
+	struct mcc_allocator allocator;
 	struct mcc_deque_iter *iters;
 	uint8_t *ptr;
 	size_t len;
@@ -49,7 +45,9 @@ static inline int reserve(struct mcc_deque *self, size_t additional)
 	while (new_capacity < min_capacity)
 		new_capacity <<= 1;
 
-	new_ptr = realloc(self->ptr, new_capacity * self->T->size);
+	new_ptr = mem_realloc(&self->allocator, self->ptr,
+			      self->capacity * self->T->size,
+			      new_capacity * self->T->size);
 	if (!new_ptr)
 		return CANNOT_ALLOCATE_MEMORY;
 
@@ -127,16 +125,31 @@ static inline void remove_element(struct mcc_deque *self, size_t index)
 
 struct mcc_deque *mcc_deque_new(const struct mcc_object_interface *T)
 {
+	return mcc_deque_new_with_allocator(NULL, T);
+}
+
+struct mcc_deque *mcc_deque_new_in(struct mcc_arena *arena,
+				   const struct mcc_object_interface *T)
+{
+	return mcc_deque_new_with_allocator(mcc_arena_allocator(arena), T);
+}
+
+struct mcc_deque *
+mcc_deque_new_with_allocator(const struct mcc_allocator *allocator,
+			  const struct mcc_object_interface *T)
+{
+	struct mcc_allocator a;
 	struct mcc_deque *self;
 
-	if (!T)
+	if (!T || !allocator_init(&a, allocator))
 		return NULL;
 
-	self = calloc(1, sizeof(struct mcc_deque));
+	self = mem_calloc(&a, sizeof(struct mcc_deque));
 	if (!self)
 		return NULL;
 
 	self->T = T;
+	self->allocator = a;
 	return self;
 }
 
@@ -149,12 +162,12 @@ void mcc_deque_drop(struct mcc_deque *self)
 
 	while (self->iters) {
 		next = self->iters->next;
-		free(self->iters);
+		mem_free(&self->allocator, self->iters);
 		self->iters = next;
 	}
 	mcc_deque_clear(self);
-	free(self->ptr);
-	free(self);
+	mem_free(&self->allocator, self->ptr);
+	mem_free(&self->allocator, self);
 }
 
 int mcc_deque_reserve(struct mcc_deque *self, size_t additional)
@@ -382,26 +395,59 @@ int mcc_deque_reverse(struct mcc_deque *self)
 	return OK;
 }
 
-static void quick_sort(struct mcc_deque *self, size_t low, size_t high)
+int mcc_deque_sort(struct mcc_deque *self)
 {
-	size_t mid = low;
-	size_t i = low;
-	const void *pivot = get(self, high);
+	size_t split;
 
-	for (; i < high; i++) {
-		if (self->T->cmp(get(self, i), pivot) < 0)
-			mcc_deque_swap(self, i, mid++);
-	}
+	if (!self)
+		return INVALID_ARGUMENTS;
 
-	mcc_deque_swap(self, mid, high);
+	if (self->len <= 1)
+		return OK;
+
+	/* Sort the ring buffer in place, even when it wraps around. */
+	split = self->capacity - self->head;
+	if (split > self->len)
+		split = self->len;
+
+	if (split == self->len &&
+	    radix_sort(&self->allocator, self->T, get(self, 0), self->len))
+		return OK;
 
-	if (low + 1 < mid)
-		quick_sort(self, low, mid - 1);
-	if (mid + 1 < high)
-		quick_sort(self, mid + 1, high);
+	pdq_sort(&(struct sort_seq){
+		.first = get(self, 0),
+		.second = self->ptr,
+		.split = split,
+		.len = self->len,
+		.size = self->T->size,
+		.cmp = self->T->cmp,
+	});
+	return OK;
 }
 
-int mcc_deque_sort(struct mcc_deque *self)
+/* Rotates the buffer so that the elements start at index 0 of it. */
+static void make_contiguous(struct mcc_deque *self)
+{
+	size_t size = self->T->size;
+	uint8_t *lo, *hi;
+
+	if (self->head + self->len <= self->capacity)
+		return;
+
+	/* Rotation by three reversals: [0, head), [head, capacity), all. */
+	for (lo = self->ptr, hi = get(self, 0) - size; lo < hi;
+	     lo += size, hi -= size)
+		memswap(lo, hi, size);
+	for (lo = get(self, 0), hi = self->ptr + (self->capacity - 1) * size;
+	     lo < hi; lo += size, hi -= size)
+		memswap(lo, hi, size);
+	for (lo = self->ptr, hi = self->ptr + (self->capacity - 1) * size;
+	     lo < hi; lo += size, hi -= size)
+		memswap(lo, hi, size);
+	self->head = 0;
+}
+
+int mcc_deque_stable_sort(struct mcc_deque *self)
 {
 	if (!self)
 		return INVALID_ARGUMENTS;
@@ -409,8 +455,38 @@ int mcc_deque_sort(struct mcc_deque *self)
 	if (self->len <= 1)
 		return OK;
 
-	quick_sort(self, 0, self->len - 1);
-	return OK;
+	make_contiguous(self);
+	return stable_sort(&self->allocator, get(self, 0), self->len,
+			   self->T->size, self->T->cmp);
+}
+
+int mcc_deque_par_sort(struct mcc_deque *self, size_t nthreads)
+{
+	size_t split;
+
+	if (!self || !nthreads)
+		return INVALID_ARGUMENTS;
+
+	if (self->len <= 1)
+		return OK;
+
+	split = self->capacity - self->head;
+	if (split > self->len)
+		split = self->len;
+
+	if (par_sort(&self->allocator,
+		     &(struct sort_seq){
+			     .first = get(self, 0),
+			     .second = self->ptr,
+			     .split = split,
+			     .len = self->len,
+			     .size = self->T->size,
+			     .cmp = self->T->cmp,
+		     },
+		     self->T, nthreads))
+		return OK;
+
+	return mcc_deque_sort(self);
 }
 
 void *mcc_deque_binary_search(struct mcc_deque *self, const void *key)
@@ -437,6 +513,62 @@ void *mcc_deque_binary_search(struct mcc_deque *self, const void *key)
 	return NULL;
 }
 
+/*
+ * The elements take up at most two runs of the buffer: from head to its end,
+ * and then from its start.
+ */
+static inline size_t first_run(struct mcc_deque *self)
+{
+	size_t n = self->capacity - self->head;
+
+	return n < self->len ? n : self->len;
+}
+
+int mcc_deque_for_each(struct mcc_deque *self, mcc_visit_fn fn, void *ctx)
+{
+	size_t i, n, size;
+	uint8_t *ptr;
+	int ret;
+
+	if (!self || !fn)
+		return INVALID_ARGUMENTS;
+
+	if (!self->len)
+		return OK;
+
+	size = self->T->size;
+	n = first_run(self);
+	ptr = self->ptr + self->head * size;
+	for (i = 0; i < self->len; i++, ptr += size) {
+		if (i == n)
+			ptr = self->ptr;
+		ret = fn(ptr, ctx);
+		if (ret)
+			return ret;
+	}
+	return OK;
+}
+
+size_t mcc_deque_fold(struct mcc_deque *self, mcc_fold_fn fn, void *acc)
+{
+	size_t i, n, size;
+	uint8_t *ptr;
+
+	if (!self || !fn || !self->len)
+		return 0;
+
+	size = self->T->size;
+	n = first_run(self);
+	ptr = self->ptr + self->head * size;
+	for (i = 0; i < self->len; i++, ptr += size) {
+		if (i == n)
+			ptr = self->ptr;
+		if (!fn(ptr, acc))
+			break;
+	}
+	return i;
+}
+
 struct mcc_deque_iter *mcc_deque_iter_new(struct mcc_deque *deque)
 {
 	struct mcc_deque_iter *self;
@@ -451,7 +583,7 @@ struct mcc_deque_iter *mcc_deque_iter_new(struct mcc_deque *deque)
 		self = self->next;
 	}
 
-	self = calloc(1, sizeof(struct mcc_deque_iter));
+	self = mem_calloc(&deque->allocator, sizeof(struct mcc_deque_iter));
 	if (!self)
 		return NULL;
 
@@ -464,6 +596,18 @@ reset_iterator:
 	return self;
 }
 
+int mcc_deque_iter_init(struct mcc_deque_iter *self, struct mcc_deque *deque)
+{
+	if (!self || !deque)
+		return INVALID_ARGUMENTS;
+
+	self->next = NULL;
+	self->deque = deque;
+	self->curr = 0;
+	self->in_use = false;
+	return OK;
+}
+
 void mcc_deque_iter_drop(struct mcc_deque_iter *self)
 {
 	if (self)
@@ -478,3 +622,31 @@ bool mcc_deque_iter_next(struct mcc_deque_iter *self, void **ref)
 	*ref = get(self->deque, self->curr++);
 	return true;
 }
+
+size_t mcc_deque_iter_next_n(struct mcc_deque_iter *self, void **refs,
+			     size_t n)
+{
+	struct mcc_deque *deque;
+	uint8_t *ptr, *end;
+	size_t i, size;
+
+	if (!self || !refs || self->curr >= self->deque->len)
+		return 0;
+
+	deque = self->deque;
+	if (n > deque->len - self->curr)
+		n = deque->len - self->curr;
+
+	/* Walk the ring buffer, wrapping around at its end only once. */
+	size = deque->T->size;
+	ptr = get(deque, self->curr);
+	end = deque->ptr + deque->capacity * size;
+	for (i = 0; i < n; i++, ptr += size) {
+		if (ptr == end)
+			ptr = deque->ptr;
+		refs[i] = ptr;
+	}
+
+	self->curr += n;
+	return n;
+}
@@ -0,0 +1,245 @@
+#include "epoch.h"
+#include "mcc_err.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* A record is pinned while its state holds the epoch shifted left by one. */
+#define PINNED 1
+
+/*
+ * How many retires, or critical sections left while the thread has retired
+ * entries waiting, a thread goes through before it tries to reclaim.
+ */
+#define RECLAIM_INTERVAL 64
+
+#define CACHE_LINE 64
+
+/*
+ * Entries retired in the same epoch. The three lists of a record are indexed
+ * by epoch modulo 3, since an entry is safe to free two epochs later.
+ */
+struct limbo {
+	struct epoch_entry *head;
+	uint64_t epoch;
+};
+
+/*
+ * Per-thread state. Records are never freed: when a thread exits its record
+ * is released and adopted, retired entries included, by the next new thread.
+ * Entries the exiting thread could not free yet are marked orphaned, and the
+ * threads that reclaim their own entries free them too, so they do not have
+ * to wait for a new thread. Each record has a cache line of its own, so
+ * pinning only ever writes to a line no other thread writes to.
+ */
+struct epoch_record {
+	_Atomic uint64_t state;
+	atomic_bool in_use;
+	struct epoch_record *next;
+	unsigned nesting;
+	unsigned ticks;
+	atomic_bool orphaned;
+	struct limbo limbo[3];
+} __attribute__((aligned(CACHE_LINE)));
+
+static _Atomic uint64_t global_epoch = 1;
+static _Atomic(struct epoch_record *) records;
+/* Number of released records that still hold retired entries. */
+static atomic_size_t orphans;
+static _Thread_local struct epoch_record *local;
+static pthread_key_t record_key;
+static pthread_once_t record_key_once = PTHREAD_ONCE_INIT;
+
+static void release_record(void *arg);
+
+static void create_record_key(void)
+{
+	pthread_key_create(&record_key, release_record);
+}
+
+static struct epoch_record *acquire_record(void)
+{
+	struct epoch_record *rec;
+	bool expected;
+
+	pthread_once(&record_key_once, create_record_key);
+	for (rec = atomic_load(&records); rec; rec = rec->next) {
+		expected = false;
+		if (atomic_compare_exchange_strong(&rec->in_use, &expected,
+						   true)) {
+			if (atomic_load(&rec->orphaned)) {
+				atomic_store(&rec->orphaned, false);
+				atomic_fetch_sub(&orphans, 1);
+			}
+			goto found;
+		}
+	}
+
+	rec = aligned_alloc(CACHE_LINE, sizeof(struct epoch_record));
+	if (!rec)
+		return NULL;
+
+	memset(rec, 0, sizeof(struct epoch_record));
+	atomic_init(&rec->in_use, true);
+	rec->next = atomic_load(&records);
+	while (!atomic_compare_exchange_weak(&records, &rec->next, rec))
+		;
+found:
+	pthread_setspecific(record_key, rec);
+	local = rec;
+	return rec;
+}
+
+static void free_list(struct epoch_entry *entry)
+{
+	struct epoch_entry *next;
+
+	for (; entry; entry = next) {
+		next = entry->next;
+		entry->free(entry);
+	}
+}
+
+/* Moves the global epoch on if every pinned thread has seen the current one. */
+static void try_advance(void)
+{
+	uint64_t epoch = atomic_load(&global_epoch), state;
+	struct epoch_record *rec;
+
+	for (rec = atomic_load(&records); rec; rec = rec->next) {
+		state = atomic_load(&rec->state);
+		if ((state & PINNED) && (state >> 1) != epoch)
+			return;
+	}
+	atomic_compare_exchange_strong(&global_epoch, &epoch, epoch + 1);
+}
+
+static void reclaim(struct epoch_record *rec)
+{
+	uint64_t epoch = atomic_load(&global_epoch);
+	struct limbo *limbo;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		limbo = &rec->limbo[i];
+		if (limbo->head && limbo->epoch + 2 <= epoch) {
+			free_list(limbo->head);
+			limbo->head = NULL;
+		}
+	}
+}
+
+static bool has_limbo(const struct epoch_record *rec)
+{
+	return rec->limbo[0].head || rec->limbo[1].head || rec->limbo[2].head;
+}
+
+/*
+ * Reclaims the entries of released records. A record is taken the same way a
+ * new thread would adopt it, so it is never touched by two threads at once.
+ */
+static void reclaim_orphans(void)
+{
+	struct epoch_record *rec;
+	bool expected;
+
+	for (rec = atomic_load(&records); rec; rec = rec->next) {
+		expected = false;
+		if (!atomic_load(&rec->orphaned) ||
+		    !atomic_compare_exchange_strong(&rec->in_use, &expected,
+						    true))
+			continue;
+		if (atomic_load(&rec->orphaned)) {
+			reclaim(rec);
+			if (!has_limbo(rec)) {
+				atomic_store(&rec->orphaned, false);
+				atomic_fetch_sub(&orphans, 1);
+			}
+		}
+		atomic_store(&rec->in_use, false);
+	}
+}
+
+static void collect(struct epoch_record *rec)
+{
+	rec->ticks = 0;
+	try_advance();
+	reclaim(rec);
+	if (atomic_load_explicit(&orphans, memory_order_relaxed))
+		reclaim_orphans();
+}
+
+/* Runs when a thread that used a record exits. */
+static void release_record(void *arg)
+{
+	struct epoch_record *rec = arg;
+
+	if (has_limbo(rec))
+		collect(rec);
+	if (has_limbo(rec)) {
+		atomic_store(&rec->orphaned, true);
+		atomic_fetch_add(&orphans, 1);
+	}
+	atomic_store(&rec->in_use, false);
+}
+
+int epoch_enter(void)
+{
+	struct epoch_record *rec = local ? local : acquire_record();
+
+	if (!rec)
+		return CANNOT_ALLOCATE_MEMORY;
+
+	if (rec->nesting++ == 0) {
+		atomic_store_explicit(&rec->state,
+				      atomic_load(&global_epoch) << 1 | PINNED,
+				      memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+	}
+	return OK;
+}
+
+/*
+ * Leaving the critical section also counts towards reclaiming while this
+ * thread has retired entries waiting, so they are freed even if it retires
+ * nothing more. Threads that never retire anything never reclaim, which
+ * keeps their critical sections free of writes to shared memory.
+ */
+void epoch_exit(void)
+{
+	struct epoch_record *rec = local;
+
+	if (--rec->nesting)
+		return;
+
+	atomic_store_explicit(&rec->state, 0, memory_order_release);
+	if (has_limbo(rec) && ++rec->ticks >= RECLAIM_INTERVAL)
+		collect(rec);
+}
+
+void epoch_retire(struct epoch_entry *entry,
+		  void (*free_fn)(struct epoch_entry *self),
+		  const void *arg)
+{
+	struct epoch_record *rec = local;
+	uint64_t epoch = atomic_load(&global_epoch);
+	struct limbo *limbo = &rec->limbo[epoch % 3];
+
+	/* A list left over from three or more epochs ago is safe to free. */
+	if (limbo->epoch != epoch) {
+		free_list(limbo->head);
+		limbo->head = NULL;
+		limbo->epoch = epoch;
+	}
+
+	entry->free = free_fn;
+	entry->arg = arg;
+	entry->next = limbo->head;
+	limbo->head = entry;
+
+	if (++rec->ticks >= RECLAIM_INTERVAL)
+		collect(rec);
+}
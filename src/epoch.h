@@ -0,0 +1,32 @@
+#ifndef _EPOCH_H
+#define _EPOCH_H
+
+/*
+ * Epoch-based memory reclamation for the concurrent containers.
+ *
+ * Readers wrap every access to shared nodes in epoch_enter/epoch_exit. A
+ * writer that has unlinked a node hands it to epoch_retire, and the node is
+ * freed once every thread that might still see it has left its critical
+ * section. Critical sections nest and must begin and end on the same thread.
+ */
+
+struct epoch_entry {
+	struct epoch_entry *next;
+	void (*free)(struct epoch_entry *self);
+	const void *arg;
+};
+
+/* Returns CANNOT_ALLOCATE_MEMORY if the thread could not be registered. */
+int epoch_enter(void);
+
+void epoch_exit(void);
+
+/*
+ * Calls free_fn(entry) with entry->arg set to arg once no reader can hold a
+ * reference to it anymore. Must be called inside a critical section.
+ */
+void epoch_retire(struct epoch_entry *entry,
+		  void (*free_fn)(struct epoch_entry *self),
+		  const void *arg);
+
+#endif /* _EPOCH_H */
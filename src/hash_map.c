@@ -1,104 +1,512 @@
+#include "align.h"
+#include "alloc.h"
+#include "hash_map.h"
 #include "mcc_err.h"
-#include "mcc_hash_map.h"
 #include <stdlib.h>
 #include <string.h>
 
-struct mcc_hash_map_entry {
-	struct mcc_hash_map_entry *next;
-	struct mcc_pair pair;
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * The map is an open addressing table in the style of SwissTable. Every slot
+ * has one control byte: a full slot stores the low 7 bits of the hash (h2),
+ * an empty or deleted slot stores a negative marker. Slots are probed a group
+ * at a time, so a single vector compare finds every candidate of a group and
+ * K->cmp only runs on the slots whose h2 matches.
+ *
+ *            group 0                 group 1
+ *  ctrl  |h2|h2|E |h2|D |..|   |E |h2|E |..|
+ *  slots |kv|kv|  |kv|  |..|   |  |kv|  |..|
+ */
+enum {
+	CTRL_EMPTY = -128,
+	CTRL_DELETED = -2,
 };
 
-struct mcc_hash_map_iter {
-	struct mcc_hash_map_iter *next;
-	struct mcc_hash_map *map;
-	struct mcc_hash_map_entry *curr;
-	size_t index;
-	bool in_use;
+#if defined(__AVX2__)
+#define GROUP_WIDTH 32
+#define GROUP_SHIFT 0
+typedef uint32_t group_mask;
+#elif defined(__SSE2__)
+#define GROUP_WIDTH 16
+#define GROUP_SHIFT 0
+typedef uint32_t group_mask;
+#else
+#define GROUP_WIDTH 8
+#define GROUP_SHIFT 3
+typedef uint64_t group_mask;
+#endif
+
+/*
+ * Number of old slots moved to the new table by each operation while an
+ * incremental resize is in progress.
+ */
+#define MIGRATE_STEP 32
+
+/*
+ * Number of keys a batched lookup has in flight at once: enough to overlap
+ * the cache misses of their groups and slots, few enough that the prefetched
+ * lines still sit in L1 when they are used.
+ */
+#define PREFETCH_BATCH 16
+
+struct mcc_hash_table {
+	int8_t *ctrl;
+	uint8_t *slots;
+	size_t cap;
+	size_t growth_left;
 };
 
 struct mcc_hash_map {
 	const struct mcc_object_interface *K;
 	const struct mcc_object_interface *V;
+	struct mcc_allocator allocator;
 	struct mcc_hash_map_iter *iters;
-	struct mcc_hash_map_entry **bkts;
+	struct mcc_hash_table table;
+	/*
+	 * The table being drained by an incremental resize. Its slots before
+	 * self->migrated have already been moved, its cap is 0 when no resize
+	 * is in progress.
+	 */
+	struct mcc_hash_table old;
+	size_t migrated;
+	size_t slot_size;
+	size_t val_offset;
+	/*
+	 * Slots only hold the key and the value, the pair returned by
+	 * mcc_hash_map_get_key_value() lives here and is rebound on every call.
+	 */
+	struct mcc_pair pair;
 	size_t len;
-	size_t cap;
+	bool incremental;
 };
 
-static struct mcc_hash_map_entry *create_entry(const void *key, size_t key_size,
-					       const void *val, size_t val_size)
+#if defined(__AVX2__)
+static inline group_mask match_h2(const int8_t *group, int8_t h2)
 {
-	struct mcc_hash_map_entry *entry;
-	uint8_t *ptr;
-	size_t total_size = 0;
+	__m256i ctrl = _mm256_loadu_si256((const __m256i *)group);
+	__m256i match = _mm256_cmpeq_epi8(_mm256_set1_epi8(h2), ctrl);
+	return _mm256_movemask_epi8(match);
+}
 
-	total_size += sizeof(struct mcc_hash_map_entry);
-	total_size += key_size;
-	total_size += val_size;
-	entry = calloc(1, total_size);
-	if (!entry)
-		return NULL;
+static inline group_mask match_empty(const int8_t *group)
+{
+	return match_h2(group, CTRL_EMPTY);
+}
+
+static inline group_mask match_free(const int8_t *group)
+{
+	__m256i ctrl = _mm256_loadu_si256((const __m256i *)group);
+	return _mm256_movemask_epi8(ctrl);
+}
+
+static inline group_mask match_full(const int8_t *group)
+{
+	return ~match_free(group);
+}
+#elif defined(__SSE2__)
+static inline group_mask match_h2(const int8_t *group, int8_t h2)
+{
+	__m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl));
+}
 
-	ptr = (uint8_t *)entry + sizeof(struct mcc_hash_map_entry);
-	memcpy(ptr, key, key_size);
-	entry->pair.key = ptr;
+static inline group_mask match_empty(const int8_t *group)
+{
+	return match_h2(group, CTRL_EMPTY);
+}
 
-	ptr += key_size;
-	memcpy(ptr, val, val_size);
-	entry->pair.value = ptr;
+static inline group_mask match_free(const int8_t *group)
+{
+	__m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+	return _mm_movemask_epi8(ctrl);
+}
+
+static inline group_mask match_full(const int8_t *group)
+{
+	return ~match_free(group) & 0xffff;
+}
+#else
+/*
+ * Portable fallback working on 8 control bytes packed in a word. A set bit
+ * marks the most significant bit of the matching byte, so the slot index is
+ * the bit index shifted right by GROUP_SHIFT.
+ */
+#define LSBS 0x0101010101010101ULL
+#define MSBS 0x8080808080808080ULL
+
+static inline uint64_t load_group(const int8_t *group)
+{
+	uint64_t ctrl;
 
-	return entry;
+	memcpy(&ctrl, group, sizeof(ctrl));
+	return ctrl;
 }
 
-static void destroy_entry(struct mcc_hash_map_entry *entry,
-			  const mcc_drop_fn key_drop,
-			  const mcc_drop_fn val_drop)
+static inline group_mask match_h2(const int8_t *group, int8_t h2)
 {
-	if (key_drop)
-		key_drop((uint8_t *)entry + sizeof(struct mcc_hash_map_entry));
+	/* May report false positives, which K->cmp will filter out. */
+	uint64_t x = load_group(group) ^ (LSBS * (uint8_t)h2);
+	return (x - LSBS) & ~x & MSBS;
+}
 
-	if (val_drop)
-		val_drop(entry->pair.value);
+static inline group_mask match_empty(const int8_t *group)
+{
+	uint64_t ctrl = load_group(group);
+	return (ctrl & ~(ctrl << 6)) & MSBS;
+}
 
-	free(entry);
+static inline group_mask match_free(const int8_t *group)
+{
+	return load_group(group) & MSBS;
 }
 
-static struct mcc_hash_map_entry **get_entry(struct mcc_hash_map *self,
-					     const void *key)
+static inline group_mask match_full(const int8_t *group)
 {
-	size_t h = self->K->hash(key) & (self->cap - 1);
-	struct mcc_hash_map_entry **entry = &self->bkts[h];
+	return ~load_group(group) & MSBS;
+}
+#endif
 
-	while (*entry) {
-		if (!self->K->cmp(key, (*entry)->pair.key))
-			break;
-		entry = &((*entry)->next);
+static inline size_t lowest_bit(group_mask mask)
+{
+	if (sizeof(group_mask) > sizeof(unsigned int))
+		return __builtin_ctzll(mask) >> GROUP_SHIFT;
+	else
+		return __builtin_ctz(mask) >> GROUP_SHIFT;
+}
+
+static inline size_t mix(size_t hash)
+{
+	/*
+	 * Spread user hashes (often the identity for integers) across both the
+	 * probe position and h2.
+	 */
+	uint64_t h = hash;
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+static inline size_t h1(size_t hash)
+{
+	return hash >> 7;
+}
+
+static inline int8_t h2(size_t hash)
+{
+	return hash & 0x7f;
+}
+
+static inline size_t max_load(size_t cap)
+{
+	/* The load factor is 0.875. */
+	return cap - (cap >> 3);
+}
+
+/*
+ * Every slot starts with the full hash of its key, followed by the key and
+ * the value. Rehashing reads the stored hash instead of calling K->hash, and
+ * probes compare it before calling K->cmp.
+ */
+static inline size_t *hash_at(struct mcc_hash_map *self,
+			      struct mcc_hash_table *t, size_t index)
+{
+	return (size_t *)(t->slots + index * self->slot_size);
+}
+
+static inline uint8_t *key_at(struct mcc_hash_map *self,
+			      struct mcc_hash_table *t, size_t index)
+{
+	return (uint8_t *)(hash_at(self, t, index) + 1);
+}
+
+static inline uint8_t *value_at(struct mcc_hash_map *self,
+				struct mcc_hash_table *t, size_t index)
+{
+	return key_at(self, t, index) + self->val_offset;
+}
+
+static inline struct mcc_pair *bind_pair(struct mcc_hash_map *self,
+					 struct mcc_hash_table *t,
+					 struct mcc_pair *pair, size_t index)
+{
+	pair->key = key_at(self, t, index);
+	pair->value = value_at(self, t, index);
+	return pair;
+}
+
+static void destroy_slot(struct mcc_hash_map *self, struct mcc_hash_table *t,
+			 size_t index)
+{
+	if (self->K->drop)
+		self->K->drop(key_at(self, t, index));
+
+	if (self->V->drop)
+		self->V->drop(value_at(self, t, index));
+}
+
+/*
+ * Return the index of the slot holding the key, or t->cap if there is no such
+ * slot.
+ */
+static size_t find_slot(struct mcc_hash_map *self, struct mcc_hash_table *t,
+			const void *key, size_t hash)
+{
+	size_t mask = t->cap / GROUP_WIDTH - 1;
+	size_t group = h1(hash) & mask;
+	size_t step = 0, index;
+	const int8_t *ctrl;
+	group_mask match;
+
+	while (true) {
+		ctrl = t->ctrl + group * GROUP_WIDTH;
+		for (match = match_h2(ctrl, h2(hash)); match;
+		     match &= match - 1) {
+			index = group * GROUP_WIDTH + lowest_bit(match);
+			if (*hash_at(self, t, index) == hash &&
+			    !self->K->cmp(key, key_at(self, t, index)))
+				return index;
+		}
+
+		if (match_empty(ctrl))
+			return t->cap;
+
+		/* Triangular probing visits every group exactly once. */
+		group = (group + ++step) & mask;
+	}
+}
+
+/*
+ * Return the index of the first empty or deleted slot in the probe sequence of
+ * the hash.
+ */
+static size_t find_insert_slot(struct mcc_hash_table *t, size_t hash)
+{
+	size_t mask = t->cap / GROUP_WIDTH - 1;
+	size_t group = h1(hash) & mask;
+	size_t step = 0;
+	const int8_t *ctrl;
+	group_mask free_slots;
+
+	while (true) {
+		ctrl = t->ctrl + group * GROUP_WIDTH;
+		free_slots = match_free(ctrl);
+		if (free_slots)
+			return group * GROUP_WIDTH + lowest_bit(free_slots);
+
+		group = (group + ++step) & mask;
+	}
+}
+
+/*
+ * Find the key in the table and, during an incremental resize, in the old
+ * table. Return the table holding the key, or NULL.
+ */
+static struct mcc_hash_table *lookup(struct mcc_hash_map *self,
+				     const void *key, size_t hash,
+				     size_t *index)
+{
+	*index = find_slot(self, &self->table, key, hash);
+	if (*index != self->table.cap)
+		return &self->table;
+
+	if (self->old.cap) {
+		*index = find_slot(self, &self->old, key, hash);
+		if (*index != self->old.cap)
+			return &self->old;
+	}
+
+	return NULL;
+}
+
+static void erase_slot(struct mcc_hash_table *t, size_t index)
+{
+	size_t group = index & ~(size_t)(GROUP_WIDTH - 1);
+
+	/*
+	 * A probe never walks past a group that still has an empty slot, so the
+	 * slot can become empty again instead of a tombstone.
+	 */
+	if (match_empty(t->ctrl + group)) {
+		t->ctrl[index] = CTRL_EMPTY;
+		t->growth_left++;
+	} else {
+		t->ctrl[index] = CTRL_DELETED;
+	}
+}
+
+static int allocate_table(struct mcc_hash_map *self, struct mcc_hash_table *t,
+			  size_t cap)
+{
+	t->slots = mem_alloc(&self->allocator, cap * self->slot_size + cap);
+	if (!t->slots)
+		return CANNOT_ALLOCATE_MEMORY;
+
+	t->ctrl = (int8_t *)(t->slots + cap * self->slot_size);
+	memset(t->ctrl, CTRL_EMPTY, cap);
+	t->cap = cap;
+	t->growth_left = max_load(cap);
+	return OK;
+}
+
+/* Move a full slot of another table into self->table. */
+static void move_slot(struct mcc_hash_map *self, struct mcc_hash_table *from,
+		      size_t i)
+{
+	size_t hash = *hash_at(self, from, i);
+	size_t index = find_insert_slot(&self->table, hash);
+
+	if (self->table.ctrl[index] == CTRL_EMPTY)
+		self->table.growth_left--;
+
+	memcpy(hash_at(self, &self->table, index), hash_at(self, from, i),
+	       self->slot_size);
+	self->table.ctrl[index] = h2(hash);
+}
+
+/* Move up to n slots of the old table, and free it once it is drained. */
+static void migrate(struct mcc_hash_map *self, size_t n)
+{
+	size_t end;
+
+	if (!self->old.cap)
+		return;
+
+	end = self->old.cap - self->migrated > n ? self->migrated + n
+						 : self->old.cap;
+	for (; self->migrated < end; self->migrated++) {
+		if (self->old.ctrl[self->migrated] < 0)
+			continue;
+		move_slot(self, &self->old, self->migrated);
+		erase_slot(&self->old, self->migrated);
 	}
 
-	return entry;
+	if (self->migrated == self->old.cap) {
+		mem_free(&self->allocator, self->old.slots);
+		memset(&self->old, 0, sizeof(struct mcc_hash_table));
+		self->migrated = 0;
+	}
+}
+
+static int rehash(struct mcc_hash_map *self, size_t new_cap)
+{
+	struct mcc_hash_table from = self->table;
+	size_t i;
+
+	if (allocate_table(self, &self->table, new_cap)) {
+		self->table = from;
+		return CANNOT_ALLOCATE_MEMORY;
+	}
+
+	for (i = 0; i < from.cap; i++) {
+		if (from.ctrl[i] >= 0)
+			move_slot(self, &from, i);
+	}
+
+	mem_free(&self->allocator, from.slots);
+	return OK;
+}
+
+/*
+ * Start an incremental resize: the current table becomes the old table and
+ * is drained by the following operations.
+ */
+static int begin_resize(struct mcc_hash_map *self, size_t new_cap)
+{
+	self->old = self->table;
+	self->migrated = 0;
+
+	if (allocate_table(self, &self->table, new_cap)) {
+		self->table = self->old;
+		memset(&self->old, 0, sizeof(struct mcc_hash_table));
+		return CANNOT_ALLOCATE_MEMORY;
+	}
+
+	return OK;
+}
+
+static size_t capacity_for(size_t n)
+{
+	size_t cap = GROUP_WIDTH;
+
+	while (max_load(cap) < n)
+		cap <<= 1;
+
+	return cap;
+}
+
+/*
+ * Make room for one more element. Tombstones are purged in place when they
+ * take up a large part of the table, otherwise the table grows.
+ */
+static int rehash_and_grow_if_necessary(struct mcc_hash_map *self)
+{
+	size_t new_cap;
+
+	/*
+	 * Each operation drains MIGRATE_STEP old slots, so the new table
+	 * normally has room for the inserts made during a resize. If it
+	 * does not, finish the resize before starting another one.
+	 */
+	migrate(self, self->old.cap);
+
+	new_cap = self->table.cap;
+	if (self->len > max_load(new_cap) >> 1)
+		new_cap <<= 1;
+
+	if (self->incremental)
+		return begin_resize(self, new_cap);
+	else
+		return rehash(self, new_cap);
 }
 
 struct mcc_hash_map *mcc_hash_map_new(const struct mcc_object_interface *K,
 				      const struct mcc_object_interface *V)
 {
+	return mcc_hash_map_new_with_allocator(NULL, K, V);
+}
+
+struct mcc_hash_map *
+mcc_hash_map_new_in(struct mcc_arena *arena,
+		    const struct mcc_object_interface *K,
+		    const struct mcc_object_interface *V)
+{
+	return mcc_hash_map_new_with_allocator(mcc_arena_allocator(arena), K,
+					       V);
+}
+
+struct mcc_hash_map *
+mcc_hash_map_new_with_allocator(const struct mcc_allocator *allocator,
+				const struct mcc_object_interface *K,
+				const struct mcc_object_interface *V)
+{
+	struct mcc_allocator a;
 	struct mcc_hash_map *self;
 
-	if (!K || !V)
+	if (!K || !V || !allocator_init(&a, allocator))
 		return NULL;
 
-	self = calloc(1, sizeof(struct mcc_hash_map));
+	self = mem_calloc(&a, sizeof(struct mcc_hash_map));
 	if (!self)
 		return NULL;
 
-	self->bkts = calloc(8, sizeof(struct mcc_hash_map_entry *));
-	if (!self->bkts) {
-		free(self);
+	self->allocator = a;
+	self->val_offset = round_up(K->size, align_of(V->size));
+	self->slot_size = round_up(sizeof(size_t) + self->val_offset + V->size,
+				   sizeof(size_t));
+	self->K = K;
+	self->V = V;
+	if (allocate_table(self, &self->table, GROUP_WIDTH)) {
+		mem_free(&a, self);
 		return NULL;
 	}
 
-	self->cap = 8;
-	self->K = K;
-	self->V = V;
 	return self;
 }
 
@@ -111,127 +519,180 @@ void mcc_hash_map_drop(struct mcc_hash_map *self)
 
 	while (self->iters) {
 		next = self->iters->next;
-		free(self->iters);
+		mem_free(&self->allocator, self->iters);
 		self->iters = next;
 	}
-	mcc_hash_map_clear(self);
-	free(self->bkts);
-	free(self);
+	/* Memory that is not freed need not be cleared either. */
+	if (allocator_frees(&self->allocator) || self->K->drop ||
+	    self->V->drop)
+		mcc_hash_map_clear(self);
+	mem_free(&self->allocator, self->table.slots);
+	mem_free(&self->allocator, self);
+}
+
+int mcc_hash_map_incremental_resize(struct mcc_hash_map *self, bool enable)
+{
+	if (!self)
+		return INVALID_ARGUMENTS;
+
+	self->incremental = enable;
+	if (!enable)
+		migrate(self, self->old.cap);
+	return OK;
 }
 
 int mcc_hash_map_reserve(struct mcc_hash_map *self, size_t additional)
 {
-	size_t min_capacity, new_capacity, i, h;
-	struct mcc_hash_map_entry **new_buckets, *curr, *next;
+	size_t new_cap;
 
 	if (!self)
 		return INVALID_ARGUMENTS;
 
-	min_capacity = self->len + additional;
-	if (self->cap >= min_capacity)
+	migrate(self, self->old.cap);
+	if (self->table.growth_left >= additional)
 		return OK;
 
-	new_capacity = self->cap << 1;
-	while (new_capacity < min_capacity)
-		new_capacity <<= 1;
-
-	new_buckets = calloc(new_capacity, sizeof(struct mcc_hash_map_entry *));
-	if (!new_buckets)
-		return CANNOT_ALLOCATE_MEMORY;
+	new_cap = capacity_for(self->len + additional);
+	if (new_cap < self->table.cap)
+		new_cap = self->table.cap;
 
-	for (i = 0; i < self->cap; i++) {
-		for (curr = self->bkts[i]; curr; curr = next) {
-			next = curr->next;
-			h = self->K->hash(curr->pair.key) & (new_capacity - 1);
-			curr->next = new_buckets[h];
-			new_buckets[h] = curr;
-		}
-	}
+	return rehash(self, new_cap);
+}
 
-	free(self->bkts);
-	self->bkts = new_buckets;
-	self->cap = new_capacity;
-	return OK;
+size_t mcc_hash_map_hash(struct mcc_hash_map *self, const void *key)
+{
+	return !self || !key ? 0 : mix(self->K->hash(key));
 }
 
 int mcc_hash_map_insert(struct mcc_hash_map *self, const void *key,
 			const void *value)
 {
-	struct mcc_hash_map_entry **entry;
+	if (!self || !key || !value)
+		return INVALID_ARGUMENTS;
+
+	return mcc_hash_map_insert_hashed(self, key, mix(self->K->hash(key)),
+					  value);
+}
+
+int mcc_hash_map_insert_hashed(struct mcc_hash_map *self, const void *key,
+			       size_t hash, const void *value)
+{
+	struct mcc_hash_table *t;
+	size_t index;
 
 	if (!self || !key || !value)
 		return INVALID_ARGUMENTS;
 
-	entry = get_entry(self, key);
-	if (*entry) { /* Just update the value. */
+	migrate(self, MIGRATE_STEP);
+
+	t = lookup(self, key, hash, &index);
+	if (t) { /* Just update the value. */
 		/* When used as mcc_hash_set, the size of V is 0. */
 		if (!self->V->size)
 			return OK;
 
 		if (self->V->drop)
-			self->V->drop((*entry)->pair.value);
+			self->V->drop(value_at(self, t, index));
 
-		memcpy((*entry)->pair.value, value, self->V->size);
+		memcpy(value_at(self, t, index), value, self->V->size);
 		return OK;
-	} else { /* Try creating a new entry. */
-		*entry = create_entry(key, self->K->size, value, self->V->size);
-		if (!(*entry))
-			return CANNOT_ALLOCATE_MEMORY;
+	}
 
-		self->len++;
+	t = &self->table;
+	index = find_insert_slot(t, hash);
+	if (!t->growth_left && t->ctrl[index] != CTRL_DELETED) {
+		if (rehash_and_grow_if_necessary(self))
+			return CANNOT_ALLOCATE_MEMORY;
+		index = find_insert_slot(t, hash);
+	}
 
-		/* The load factor is 0.75. */
-		if (self->len >= (self->cap * 3) >> 2)
-			mcc_hash_map_reserve(self, self->len);
+	/* Reusing a tombstone does not consume the growth budget. */
+	if (t->ctrl[index] == CTRL_EMPTY)
+		t->growth_left--;
 
-		return OK;
-	}
+	*hash_at(self, t, index) = hash;
+	memcpy(key_at(self, t, index), key, self->K->size);
+	memcpy(value_at(self, t, index), value, self->V->size);
+	t->ctrl[index] = h2(hash);
+	self->len++;
+	return OK;
 }
 
 void mcc_hash_map_remove(struct mcc_hash_map *self, const void *key)
 {
-	struct mcc_hash_map_entry **curr, *tmp;
+	if (self && key)
+		mcc_hash_map_remove_hashed(self, key, mix(self->K->hash(key)));
+}
+
+void mcc_hash_map_remove_hashed(struct mcc_hash_map *self, const void *key,
+				size_t hash)
+{
+	struct mcc_hash_table *t;
+	size_t index;
 
 	if (!self || !key)
 		return;
 
-	curr = get_entry(self, key);
-	if (*curr) {
-		tmp = *curr;
-		*curr = (*curr)->next;
-		destroy_entry(tmp, self->K->drop, self->V->drop);
+	migrate(self, MIGRATE_STEP);
+
+	t = lookup(self, key, hash, &index);
+	if (!t)
+		return;
+
+	destroy_slot(self, t, index);
+	erase_slot(t, index);
+	self->len--;
+}
+
+static void clear_table(struct mcc_hash_map *self, struct mcc_hash_table *t)
+{
+	if (self->K->drop || self->V->drop) {
+		for (size_t i = 0; i < t->cap; i++) {
+			if (t->ctrl[i] >= 0)
+				destroy_slot(self, t, i);
+		}
 	}
+
+	memset(t->ctrl, CTRL_EMPTY, t->cap);
+	t->growth_left = max_load(t->cap);
 }
 
 void mcc_hash_map_clear(struct mcc_hash_map *self)
 {
-	struct mcc_hash_map_entry *curr, *next;
-
-	if (!self || !self->len)
+	if (!self)
 		return;
 
-	for (size_t i = 0; i < self->cap; i++) {
-		curr = self->bkts[i];
-		while (curr) {
-			next = curr->next;
-			destroy_entry(curr, self->K->drop, self->V->drop);
-			curr = next;
-		}
-		self->bkts[i] = NULL;
+	if (self->old.cap) {
+		clear_table(self, &self->old);
+		mem_free(&self->allocator, self->old.slots);
+		memset(&self->old, 0, sizeof(struct mcc_hash_table));
+		self->migrated = 0;
 	}
+
+	clear_table(self, &self->table);
 	self->len = 0;
 }
 
 int mcc_hash_map_get(struct mcc_hash_map *self, const void *key, void **ref)
 {
-	struct mcc_hash_map_entry **curr;
+	if (!self || !key || !ref)
+		return INVALID_ARGUMENTS;
+
+	return mcc_hash_map_get_hashed(self, key, mix(self->K->hash(key)), ref);
+}
+
+int mcc_hash_map_get_hashed(struct mcc_hash_map *self, const void *key,
+			    size_t hash, void **ref)
+{
+	struct mcc_hash_table *t;
+	size_t index;
 
 	if (!self || !key || !ref)
 		return INVALID_ARGUMENTS;
 
-	curr = get_entry(self, key);
-	if (*curr) {
-		*ref = (*curr)->pair.value;
+	t = lookup(self, key, hash, &index);
+	if (t) {
+		*ref = value_at(self, t, index);
 		return OK;
 	} else {
 		return NONE;
@@ -241,23 +702,88 @@ int mcc_hash_map_get(struct mcc_hash_map *self, const void *key, void **ref)
 int mcc_hash_map_get_key_value(struct mcc_hash_map *self, const void *key,
 			       struct mcc_pair **ref)
 {
-	struct mcc_hash_map_entry **curr;
+	struct mcc_hash_table *t;
+	size_t index;
 
 	if (!self || !key || !ref)
 		return INVALID_ARGUMENTS;
 
-	curr = get_entry(self, key);
-	if (*curr) {
-		*ref = &(*curr)->pair;
+	t = lookup(self, key, mix(self->K->hash(key)), &index);
+	if (t) {
+		*ref = bind_pair(self, t, &self->pair, index);
 		return OK;
 	} else {
 		return NONE;
 	}
 }
 
+/*
+ * Looks up the keys in three passes per batch. The first hashes every key and
+ * prefetches its first control group, the second matches the groups and
+ * prefetches the slot of the first candidate, and only the third compares
+ * keys, by which time most of the lines it touches have arrived.
+ */
+static void lookup_many(struct mcc_hash_map *self, const uint8_t *keys,
+			size_t n, void **refs, bool *found)
+{
+	size_t hashes[PREFETCH_BATCH], mask, group, index, i, j, m;
+	struct mcc_hash_table *t = &self->table, *hit;
+	const uint8_t *key;
+	group_mask match;
+
+	for (i = 0; i < n; i += m) {
+		mask = t->cap / GROUP_WIDTH - 1;
+		m = n - i < PREFETCH_BATCH ? n - i : PREFETCH_BATCH;
+		for (j = 0; j < m; j++) {
+			key = keys + (i + j) * self->K->size;
+			hashes[j] = mix(self->K->hash(key));
+			group = (h1(hashes[j]) & mask) * GROUP_WIDTH;
+			__builtin_prefetch(t->ctrl + group);
+		}
+
+		for (j = 0; j < m; j++) {
+			group = (h1(hashes[j]) & mask) * GROUP_WIDTH;
+			match = match_h2(t->ctrl + group, h2(hashes[j]));
+			if (match)
+				__builtin_prefetch(hash_at(self, t, group +
+							   lowest_bit(match)));
+		}
+
+		for (j = 0; j < m; j++) {
+			key = keys + (i + j) * self->K->size;
+			hit = lookup(self, key, hashes[j], &index);
+			if (refs)
+				refs[i + j] = hit ? value_at(self, hit, index) :
+						    NULL;
+			if (found)
+				found[i + j] = hit != NULL;
+		}
+	}
+}
+
+int mcc_hash_map_get_many(struct mcc_hash_map *self, const void *keys,
+			  size_t n, void **refs)
+{
+	if (!self || (n && (!keys || !refs)))
+		return INVALID_ARGUMENTS;
+
+	lookup_many(self, keys, n, refs, NULL);
+	return OK;
+}
+
+int hash_map_contains_many(struct mcc_hash_map *self, const void *keys,
+			   size_t n, bool *found)
+{
+	if (!self || (n && (!keys || !found)))
+		return INVALID_ARGUMENTS;
+
+	lookup_many(self, keys, n, NULL, found);
+	return OK;
+}
+
 size_t mcc_hash_map_capacity(struct mcc_hash_map *self)
 {
-	return !self ? 0 : self->cap;
+	return !self ? 0 : self->table.cap;
 }
 
 size_t mcc_hash_map_len(struct mcc_hash_map *self)
@@ -270,20 +796,94 @@ bool mcc_hash_map_is_empty(struct mcc_hash_map *self)
 	return !self ? true : self->len == 0;
 }
 
-static void find_next_valid_entry(struct mcc_hash_map_iter *self)
+static int for_each_in_table(struct mcc_hash_map *self,
+			     struct mcc_hash_table *t, mcc_pair_visit_fn fn,
+			     void *ctx)
 {
-	if (self->curr && self->curr->next) {
-		self->curr = self->curr->next;
-		return;
+	struct mcc_pair pair;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < t->cap; i++) {
+		if (t->ctrl[i] < 0)
+			continue;
+		ret = fn(bind_pair(self, t, &pair, i), ctx);
+		if (ret)
+			return ret;
 	}
+	return OK;
+}
 
-	while (self->index < self->map->cap && !self->map->bkts[self->index])
-		self->index++;
+int mcc_hash_map_for_each(struct mcc_hash_map *self, mcc_pair_visit_fn fn,
+			  void *ctx)
+{
+	int ret;
 
-	if (self->index < self->map->cap)
-		self->curr = self->map->bkts[self->index++];
-	else
-		self->curr = NULL;
+	if (!self || !fn)
+		return INVALID_ARGUMENTS;
+
+	ret = for_each_in_table(self, &self->old, fn, ctx);
+	if (ret)
+		return ret;
+	return for_each_in_table(self, &self->table, fn, ctx);
+}
+
+static bool fold_table(struct mcc_hash_map *self, struct mcc_hash_table *t,
+		       mcc_pair_fold_fn fn, void *acc, size_t *n)
+{
+	struct mcc_pair pair;
+	size_t i;
+
+	for (i = 0; i < t->cap; i++) {
+		if (t->ctrl[i] < 0)
+			continue;
+		if (!fn(bind_pair(self, t, &pair, i), acc))
+			return false;
+		++*n;
+	}
+	return true;
+}
+
+size_t mcc_hash_map_fold(struct mcc_hash_map *self, mcc_pair_fold_fn fn,
+			 void *acc)
+{
+	size_t n = 0;
+
+	if (!self || !fn)
+		return 0;
+
+	if (fold_table(self, &self->old, fn, acc, &n))
+		fold_table(self, &self->table, fn, acc, &n);
+	return n;
+}
+
+/*
+ * Iterators walk the old table first and then the current one, as if their
+ * slots were laid out one after another.
+ */
+static inline struct mcc_hash_table *iter_table(struct mcc_hash_map_iter *self,
+						size_t *index)
+{
+	if (self->index < self->map->old.cap) {
+		*index = self->index;
+		return &self->map->old;
+	} else {
+		*index = self->index - self->map->old.cap;
+		return &self->map->table;
+	}
+}
+
+static void find_next_valid_entry(struct mcc_hash_map_iter *self)
+{
+	size_t end = self->map->old.cap + self->map->table.cap, index;
+	struct mcc_hash_table *t;
+
+	while (self->index < end) {
+		t = iter_table(self, &index);
+		if (t->ctrl[index] >= 0)
+			break;
+		self->index++;
+	}
 }
 
 struct mcc_hash_map_iter *mcc_hash_map_iter_new(struct mcc_hash_map *map)
@@ -300,7 +900,7 @@ struct mcc_hash_map_iter *mcc_hash_map_iter_new(struct mcc_hash_map *map)
 		self = self->next;
 	}
 
-	self = calloc(1, sizeof(struct mcc_hash_map_iter));
+	self = mem_calloc(&map->allocator, sizeof(struct mcc_hash_map_iter));
 	if (!self)
 		return NULL;
 
@@ -308,13 +908,26 @@ struct mcc_hash_map_iter *mcc_hash_map_iter_new(struct mcc_hash_map *map)
 	map->iters = self;
 	self->map = map;
 reset_iterator:
-	self->curr = NULL;
 	self->index = 0;
 	self->in_use = true;
 	find_next_valid_entry(self);
 	return self;
 }
 
+int mcc_hash_map_iter_init(struct mcc_hash_map_iter *self,
+			   struct mcc_hash_map *map)
+{
+	if (!self || !map)
+		return INVALID_ARGUMENTS;
+
+	self->next = NULL;
+	self->map = map;
+	self->index = 0;
+	self->in_use = false;
+	find_next_valid_entry(self);
+	return OK;
+}
+
 void mcc_hash_map_iter_drop(struct mcc_hash_map_iter *self)
 {
 	if (self)
@@ -324,10 +937,44 @@ void mcc_hash_map_iter_drop(struct mcc_hash_map_iter *self)
 bool mcc_hash_map_iter_next(struct mcc_hash_map_iter *self,
 			    struct mcc_pair **ref)
 {
-	if (!self || !ref || !self->curr)
+	struct mcc_hash_table *t;
+	size_t index;
+
+	if (!self || !ref ||
+	    self->index >= self->map->old.cap + self->map->table.cap)
 		return false;
 
-	*ref = &self->curr->pair;
+	t = iter_table(self, &index);
+	*ref = bind_pair(self->map, t, &self->pair, index);
+	self->index++;
 	find_next_valid_entry(self);
 	return true;
 }
+
+/*
+ * Scans the control bytes of each table directly instead of going through
+ * iter_table and find_next_valid_entry for every entry.
+ */
+size_t mcc_hash_map_iter_next_n(struct mcc_hash_map_iter *self,
+				struct mcc_pair *pairs, size_t n)
+{
+	struct mcc_hash_table *t;
+	size_t i = 0, index, base;
+
+	if (!self || !pairs)
+		return 0;
+
+	while (i < n &&
+	       self->index < self->map->old.cap + self->map->table.cap) {
+		t = iter_table(self, &index);
+		base = self->index - index;
+		for (; i < n && index < t->cap; index++) {
+			if (t->ctrl[index] >= 0)
+				bind_pair(self->map, t, &pairs[i++], index);
+		}
+		self->index = base + index;
+	}
+
+	find_next_valid_entry(self);
+	return i;
+}
@@ -0,0 +1,10 @@
+#ifndef _HASH_MAP_H
+#define _HASH_MAP_H
+
+#include "mcc_hash_map.h"
+
+/* Like mcc_hash_map_get_many, but only reports which keys exist. */
+int hash_map_contains_many(struct mcc_hash_map *self, const void *keys,
+			   size_t n, bool *found);
+
+#endif /* _HASH_MAP_H */
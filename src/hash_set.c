@@ -1,4 +1,5 @@
-#include "mcc_hash_map.h"
+#include "hash_map.h"
+#include "mcc_err.h"
 #include "mcc_hash_set.h"
 
 #define HASH_MAP(PTR) ((struct mcc_hash_map *)(PTR))
@@ -6,6 +7,9 @@
 #define HASH_MAP_ITER(PTR) ((struct mcc_hash_map_iter *)(PTR))
 #define HASH_SET_ITER(PTR) ((struct mcc_hash_set_iter *)(PTR))
 
+/* Number of entries next_n takes from the map at a time. */
+#define ITER_BATCH 32
+
 static const struct mcc_object_interface none = {
 	.size = 0,
 	.drop = (mcc_drop_fn)0,
@@ -18,11 +22,29 @@ struct mcc_hash_set *mcc_hash_set_new(const struct mcc_object_interface *T)
 	return HASH_SET(mcc_hash_map_new(T, &none));
 }
 
+struct mcc_hash_set *mcc_hash_set_new_in(struct mcc_arena *arena,
+					 const struct mcc_object_interface *T)
+{
+	return HASH_SET(mcc_hash_map_new_in(arena, T, &none));
+}
+
+struct mcc_hash_set *
+mcc_hash_set_new_with_allocator(const struct mcc_allocator *allocator,
+				const struct mcc_object_interface *T)
+{
+	return HASH_SET(mcc_hash_map_new_with_allocator(allocator, T, &none));
+}
+
 void mcc_hash_set_drop(struct mcc_hash_set *self)
 {
 	mcc_hash_map_drop(HASH_MAP(self));
 }
 
+int mcc_hash_set_incremental_resize(struct mcc_hash_set *self, bool enable)
+{
+	return mcc_hash_map_incremental_resize(HASH_MAP(self), enable);
+}
+
 int mcc_hash_set_reserve(struct mcc_hash_set *self, size_t additional)
 {
 	return mcc_hash_map_reserve(HASH_MAP(self), additional);
@@ -55,6 +77,12 @@ int mcc_hash_set_get(struct mcc_hash_set *self, const void *value,
 	return err;
 }
 
+int mcc_hash_set_contains_many(struct mcc_hash_set *self, const void *values,
+			       size_t n, bool *found)
+{
+	return hash_map_contains_many(HASH_MAP(self), values, n, found);
+}
+
 size_t mcc_hash_set_capacity(struct mcc_hash_set *self)
 {
 	return mcc_hash_map_capacity(HASH_MAP(self));
@@ -75,6 +103,12 @@ struct mcc_hash_set_iter *mcc_hash_set_iter_new(struct mcc_hash_set *set)
 	return HASH_SET_ITER(mcc_hash_map_iter_new(HASH_MAP(set)));
 }
 
+int mcc_hash_set_iter_init(struct mcc_hash_set_iter *self,
+			   struct mcc_hash_set *set)
+{
+	return mcc_hash_map_iter_init(HASH_MAP_ITER(self), HASH_MAP(set));
+}
+
 void mcc_hash_set_iter_drop(struct mcc_hash_set_iter *self)
 {
 	mcc_hash_map_iter_drop(HASH_MAP_ITER(self));
@@ -91,3 +125,66 @@ bool mcc_hash_set_iter_next(struct mcc_hash_set_iter *self, const void **ref)
 		return false;
 	}
 }
+
+size_t mcc_hash_set_iter_next_n(struct mcc_hash_set_iter *self,
+				const void **refs, size_t n)
+{
+	struct mcc_pair pairs[ITER_BATCH];
+	size_t i, m, total = 0;
+
+	if (!refs)
+		return 0;
+
+	while (total < n) {
+		m = n - total < ITER_BATCH ? n - total : ITER_BATCH;
+		m = mcc_hash_map_iter_next_n(HASH_MAP_ITER(self), pairs, m);
+		for (i = 0; i < m; i++)
+			refs[total + i] = pairs[i].key;
+		total += m;
+		if (m < ITER_BATCH)
+			break;
+	}
+	return total;
+}
+
+struct visit_values {
+	mcc_const_visit_fn fn;
+	void *ctx;
+};
+
+static int visit_value(struct mcc_pair *pair, void *ctx)
+{
+	struct visit_values *v = ctx;
+
+	return v->fn(pair->key, v->ctx);
+}
+
+int mcc_hash_set_for_each(struct mcc_hash_set *self, mcc_const_visit_fn fn,
+			  void *ctx)
+{
+	struct visit_values v = {fn, ctx};
+
+	if (!fn)
+		return INVALID_ARGUMENTS;
+
+	return mcc_hash_map_for_each(HASH_MAP(self), visit_value, &v);
+}
+
+struct fold_values {
+	mcc_fold_fn fn;
+	void *acc;
+};
+
+static bool fold_value(const struct mcc_pair *pair, void *acc)
+{
+	struct fold_values *f = acc;
+
+	return f->fn(pair->key, f->acc);
+}
+
+size_t mcc_hash_set_fold(struct mcc_hash_set *self, mcc_fold_fn fn, void *acc)
+{
+	struct fold_values f = {fn, acc};
+
+	return fn ? mcc_hash_map_fold(HASH_MAP(self), fold_value, &f) : 0;
+}
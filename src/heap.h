@@ -0,0 +1,7 @@
+#include "mcc_vector.h"
+
+void sift_down(struct mcc_vector *self, size_t i);
+
+void sift_up(struct mcc_vector *self, size_t i);
+
+void heapify(struct mcc_vector *self);
@@ -1,5 +1,8 @@
+#include "alloc.h"
 #include "mcc_err.h"
 #include "mcc_list.h"
+#include "node_pool.h"
+#include "sort.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -14,19 +17,13 @@ struct mcc_list_node {
 	};
 };
 
-struct mcc_list_iter {
-	struct mcc_list_iter *next;
-	struct mcc_list *list;
-	struct mcc_list_node *curr;
-	bool in_use;
-};
-
 struct mcc_list {
 	const struct mcc_object_interface *T;
 	struct mcc_list_iter *iters;
 	struct mcc_list_node *head;
 	struct mcc_list_node *tail;
 	size_t len;
+	struct node_pool pool;
 };
 
 static inline void *value_of(struct mcc_list_node *self)
@@ -34,23 +31,26 @@ static inline void *value_of(struct mcc_list_node *self)
 	return (uint8_t *)self + sizeof(struct mcc_list_node);
 }
 
-static struct mcc_list_node *create_node(const void *value, size_t size)
+static struct mcc_list_node *create_node(struct mcc_list *self,
+					 const void *value)
 {
 	struct mcc_list_node *node;
 
-	node = calloc(1, sizeof(struct mcc_list_node) + size);
+	node = node_pool_alloc(&self->pool);
 	if (!node)
 		return NULL;
 
-	memcpy(value_of(node), value, size);
+	node->prev = NULL;
+	node->next = NULL;
+	memcpy(value_of(node), value, self->T->size);
 	return node;
 }
 
-static void destroy_node(struct mcc_list_node *node, const mcc_drop_fn drop)
+static void destroy_node(struct mcc_list *self, struct mcc_list_node *node)
 {
-	if (drop)
-		drop(value_of(node));
-	free(node);
+	if (self->T->drop)
+		self->T->drop(value_of(node));
+	node_pool_free(&self->pool, node);
 }
 
 static struct mcc_list_node *get_nth(struct mcc_list *self, size_t index)
@@ -78,7 +78,7 @@ static int insert_element(struct mcc_list *self, size_t index,
 
 	curr = get_nth(self, index);
 
-	new_node = create_node(value, self->T->size);
+	new_node = create_node(self, value);
 	if (!new_node)
 		return CANNOT_ALLOCATE_MEMORY;
 
@@ -100,22 +100,38 @@ static void remove_element(struct mcc_list *self, size_t index)
 	curr->next->prev = curr->prev;
 	curr->prev->next = curr->next;
 
-	destroy_node(curr, self->T->drop);
+	destroy_node(self, curr);
 	self->len--;
 }
 
 struct mcc_list *mcc_list_new(const struct mcc_object_interface *T)
 {
+	return mcc_list_new_with_allocator(NULL, T);
+}
+
+struct mcc_list *mcc_list_new_in(struct mcc_arena *arena,
+				 const struct mcc_object_interface *T)
+{
+	return mcc_list_new_with_allocator(mcc_arena_allocator(arena), T);
+}
+
+struct mcc_list *
+mcc_list_new_with_allocator(const struct mcc_allocator *allocator,
+			    const struct mcc_object_interface *T)
+{
+	struct mcc_allocator a;
 	struct mcc_list *self;
 
-	if (!T)
+	if (!T || !allocator_init(&a, allocator))
 		return NULL;
 
-	self = calloc(1, sizeof(struct mcc_list));
+	self = mem_calloc(&a, sizeof(struct mcc_list));
 	if (!self)
 		return NULL;
 
 	self->T = T;
+	node_pool_init(&self->pool, sizeof(struct mcc_list_node) + T->size,
+		       &a);
 	return self;
 }
 
@@ -126,13 +142,16 @@ void mcc_list_drop(struct mcc_list *self)
 	if (!self)
 		return;
 
-	mcc_list_clear(self);
+	/* Memory that is not freed need not be cleared either. */
+	if (allocator_frees(&self->pool.allocator) || self->T->drop)
+		mcc_list_clear(self);
+
 	while (self->iters) {
 		tmp = self->iters->next;
-		free(self->iters);
+		mem_free(&self->pool.allocator, self->iters);
 		self->iters = tmp;
 	}
-	free(self);
+	mem_free(&self->pool.allocator, self);
 }
 
 int mcc_list_push_front(struct mcc_list *self, const void *value)
@@ -142,7 +161,7 @@ int mcc_list_push_front(struct mcc_list *self, const void *value)
 	if (!self || !value)
 		return INVALID_ARGUMENTS;
 
-	new_node = create_node(value, self->T->size);
+	new_node = create_node(self, value);
 	if (!new_node)
 		return CANNOT_ALLOCATE_MEMORY;
 
@@ -165,7 +184,7 @@ int mcc_list_push_back(struct mcc_list *self, const void *value)
 	if (!self || !value)
 		return INVALID_ARGUMENTS;
 
-	new_node = create_node(value, self->T->size);
+	new_node = create_node(self, value);
 	if (!new_node)
 		return CANNOT_ALLOCATE_MEMORY;
 
@@ -194,7 +213,7 @@ void mcc_list_pop_front(struct mcc_list *self)
 		self->head->prev = NULL;
 	self->len--;
 
-	destroy_node(tmp, self->T->drop);
+	destroy_node(self, tmp);
 }
 
 void mcc_list_pop_back(struct mcc_list *self)
@@ -210,7 +229,7 @@ void mcc_list_pop_back(struct mcc_list *self)
 		self->tail->next = NULL;
 	self->len--;
 
-	destroy_node(tmp, self->T->drop);
+	destroy_node(self, tmp);
 }
 
 int mcc_list_insert(struct mcc_list *self, size_t index, const void *value)
@@ -249,10 +268,12 @@ void mcc_list_clear(struct mcc_list *self)
 
 	while (self->head) {
 		self->tail = self->head->next;
-		destroy_node(self->head, self->T->drop);
+		destroy_node(self, self->head);
 		self->head = self->tail;
 		self->len--;
 	}
+	if (allocator_frees(&self->pool.allocator))
+		node_pool_release(&self->pool);
 }
 
 int mcc_list_front(struct mcc_list *self, void **ref)
@@ -289,29 +310,6 @@ bool mcc_list_is_empty(struct mcc_list *self)
 	return !self ? true : self->len == 0;
 }
 
-static struct mcc_list_node *split(struct mcc_list_node *head)
-{
-	struct mcc_list_node *prev, *slow, *fast;
-
-	if (!head || !head->next)
-		return NULL;
-
-	prev = head;
-	slow = head->next;
-	fast = head->next->next;
-
-	while (fast && fast->next) {
-		prev = slow;
-		slow = slow->next;
-		fast = fast->next->next;
-	}
-
-	prev->next = NULL;
-	slow->prev = NULL;
-
-	return slow;
-}
-
 static void merge(struct mcc_list_node *a, struct mcc_list_node *b,
 		  struct mcc_list_node *result, mcc_compare_fn cmp)
 {
@@ -356,28 +354,72 @@ static void merge(struct mcc_list_node *a, struct mcc_list_node *b,
 	}
 }
 
-static void merge_sort(struct mcc_list_node *head, struct mcc_list_node *result,
+struct sorted_run {
+	struct mcc_list_node nodes; /* head and tail */
+	size_t base;
+	size_t len;
+	int power;
+};
+
+/*
+ * Detaches the natural run at the front of *rest and returns its length. A
+ * strictly descending run is relinked in reverse, which keeps the sort stable.
+ */
+static size_t take_run(struct mcc_list_node **rest, struct mcc_list_node *run,
 		       mcc_compare_fn cmp)
 {
-	struct mcc_list_node *mid = NULL;
-	struct mcc_list_node left = {0};
-	struct mcc_list_node right = {0};
-
-	if (!head || !head->next) {
-		result->head = head;
-		result->tail = head;
-		return;
+	struct mcc_list_node *curr = *rest, *next = curr->next, *after;
+	size_t len = 1;
+
+	if (next && cmp(value_of(next), value_of(curr)) < 0) {
+		run->tail = curr;
+		curr->next = NULL;
+		do {
+			after = next->next;
+			next->next = curr;
+			curr->prev = next;
+			curr = next;
+			next = after;
+			len++;
+		} while (next && cmp(value_of(next), value_of(curr)) < 0);
+		curr->prev = NULL;
+		run->head = curr;
+	} else {
+		run->head = curr;
+		while (next && cmp(value_of(next), value_of(curr)) >= 0) {
+			curr = next;
+			next = next->next;
+			len++;
+		}
+		curr->next = NULL;
+		run->tail = curr;
 	}
 
-	mid = split(head);
-	merge_sort(head, &left, cmp);
-	merge_sort(mid, &right, cmp);
-	merge(&left, &right, result, cmp);
+	*rest = next;
+	return len;
 }
 
+static void merge_runs(struct sorted_run *a, struct sorted_run *b,
+		       mcc_compare_fn cmp)
+{
+	struct mcc_list_node merged = {0};
+
+	merge(&a->nodes, &b->nodes, &merged, cmp);
+	a->nodes = merged;
+	a->len += b->len;
+}
+
+/*
+ * Bottom-up natural merge sort: runs already present in the list are merged
+ * in the order given by the powersort policy, so a sorted list costs n - 1
+ * comparisons and no merge at all. The pending runs fit in a small fixed
+ * stack since their powers strictly increase from its bottom to its top.
+ */
 int mcc_list_sort(struct mcc_list *self)
 {
-	struct mcc_list_node sorted = {0};
+	struct sorted_run runs[sizeof(size_t) * 8 + 2], run;
+	struct mcc_list_node *rest;
+	size_t n = 0, base = 0;
 
 	if (!self)
 		return INVALID_ARGUMENTS;
@@ -385,12 +427,67 @@ int mcc_list_sort(struct mcc_list *self)
 	if (self->len <= 1)
 		return OK;
 
-	merge_sort(self->head, &sorted, self->T->cmp);
-	self->head = sorted.head;
-	self->tail = sorted.tail;
+	for (rest = self->head; rest; base += run.len) {
+		run.nodes = (struct mcc_list_node){0};
+		run.len = take_run(&rest, &run.nodes, self->T->cmp);
+		run.base = base;
+
+		if (n) {
+			run.power = run_power(runs[n - 1].base,
+					      runs[n - 1].len, run.len,
+					      self->len);
+			while (n > 1 && runs[n - 2].power > run.power) {
+				merge_runs(&runs[n - 2], &runs[n - 1],
+					   self->T->cmp);
+				n--;
+			}
+			runs[n - 1].power = run.power;
+		}
+		runs[n++] = run;
+	}
+
+	while (n > 1) {
+		merge_runs(&runs[n - 2], &runs[n - 1], self->T->cmp);
+		n--;
+	}
+
+	self->head = runs[0].nodes.head;
+	self->tail = runs[0].nodes.tail;
+	self->head->prev = NULL;
+	return OK;
+}
+
+int mcc_list_for_each(struct mcc_list *self, mcc_visit_fn fn, void *ctx)
+{
+	struct mcc_list_node *node;
+	int ret;
+
+	if (!self || !fn)
+		return INVALID_ARGUMENTS;
+
+	for (node = self->head; node; node = node->next) {
+		ret = fn(value_of(node), ctx);
+		if (ret)
+			return ret;
+	}
 	return OK;
 }
 
+size_t mcc_list_fold(struct mcc_list *self, mcc_fold_fn fn, void *acc)
+{
+	struct mcc_list_node *node;
+	size_t i = 0;
+
+	if (!self || !fn)
+		return 0;
+
+	for (node = self->head; node; node = node->next, i++) {
+		if (!fn(value_of(node), acc))
+			break;
+	}
+	return i;
+}
+
 struct mcc_list_iter *mcc_list_iter_new(struct mcc_list *list)
 {
 	struct mcc_list_iter *self;
@@ -405,7 +502,7 @@ struct mcc_list_iter *mcc_list_iter_new(struct mcc_list *list)
 		self = self->next;
 	}
 
-	self = calloc(1, sizeof(struct mcc_list_iter));
+	self = mem_calloc(&list->pool.allocator, sizeof(struct mcc_list_iter));
 	if (!self)
 		return NULL;
 
@@ -418,6 +515,18 @@ reset_iterator:
 	return self;
 }
 
+int mcc_list_iter_init(struct mcc_list_iter *self, struct mcc_list *list)
+{
+	if (!self || !list)
+		return INVALID_ARGUMENTS;
+
+	self->next = NULL;
+	self->list = list;
+	self->curr = list->head;
+	self->in_use = false;
+	return OK;
+}
+
 void mcc_list_iter_drop(struct mcc_list_iter *self)
 {
 	if (self)
@@ -433,3 +542,21 @@ bool mcc_list_iter_next(struct mcc_list_iter *self, void **ref)
 	self->curr = self->curr->next;
 	return true;
 }
+
+size_t mcc_list_iter_next_n(struct mcc_list_iter *self, void **refs, size_t n)
+{
+	struct mcc_list_node *curr;
+	size_t i;
+
+	if (!self || !refs)
+		return 0;
+
+	curr = self->curr;
+	for (i = 0; i < n && curr; i++) {
+		refs[i] = value_of(curr);
+		curr = curr->next;
+	}
+
+	self->curr = curr;
+	return i;
+}
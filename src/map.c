@@ -1,31 +1,41 @@
+#include "alloc.h"
 #include "mcc_err.h"
 #include "mcc_map.h"
 #include "memswap.h"
+#include "node_pool.h"
+#include <pthread.h>
 #include <stdlib.h>
 
 enum { RED, BLACK };
 
+enum set_op_kind { UNION, INTERSECTION, DIFFERENCE };
+
+/* Below this many entries in total, set operations never fork. */
+#define SET_OP_PARALLEL_THRESHOLD 65536
+
 struct mcc_rb_node {
 	int color;
+	size_t size; /* Number of nodes in this subtree. */
 	struct mcc_rb_node *parent;
 	struct mcc_rb_node *left;
 	struct mcc_rb_node *right;
 	struct mcc_pair pair;
 };
 
-struct mcc_map_iter {
-	struct mcc_map_iter *next;
-	struct mcc_map *map;
-	struct mcc_rb_node *curr;
-	bool in_use;
-};
-
 struct mcc_map {
 	const struct mcc_object_interface *K;
 	const struct mcc_object_interface *V;
 	struct mcc_map_iter *iters;
 	struct mcc_rb_node *root;
+	struct mcc_rb_node *first;
+	struct mcc_rb_node *last;
 	size_t len;
+	size_t nthreads;
+	/*
+	 * Split, join and the set operations move nodes between maps, which
+	 * the pool allows for.
+	 */
+	struct node_pool pool;
 };
 
 static inline bool is_red(struct mcc_rb_node *node)
@@ -43,6 +53,17 @@ static inline bool is_root(struct mcc_rb_node *node)
 	return !node ? false : node->parent == NULL;
 }
 
+static inline size_t size_of(struct mcc_rb_node *node)
+{
+	return !node ? 0 : node->size;
+}
+
+/* Subtree sizes are kept up to date at all times, so split knows its sizes. */
+static inline void update_size(struct mcc_rb_node *node)
+{
+	node->size = size_of(node->left) + size_of(node->right) + 1;
+}
+
 static void rotate_left(struct mcc_rb_node **root, struct mcc_rb_node *x)
 {
 	/*
@@ -68,6 +89,8 @@ static void rotate_left(struct mcc_rb_node **root, struct mcc_rb_node *x)
 			x->parent->right = y;
 		y->left = x;
 		x->parent = y;
+		y->size = x->size;
+		update_size(x);
 	}
 }
 
@@ -96,10 +119,13 @@ static void rotate_right(struct mcc_rb_node **root, struct mcc_rb_node *x)
 			x->parent->right = y;
 		y->right = x;
 		x->parent = y;
+		y->size = x->size;
+		update_size(x);
 	}
 }
 
-static void fix_insert(struct mcc_rb_node **root, struct mcc_rb_node *node)
+/* Returns true if the black height of the tree has grown. */
+static bool fix_insert(struct mcc_rb_node **root, struct mcc_rb_node *node)
 {
 	struct mcc_rb_node *parent, *grandparent, *tmp;
 
@@ -109,8 +135,10 @@ static void fix_insert(struct mcc_rb_node **root, struct mcc_rb_node *node)
 		 * color of the insertion node to black and then end the loop.
 		 */
 		if (is_root(node)) {
+			if (node->color == BLACK)
+				return false;
 			node->color = BLACK;
-			break;
+			return true;
 		}
 
 		parent = node->parent;
@@ -120,7 +148,7 @@ static void fix_insert(struct mcc_rb_node **root, struct mcc_rb_node *node)
 		 * loop directly.
 		 */
 		if (is_black(parent))
-			break;
+			return false;
 
 		grandparent = parent->parent;
 		tmp = grandparent->left;
@@ -178,7 +206,7 @@ static void fix_insert(struct mcc_rb_node **root, struct mcc_rb_node *node)
 			grandparent->right->color = BLACK;
 			grandparent->color = RED;
 			rotate_left(root, grandparent);
-			break;
+			return false;
 		} else { /* parent == grandparent->left */
 			tmp = grandparent->right;
 			if (is_red(tmp)) {
@@ -205,7 +233,7 @@ static void fix_insert(struct mcc_rb_node **root, struct mcc_rb_node *node)
 			grandparent->left->color = BLACK;
 			grandparent->color = RED;
 			rotate_right(root, grandparent);
-			break;
+			return false;
 		}
 	}
 }
@@ -379,19 +407,10 @@ static inline void *value_of(struct mcc_rb_node *node)
 	return node->pair.value;
 }
 
-static struct mcc_rb_node *create_node(const void *key, size_t key_size,
-				       const void *val, size_t val_size)
+static void init_node(struct mcc_rb_node *node, const void *key,
+		      size_t key_size, const void *val, size_t val_size)
 {
-	struct mcc_rb_node *node;
 	uint8_t *ptr;
-	size_t total_size = 0;
-
-	total_size += sizeof(struct mcc_rb_node);
-	total_size += key_size;
-	total_size += val_size;
-	node = calloc(1, total_size);
-	if (!node)
-		return NULL;
 
 	ptr = (uint8_t *)node + sizeof(struct mcc_rb_node);
 	memcpy(ptr, key, key_size);
@@ -400,28 +419,44 @@ static struct mcc_rb_node *create_node(const void *key, size_t key_size,
 	ptr += key_size;
 	memcpy(ptr, val, val_size);
 	node->pair.value = ptr;
+}
+
+static struct mcc_rb_node *create_node(struct mcc_map *self, const void *key,
+				       const void *val)
+{
+	struct mcc_rb_node *node;
 
+	node = node_pool_alloc(&self->pool);
+	if (!node)
+		return NULL;
+
+	node->color = RED;
+	node->size = 1;
+	node->parent = NULL;
+	node->left = NULL;
+	node->right = NULL;
+	init_node(node, key, self->K->size, val, self->V->size);
 	return node;
 }
 
-static void destroy_node(struct mcc_rb_node *node, const mcc_drop_fn key_drop,
-			 const mcc_drop_fn val_drop, const bool is_recursive)
+static void destroy_node(struct mcc_map *self, struct mcc_rb_node *node,
+			 const bool is_recursive)
 {
 	if (!node)
 		return;
 
 	if (is_recursive) {
-		destroy_node(node->left, key_drop, val_drop, is_recursive);
-		destroy_node(node->right, key_drop, val_drop, is_recursive);
+		destroy_node(self, node->left, is_recursive);
+		destroy_node(self, node->right, is_recursive);
 	}
 
-	if (key_drop)
-		key_drop(data_addr(node));
+	if (self->K->drop)
+		self->K->drop(data_addr(node));
 
-	if (val_drop)
-		val_drop(value_of(node));
+	if (self->V->drop)
+		self->V->drop(value_of(node));
 
-	free(node);
+	node_pool_free(&self->pool, node);
 }
 
 static struct mcc_rb_node **get_node(struct mcc_map *self, const void *key,
@@ -450,20 +485,503 @@ static struct mcc_rb_node **get_node(struct mcc_map *self, const void *key,
 	return node;
 }
 
+static struct mcc_rb_node *leftmost(struct mcc_rb_node *node)
+{
+	while (node && node->left)
+		node = node->left;
+	return node;
+}
+
+static struct mcc_rb_node *rightmost(struct mcc_rb_node *node)
+{
+	while (node && node->right)
+		node = node->right;
+	return node;
+}
+
+/* In-order neighbours, found through the parent links alone. */
+static struct mcc_rb_node *successor(struct mcc_rb_node *node)
+{
+	if (node->right)
+		return leftmost(node->right);
+
+	while (node->parent && node == node->parent->right)
+		node = node->parent;
+	return node->parent;
+}
+
+static struct mcc_rb_node *predecessor(struct mcc_rb_node *node)
+{
+	if (node->left)
+		return rightmost(node->left);
+
+	while (node->parent && node == node->parent->left)
+		node = node->parent;
+	return node->parent;
+}
+
+static struct mcc_rb_node **link_of(struct mcc_map *self,
+				    struct mcc_rb_node *node)
+{
+	if (!node->parent)
+		return &self->root;
+	if (node == node->parent->left)
+		return &node->parent->left;
+	return &node->parent->right;
+}
+
+/* First node whose key is >= key, or > key if strict. */
+static struct mcc_rb_node *lower_bound(struct mcc_map *self, const void *key,
+				       bool strict)
+{
+	struct mcc_rb_node *node = self->root, *bound = NULL;
+	int res;
+
+	while (node) {
+		res = self->K->cmp(key, key_of(node));
+		if (res < 0 || (res == 0 && !strict)) {
+			bound = node;
+			node = node->left;
+		} else {
+			node = node->right;
+		}
+	}
+	return bound;
+}
+
+static void adjust_sizes(struct mcc_rb_node *node, int delta)
+{
+	for (; node; node = node->parent)
+		node->size += delta;
+}
+
+/* Returns the number of keys < key, or <= key if strict. */
+static size_t count_before(struct mcc_map *self, const void *key, bool strict)
+{
+	struct mcc_rb_node *node = self->root;
+	size_t count = 0;
+	int res;
+
+	while (node) {
+		res = self->K->cmp(key, key_of(node));
+		if (res < 0 || (res == 0 && !strict)) {
+			node = node->left;
+		} else {
+			count += size_of(node->left) + 1;
+			node = node->right;
+		}
+	}
+	return count;
+}
+
+static struct mcc_rb_node *select_node(struct mcc_map *self, size_t index)
+{
+	struct mcc_rb_node *node = self->root;
+	size_t left;
+
+	while (node) {
+		left = size_of(node->left);
+		if (index < left) {
+			node = node->left;
+		} else if (index > left) {
+			index -= left + 1;
+			node = node->right;
+		} else {
+			break;
+		}
+	}
+	return node;
+}
+
+/*
+ * Join-based tree algorithms. All of them work on detached trees, whose root
+ * has no parent and is black, and move nodes around instead of copying them.
+ * Black heights are passed along with the roots so that joining two trees
+ * only walks as far as their heights differ. Subtree sizes are fixed up as
+ * they go, so they stay right if they were.
+ */
+struct subtree {
+	struct mcc_rb_node *root;
+	int height;
+};
+
+static struct subtree subtree_of(struct mcc_rb_node *root)
+{
+	struct subtree t = { root, 0 };
+	struct mcc_rb_node *node;
+
+	for (node = root; node; node = node->left)
+		t.height += is_black(node);
+	return t;
+}
+
+/* Detaches child from parent, the root of a tree of the given height. */
+static struct subtree detach(struct mcc_rb_node *parent,
+			     struct mcc_rb_node *child, int height)
+{
+	struct subtree t = { child, height - is_black(parent) };
+
+	if (child) {
+		child->parent = NULL;
+		if (child->color == RED) {
+			child->color = BLACK;
+			t.height++;
+		}
+	}
+	return t;
+}
+
+/*
+ * Joins the trees l and r with the node x in between, where every key in l is
+ * less than x and every key in r greater. If the black heights differ, x is
+ * hung as a red node on the spine of the taller tree, right above the first
+ * black node that is as high as the shorter tree, and fixed up like an insert.
+ */
+static struct subtree join(struct subtree l, struct mcc_rb_node *x,
+			   struct subtree r)
+{
+	struct mcc_rb_node *node, *parent = NULL;
+	struct subtree t;
+	size_t added;
+	int h;
+
+	x->left = l.root;
+	x->right = r.root;
+	if (l.height == r.height) {
+		x->parent = NULL;
+		x->color = BLACK;
+		if (l.root)
+			l.root->parent = x;
+		if (r.root)
+			r.root->parent = x;
+		update_size(x);
+		return (struct subtree){ x, l.height + 1 };
+	}
+
+	if (l.height > r.height) {
+		t = l;
+		added = size_of(r.root) + 1;
+		for (node = l.root, h = l.height; h != r.height || is_red(node);
+		     node = node->right) {
+			h -= is_black(node);
+			node->size += added;
+			parent = node;
+		}
+		x->left = node;
+		parent->right = x;
+		if (r.root)
+			r.root->parent = x;
+	} else {
+		t = r;
+		added = size_of(l.root) + 1;
+		for (node = r.root, h = r.height; h != l.height || is_red(node);
+		     node = node->left) {
+			h -= is_black(node);
+			node->size += added;
+			parent = node;
+		}
+		x->right = node;
+		parent->left = x;
+		if (l.root)
+			l.root->parent = x;
+	}
+
+	if (node)
+		node->parent = x;
+	x->parent = parent;
+	x->color = RED;
+	update_size(x);
+	t.height += fix_insert(&t.root, x);
+	return t;
+}
+
+/* Takes the maximum node out of the non-empty tree t. */
+static struct mcc_rb_node *split_last(struct subtree t, struct subtree *rest)
+{
+	struct subtree l = detach(t.root, t.root->left, t.height);
+	struct subtree r = detach(t.root, t.root->right, t.height);
+	struct mcc_rb_node *last;
+
+	if (!r.root) {
+		*rest = l;
+		return t.root;
+	}
+
+	last = split_last(r, &r);
+	*rest = join(l, t.root, r);
+	return last;
+}
+
+/* Like join, but without a node in between. */
+static struct subtree join2(struct subtree l, struct subtree r)
+{
+	struct mcc_rb_node *x;
+
+	if (!l.root)
+		return r;
+	if (!r.root)
+		return l;
+
+	x = split_last(l, &l);
+	return join(l, x, r);
+}
+
+/*
+ * Splits t into the keys less than key, the node equal to it (or NULL) and the
+ * keys greater than it.
+ */
+static void split(const struct mcc_object_interface *K, struct subtree t,
+		  const void *key, struct subtree *l, struct mcc_rb_node **m,
+		  struct subtree *r)
+{
+	struct subtree left, right;
+	int res;
+
+	if (!t.root) {
+		*l = *r = t;
+		*m = NULL;
+		return;
+	}
+
+	left = detach(t.root, t.root->left, t.height);
+	right = detach(t.root, t.root->right, t.height);
+	res = K->cmp(key, key_of(t.root));
+	if (res == 0) {
+		*l = left;
+		*m = t.root;
+		*r = right;
+	} else if (res < 0) {
+		split(K, left, key, l, m, &left);
+		*r = join(left, t.root, right);
+	} else {
+		split(K, right, key, &right, m, r);
+		*l = join(left, t.root, right);
+	}
+}
+
+/*
+ * Dropping keys and values runs user code, so the nodes a set operation
+ * throws away are only collected on a list (linked through left) and
+ * destroyed by the calling thread once all the work is done.
+ */
+struct set_op {
+	const struct mcc_object_interface *K;
+	enum set_op_kind kind;
+	size_t forks; /* Number of threads this call may still start. */
+	struct mcc_rb_node *garbage;
+};
+
+struct set_op_task {
+	struct set_op op;
+	struct subtree a;
+	struct subtree b;
+	struct subtree result;
+};
+
+static void discard(struct set_op *op, struct mcc_rb_node *node)
+{
+	node->left = op->garbage;
+	op->garbage = node;
+}
+
+static void discard_tree(struct set_op *op, struct mcc_rb_node *node)
+{
+	if (!node)
+		return;
+
+	discard_tree(op, node->left);
+	discard_tree(op, node->right);
+	discard(op, node);
+}
+
+static struct subtree set_op(struct set_op *op, struct subtree a,
+			     struct subtree b);
+
+static void *set_op_task(void *arg)
+{
+	struct set_op_task *task = arg;
+
+	task->result = set_op(&task->op, task->a, task->b);
+	return NULL;
+}
+
+/*
+ * Splits b by the root of a, solves both halves recursively (the left one on
+ * another thread while forks remain) and joins the results back. The nodes of
+ * a are kept whenever a key is in both trees.
+ */
+static struct subtree set_op(struct set_op *op, struct subtree a,
+			     struct subtree b)
+{
+	struct subtree l, r, left, right;
+	struct mcc_rb_node *m, *tail;
+	struct set_op_task task;
+	size_t forks = op->forks;
+	pthread_t thread;
+	bool forked;
+
+	if (!a.root || !b.root) {
+		if (op->kind == UNION)
+			return a.root ? a : b;
+		discard_tree(op, b.root);
+		if (op->kind == DIFFERENCE)
+			return a;
+		discard_tree(op, a.root);
+		return (struct subtree){ NULL, 0 };
+	}
+
+	split(op->K, b, key_of(a.root), &l, &m, &r);
+	task.a = detach(a.root, a.root->left, a.height);
+	task.b = l;
+	right = detach(a.root, a.root->right, a.height);
+	if (forks) {
+		task.op = *op;
+		task.op.forks = (forks - 1) / 2;
+		task.op.garbage = NULL;
+		op->forks = forks - 1 - task.op.forks;
+		forked = !pthread_create(&thread, NULL, set_op_task, &task);
+		right = set_op(op, right, r);
+		if (forked)
+			pthread_join(thread, NULL);
+		else
+			set_op_task(&task);
+		op->forks = forks;
+
+		left = task.result;
+		if (task.op.garbage) {
+			for (tail = task.op.garbage; tail->left;)
+				tail = tail->left;
+			tail->left = op->garbage;
+			op->garbage = task.op.garbage;
+		}
+	} else {
+		left = set_op(op, task.a, task.b);
+		right = set_op(op, right, r);
+	}
+
+	if (m)
+		discard(op, m);
+	if ((op->kind == UNION) || (op->kind == INTERSECTION && m) ||
+	    (op->kind == DIFFERENCE && !m))
+		return join(left, a.root, right);
+
+	discard(op, a.root);
+	return join2(left, right);
+}
+
 struct mcc_map *mcc_map_new(const struct mcc_object_interface *K,
 			    const struct mcc_object_interface *V)
 {
+	return mcc_map_new_with_allocator(NULL, K, V);
+}
+
+struct mcc_map *mcc_map_new_in(struct mcc_arena *arena,
+			       const struct mcc_object_interface *K,
+			       const struct mcc_object_interface *V)
+{
+	return mcc_map_new_with_allocator(mcc_arena_allocator(arena), K, V);
+}
+
+struct mcc_map *
+mcc_map_new_with_allocator(const struct mcc_allocator *allocator,
+			   const struct mcc_object_interface *K,
+			   const struct mcc_object_interface *V)
+{
+	struct mcc_allocator a;
 	struct mcc_map *self;
 
-	if (!K || !V)
+	if (!K || !V || !allocator_init(&a, allocator))
 		return NULL;
 
-	self = calloc(1, sizeof(struct mcc_map));
+	self = mem_calloc(&a, sizeof(struct mcc_map));
 	if (!self)
 		return NULL;
 
 	self->K = K;
 	self->V = V;
+	self->nthreads = 1;
+	node_pool_init(&self->pool,
+		       sizeof(struct mcc_rb_node) + K->size + V->size, &a);
+	return self;
+}
+
+struct build_ctx {
+	struct mcc_map *map;
+	const uint8_t *keys;
+	const uint8_t *values;
+	size_t red_depth;
+};
+
+/*
+ * Builds a tree of the entries [lo, hi) by always picking the middle one as
+ * the root. All levels above red_depth end up full, so making the nodes on the
+ * last, partial level red gives every path the same number of black nodes.
+ * Nodes are allocated in order, so they lie in key order in memory.
+ */
+static struct mcc_rb_node *build(struct build_ctx *ctx, size_t lo, size_t hi,
+				 size_t depth)
+{
+	const struct mcc_object_interface *K = ctx->map->K, *V = ctx->map->V;
+	struct mcc_rb_node *node, *left;
+	size_t mid;
+
+	if (lo == hi)
+		return NULL;
+
+	mid = lo + (hi - lo) / 2;
+	left = build(ctx, lo, mid, depth + 1);
+	node = create_node(ctx->map, ctx->keys + mid * K->size,
+			   ctx->values + mid * V->size);
+	node->color = depth == ctx->red_depth ? RED : BLACK;
+	node->size = hi - lo;
+	node->left = left;
+	node->right = build(ctx, mid + 1, hi, depth + 1);
+	if (node->left)
+		node->left->parent = node;
+	if (node->right)
+		node->right->parent = node;
+	return node;
+}
+
+struct mcc_map *mcc_map_from_sorted(const struct mcc_object_interface *K,
+				    const struct mcc_object_interface *V,
+				    const void *keys, const void *values,
+				    size_t n)
+{
+	const uint8_t *key = keys;
+	struct build_ctx ctx;
+	struct mcc_map *self;
+	size_t i, full;
+
+	if (!K || !V || (n && (!keys || (!values && V->size))))
+		return NULL;
+
+	for (i = 1; i < n; i++) {
+		if (K->cmp(key + (i - 1) * K->size, key + i * K->size) >= 0)
+			return NULL;
+	}
+
+	self = mcc_map_new(K, V);
+	if (!self || !n)
+		return self;
+
+	/* Then building cannot fail, and all nodes share one block. */
+	if (node_pool_reserve(&self->pool, n)) {
+		mcc_map_drop(self);
+		return NULL;
+	}
+
+	/* The full levels 0 .. red_depth - 1 hold 2^red_depth - 1 nodes. */
+	for (ctx.red_depth = 0, full = 1; full <= n + 1 - full; full <<= 1)
+		ctx.red_depth++;
+
+	ctx.map = self;
+	ctx.keys = keys;
+	ctx.values = values;
+	self->root = build(&ctx, 0, n, 0);
+	self->first = leftmost(self->root);
+	self->last = rightmost(self->root);
+	self->len = n;
 	return self;
 }
 
@@ -474,15 +992,21 @@ void mcc_map_drop(struct mcc_map *self)
 	if (!self)
 		return;
 
-	mcc_map_clear(self);
+	/* Memory that is not freed need not be cleared either. */
+	if (allocator_frees(&self->pool.allocator) || self->K->drop ||
+	    self->V->drop)
+		mcc_map_clear(self);
+	/* Lets the nodes this map gave to others outlive it. */
+	if (!allocator_frees(&self->pool.allocator))
+		node_pool_release(&self->pool);
 
 	while (self->iters) {
 		tmp = self->iters;
 		self->iters = self->iters->next;
-		free(tmp);
+		mem_free(&self->pool.allocator, tmp);
 	}
 
-	free(self);
+	mem_free(&self->pool.allocator, self);
 }
 
 void mcc_map_clear(struct mcc_map *self)
@@ -490,8 +1014,12 @@ void mcc_map_clear(struct mcc_map *self)
 	if (!self)
 		return;
 
-	destroy_node(self->root, self->K->drop, self->V->drop, true);
+	destroy_node(self, self->root, true);
+	if (allocator_frees(&self->pool.allocator))
+		node_pool_release(&self->pool);
 	self->root = NULL;
+	self->first = NULL;
+	self->last = NULL;
 	self->len = 0;
 }
 
@@ -512,11 +1040,17 @@ int mcc_map_insert(struct mcc_map *self, const void *key, const void *value)
 		memcpy(value_of(*node), value, self->V->size);
 		return OK;
 	} else { /* Insert a new node. */
-		*node = create_node(key, self->K->size, value, self->V->size);
+		*node = create_node(self, key, value);
 		if (!*node)
 			return CANNOT_ALLOCATE_MEMORY;
 
 		(*node)->parent = parent;
+		(*node)->size = 1;
+		adjust_sizes(parent, 1);
+		if (!parent || (parent == self->first && *node == parent->left))
+			self->first = *node;
+		if (!parent || (parent == self->last && *node == parent->right))
+			self->last = *node;
 		fix_insert(&self->root, *node);
 		self->len++;
 		return OK;
@@ -529,16 +1063,9 @@ static inline void swap_key_value(struct mcc_rb_node *a, struct mcc_rb_node *b,
 	memswap(data_addr(a), data_addr(b), key_size + val_size);
 }
 
-void mcc_map_remove(struct mcc_map *self, const void *key)
+static void remove_node(struct mcc_map *self, struct mcc_rb_node **node)
 {
-	struct mcc_rb_node **node, *tmp;
-
-	if (!self || !key)
-		return;
-
-	node = get_node(self, key, NULL);
-	if (!*node)
-		return;
+	struct mcc_rb_node *tmp;
 
 	if ((*node)->left && (*node)->right) {
 		tmp = *node;
@@ -547,9 +1074,19 @@ void mcc_map_remove(struct mcc_map *self, const void *key)
 			node = &((*node)->left);
 
 		swap_key_value(tmp, *node, self->K->size, self->V->size);
+		/* If the successor was the maximum, tmp now holds it. */
+		if (*node == self->last)
+			self->last = tmp;
+	} else {
+		/* Only a node with at most one child can be first or last. */
+		if (*node == self->first)
+			self->first = successor(*node);
+		if (*node == self->last)
+			self->last = predecessor(*node);
 	}
 
 	tmp = *node;
+	adjust_sizes(tmp->parent, -1);
 
 	if ((*node)->left || (*node)->right) {
 		*node = (*node)->left ? (*node)->left : (*node)->right;
@@ -561,10 +1098,34 @@ void mcc_map_remove(struct mcc_map *self, const void *key)
 			fix_remove(&(self->root), tmp->parent);
 	}
 
-	destroy_node(tmp, self->K->drop, self->V->drop, false);
+	destroy_node(self, tmp, false);
 	self->len--;
 }
 
+void mcc_map_remove(struct mcc_map *self, const void *key)
+{
+	struct mcc_rb_node **node;
+
+	if (!self || !key)
+		return;
+
+	node = get_node(self, key, NULL);
+	if (*node)
+		remove_node(self, node);
+}
+
+void mcc_map_pop_first(struct mcc_map *self)
+{
+	if (self && self->first)
+		remove_node(self, link_of(self, self->first));
+}
+
+void mcc_map_pop_last(struct mcc_map *self)
+{
+	if (self && self->last)
+		remove_node(self, link_of(self, self->last));
+}
+
 int mcc_map_get(struct mcc_map *self, const void *key, void **ref)
 {
 	struct mcc_rb_node **node;
@@ -598,6 +1159,30 @@ int mcc_map_get_key_value(struct mcc_map *self, const void *key,
 	}
 }
 
+int mcc_map_first(struct mcc_map *self, struct mcc_pair **ref)
+{
+	if (!self || !ref)
+		return INVALID_ARGUMENTS;
+
+	if (!self->first)
+		return NONE;
+
+	*ref = &self->first->pair;
+	return OK;
+}
+
+int mcc_map_last(struct mcc_map *self, struct mcc_pair **ref)
+{
+	if (!self || !ref)
+		return INVALID_ARGUMENTS;
+
+	if (!self->last)
+		return NONE;
+
+	*ref = &self->last->pair;
+	return OK;
+}
+
 size_t mcc_map_len(struct mcc_map *self)
 {
 	return !self ? 0 : self->len;
@@ -608,6 +1193,188 @@ bool mcc_map_is_empty(struct mcc_map *self)
 	return !self ? true : self->len == 0;
 }
 
+int mcc_map_rank(struct mcc_map *self, const void *key, size_t *rank)
+{
+	if (!self || !key || !rank)
+		return INVALID_ARGUMENTS;
+
+	*rank = count_before(self, key, false);
+	return OK;
+}
+
+int mcc_map_select(struct mcc_map *self, size_t index, struct mcc_pair **ref)
+{
+	if (!self || !ref)
+		return INVALID_ARGUMENTS;
+
+	if (index >= self->len)
+		return OUT_OF_RANGE;
+
+	*ref = &select_node(self, index)->pair;
+	return OK;
+}
+
+int mcc_map_count_range(struct mcc_map *self, const void *lo, const void *hi,
+			size_t *count)
+{
+	size_t begin, end;
+
+	if (!self || !lo || !hi || !count)
+		return INVALID_ARGUMENTS;
+
+	begin = count_before(self, lo, false);
+	end = count_before(self, hi, false);
+	*count = end > begin ? end - begin : 0;
+	return OK;
+}
+
+static void reset(struct mcc_map *self)
+{
+	self->root = NULL;
+	self->first = NULL;
+	self->last = NULL;
+	self->len = 0;
+}
+
+struct mcc_map *mcc_map_split(struct mcc_map *self, const void *key)
+{
+	struct subtree l, r;
+	struct mcc_rb_node *m;
+	struct mcc_map *other;
+
+	if (!self || !key)
+		return NULL;
+
+	other = mcc_map_new_with_allocator(&self->pool.allocator, self->K,
+					   self->V);
+	if (!other)
+		return NULL;
+
+	other->nthreads = self->nthreads;
+	split(self->K, subtree_of(self->root), key, &l, &m, &r);
+	if (m)
+		r = join((struct subtree){ NULL, 0 }, m, r);
+
+	other->root = r.root;
+	other->len = size_of(r.root);
+	other->first = leftmost(r.root);
+	other->last = r.root ? self->last : NULL;
+
+	self->root = l.root;
+	self->len -= other->len;
+	self->first = self->len ? self->first : NULL;
+	self->last = rightmost(l.root);
+	return other;
+}
+
+int mcc_map_join(struct mcc_map *self, struct mcc_map *other)
+{
+	if (!self || !other || self == other || self->K != other->K ||
+	    self->V != other->V ||
+	    !allocator_equal(&self->pool.allocator, &other->pool.allocator))
+		return INVALID_ARGUMENTS;
+
+	if (self->len && other->len &&
+	    self->K->cmp(key_of(self->last), key_of(other->first)) >= 0)
+		return INVALID_ARGUMENTS;
+
+	self->root = join2(subtree_of(self->root), subtree_of(other->root)).root;
+	self->first = self->first ? self->first : other->first;
+	self->last = other->last ? other->last : self->last;
+	self->len += other->len;
+	reset(other);
+	return OK;
+}
+
+static int set_operation(struct mcc_map *self, struct mcc_map *other,
+			 enum set_op_kind kind)
+{
+	struct set_op op = { .K = NULL };
+	struct mcc_rb_node *node;
+	size_t len;
+
+	if (!self || !other || self == other || self->K != other->K ||
+	    self->V != other->V ||
+	    !allocator_equal(&self->pool.allocator, &other->pool.allocator))
+		return INVALID_ARGUMENTS;
+
+	op.K = self->K;
+	op.kind = kind;
+	len = self->len + other->len;
+	if (len >= SET_OP_PARALLEL_THRESHOLD)
+		op.forks = self->nthreads - 1;
+
+	self->root = set_op(&op, subtree_of(self->root),
+			    subtree_of(other->root)).root;
+	self->first = leftmost(self->root);
+	self->last = rightmost(self->root);
+	reset(other);
+
+	while (op.garbage) {
+		node = op.garbage;
+		op.garbage = node->left;
+		destroy_node(self, node, false);
+		len--;
+	}
+	self->len = len;
+	return OK;
+}
+
+int mcc_map_union(struct mcc_map *self, struct mcc_map *other)
+{
+	return set_operation(self, other, UNION);
+}
+
+int mcc_map_intersection(struct mcc_map *self, struct mcc_map *other)
+{
+	return set_operation(self, other, INTERSECTION);
+}
+
+int mcc_map_difference(struct mcc_map *self, struct mcc_map *other)
+{
+	return set_operation(self, other, DIFFERENCE);
+}
+
+int mcc_map_parallelism(struct mcc_map *self, size_t nthreads)
+{
+	if (!self || !nthreads)
+		return INVALID_ARGUMENTS;
+
+	self->nthreads = nthreads;
+	return OK;
+}
+
+int mcc_map_for_each(struct mcc_map *self, mcc_pair_visit_fn fn, void *ctx)
+{
+	struct mcc_rb_node *node;
+	int ret;
+
+	if (!self || !fn)
+		return INVALID_ARGUMENTS;
+
+	for (node = self->first; node; node = successor(node)) {
+		ret = fn(&node->pair, ctx);
+		if (ret)
+			return ret;
+	}
+	return OK;
+}
+
+size_t mcc_map_fold(struct mcc_map *self, mcc_pair_fold_fn fn, void *acc)
+{
+	struct mcc_rb_node *node;
+	size_t i = 0;
+
+	if (!self || !fn)
+		return 0;
+
+	for (node = self->first; node; node = successor(node), i++) {
+		if (!fn(&node->pair, acc))
+			break;
+	}
+	return i;
+}
+
 struct mcc_map_iter *mcc_map_iter_new(struct mcc_map *map)
 {
 	struct mcc_map_iter *self;
@@ -622,7 +1389,7 @@ struct mcc_map_iter *mcc_map_iter_new(struct mcc_map *map)
 		self = self->next;
 	}
 
-	self = calloc(1, sizeof(struct mcc_map_iter));
+	self = mem_calloc(&map->pool.allocator, sizeof(struct mcc_map_iter));
 	if (!self)
 		return NULL;
 
@@ -630,45 +1397,114 @@ struct mcc_map_iter *mcc_map_iter_new(struct mcc_map *map)
 	map->iters = self;
 	self->map = map;
 reset_iterator:
-	self->curr = map->root;
-	while (self->curr && self->curr->left)
-		self->curr = self->curr->left;
+	self->curr = map->first;
 	self->in_use = true;
 	return self;
 }
 
+int mcc_map_iter_init(struct mcc_map_iter *self, struct mcc_map *map)
+{
+	if (!self || !map)
+		return INVALID_ARGUMENTS;
+
+	self->next = NULL;
+	self->map = map;
+	self->curr = map->first;
+	self->in_use = false;
+	return OK;
+}
+
 void mcc_map_iter_drop(struct mcc_map_iter *self)
 {
 	if (self)
 		self->in_use = false;
 }
 
+/*
+ * An iterator sits between two entries: curr is the entry after it, or NULL
+ * at the end. next returns that entry and steps over it, prev steps back over
+ * the entry before it and returns it.
+ */
 bool mcc_map_iter_next(struct mcc_map_iter *self, struct mcc_pair **result)
 {
-	struct mcc_rb_node *tmp;
-
 	if (!self || !result || !self->curr)
 		return false;
 
 	*result = &self->curr->pair;
+	self->curr = successor(self->curr);
+	return true;
+}
 
-	if (self->curr->right) {
-		/* Find the successor. */
-		tmp = self->curr->right;
-		while (tmp->left)
-			tmp = tmp->left;
-		self->curr = tmp;
-	} else {
-		tmp = self->curr->parent;
+size_t mcc_map_iter_next_n(struct mcc_map_iter *self, struct mcc_pair *pairs,
+			   size_t n)
+{
+	struct mcc_rb_node *curr;
+	size_t i;
 
-		while (tmp &&
-		       self->map->K->cmp(key_of(tmp), key_of(self->curr)) <= 0)
-			tmp = tmp->parent;
-		self->curr = tmp;
+	if (!self || !pairs)
+		return 0;
+
+	curr = self->curr;
+	for (i = 0; i < n && curr; i++) {
+		pairs[i] = curr->pair;
+		curr = successor(curr);
 	}
+
+	self->curr = curr;
+	return i;
+}
+
+bool mcc_map_iter_prev(struct mcc_map_iter *self, struct mcc_pair **result)
+{
+	struct mcc_rb_node *prev;
+
+	if (!self || !result)
+		return false;
+
+	prev = self->curr ? predecessor(self->curr) : self->map->last;
+	if (!prev)
+		return false;
+
+	*result = &prev->pair;
+	self->curr = prev;
 	return true;
 }
 
+void mcc_map_iter_seek_ge(struct mcc_map_iter *self, const void *key)
+{
+	if (self && key)
+		self->curr = lower_bound(self->map, key, false);
+}
+
+void mcc_map_iter_seek_gt(struct mcc_map_iter *self, const void *key)
+{
+	if (self && key)
+		self->curr = lower_bound(self->map, key, true);
+}
+
+void mcc_map_iter_seek_begin(struct mcc_map_iter *self)
+{
+	if (self)
+		self->curr = self->map->first;
+}
+
+void mcc_map_iter_seek_end(struct mcc_map_iter *self)
+{
+	if (self)
+		self->curr = NULL;
+}
+
+void mcc_map_iter_seek_nth(struct mcc_map_iter *self, size_t index)
+{
+	if (!self)
+		return;
+
+	if (index >= self->map->len)
+		self->curr = NULL;
+	else
+		self->curr = select_node(self->map, index);
+}
+
 #define _UNIT_TEST 0
 #if _UNIT_TEST
 #include <assert.h>
@@ -0,0 +1,145 @@
+#include "align.h"
+#include "alloc.h"
+#include "mcc_err.h"
+#include "node_pool.h"
+#include <stdatomic.h>
+
+/* Blocks double in size from MIN_BLOCK_SLOTS up to about MAX_BLOCK_SIZE. */
+#define MIN_BLOCK_SLOTS 16
+#define MAX_BLOCK_SIZE (64 * 1024)
+
+/*
+ * While its pool holds a block, refs is REFS_BIAS minus the nodes of the
+ * block that other pools gave back, and live, which only the pool touches,
+ * counts the nodes handed out and not freed to the pool. Releasing the pool
+ * folds live into refs, which from then on is the number of nodes still
+ * out. Counting modulo SIZE_MAX + 1 makes the bias work out either way.
+ */
+#define REFS_BIAS (SIZE_MAX / 2)
+
+struct node_block {
+	uint64_t owner; /* The id of the pool, never changes. */
+	struct mcc_allocator allocator;
+	struct node_block *next;
+	size_t live;
+	atomic_size_t refs;
+};
+
+static atomic_uint_least64_t next_pool_id = 1;
+
+static inline struct node_block **header_of(void *node)
+{
+	return (struct node_block **)node - 1;
+}
+
+static inline void unref(struct node_block *block, size_t n)
+{
+	if (atomic_fetch_sub(&block->refs, n) == n)
+		mem_free(&block->allocator, block);
+}
+
+void node_pool_init(struct node_pool *pool, size_t node_size,
+		    const struct mcc_allocator *allocator)
+{
+	pool->blocks = NULL;
+	pool->free = NULL;
+	pool->bump = NULL;
+	pool->bump_left = 0;
+	pool->slot_size = round_up(sizeof(struct node_block *) + node_size,
+				   sizeof(void *));
+	pool->block_slots = MIN_BLOCK_SLOTS;
+	pool->id = atomic_fetch_add(&next_pool_id, 1);
+	pool->allocator = *allocator;
+}
+
+static int add_block(struct node_pool *pool, size_t slots)
+{
+	struct node_block *block;
+
+	if (slots > (SIZE_MAX - sizeof(struct node_block)) / pool->slot_size)
+		return CANNOT_ALLOCATE_MEMORY;
+
+	block = mem_alloc(&pool->allocator,
+			  sizeof(struct node_block) + slots * pool->slot_size);
+	if (!block)
+		return CANNOT_ALLOCATE_MEMORY;
+
+	block->owner = pool->id;
+	block->allocator = pool->allocator;
+	block->live = 0;
+	atomic_init(&block->refs, REFS_BIAS);
+	block->next = pool->blocks;
+	pool->blocks = block;
+	pool->bump = (uint8_t *)(block + 1);
+	pool->bump_left = slots;
+	return OK;
+}
+
+void *node_pool_alloc(struct node_pool *pool)
+{
+	struct node_block **header, *block;
+	void *node;
+
+	if (pool->free) {
+		node = pool->free;
+		pool->free = *(void **)node;
+		/* Nodes of other pools never stopped counting as out. */
+		block = *header_of(node);
+		if (block->owner == pool->id)
+			block->live++;
+		return node;
+	}
+
+	if (!pool->bump_left) {
+		if (add_block(pool, pool->block_slots))
+			return NULL;
+		if (pool->block_slots * 2 * pool->slot_size <= MAX_BLOCK_SIZE)
+			pool->block_slots *= 2;
+	}
+
+	header = (struct node_block **)pool->bump;
+	*header = pool->blocks;
+	pool->blocks->live++;
+	pool->bump += pool->slot_size;
+	pool->bump_left--;
+	return header + 1;
+}
+
+int node_pool_reserve(struct node_pool *pool, size_t n)
+{
+	if (pool->bump_left >= n)
+		return OK;
+
+	return add_block(pool, n);
+}
+
+void node_pool_free(struct node_pool *pool, void *node)
+{
+	struct node_block *block = *header_of(node);
+
+	if (block->owner == pool->id)
+		block->live--;
+	*(void **)node = pool->free;
+	pool->free = node;
+}
+
+void node_pool_release(struct node_pool *pool)
+{
+	struct node_block *block, *next_block;
+	void *node, *next;
+
+	for (node = pool->free; node; node = next) {
+		next = *(void **)node;
+		block = *header_of(node);
+		if (block->owner != pool->id)
+			unref(block, 1);
+	}
+
+	for (block = pool->blocks; block; block = next_block) {
+		next_block = block->next;
+		unref(block, REFS_BIAS - block->live);
+	}
+
+	node_pool_init(pool, pool->slot_size - sizeof(struct node_block *),
+		       &pool->allocator);
+}
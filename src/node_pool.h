@@ -0,0 +1,64 @@
+#ifndef _NODE_POOL_H
+#define _NODE_POOL_H
+
+#include "mcc_allocator.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A slab allocator for the nodes of one container. Nodes are carved out of
+ * blocks of growing size and recycled through a free list, so inserting and
+ * removing in a loop never reaches malloc.
+ *
+ * Every node is preceded by a pointer to its block, so nodes may move to
+ * another container and be freed there. A pool only ever writes to its own
+ * free list: a node of another pool's block is kept on the free list of the
+ * pool that frees it, and goes back to its block when that pool is released.
+ * A block counts its nodes that are not on its own pool's free list, and
+ * outlives its pool until the last of them is gone. The count is only shared
+ * through an atomic, so containers that exchanged nodes may still be used
+ * from different threads.
+ *
+ * Blocks come from the allocator of the pool. Each block keeps a copy of
+ * it, to be freed with after the pool is gone.
+ *
+ * Nodes are aligned to a pointer.
+ */
+
+struct node_block;
+
+struct node_pool {
+	struct node_block *blocks;
+	void *free;
+	uint8_t *bump;
+	size_t bump_left;
+	size_t slot_size;
+	size_t block_slots;
+	uint64_t id; /* Unique to every node_pool_init, see node_block. */
+	struct mcc_allocator allocator;
+};
+
+void node_pool_init(struct node_pool *pool, size_t node_size,
+		    const struct mcc_allocator *allocator);
+
+/* Returns NULL if the memory ran out. The node is not zeroed. */
+void *node_pool_alloc(struct node_pool *pool);
+
+/*
+ * Makes sure the next n node_pool_alloc calls succeed, and if the pool has no
+ * free nodes, that they return consecutive nodes of one block.
+ */
+int node_pool_reserve(struct node_pool *pool, size_t n);
+
+/* node may come from any pool, see above. */
+void node_pool_free(struct node_pool *pool, void *node);
+
+/*
+ * Gives back all unused memory and leaves the pool empty but usable. If the
+ * allocator does not free, that means losing the memory until the allocator
+ * reclaims it, so a container that is not about to be dropped rather keeps
+ * it.
+ */
+void node_pool_release(struct node_pool *pool);
+
+#endif /* _NODE_POOL_H */
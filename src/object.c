@@ -1,6 +1,44 @@
 #include "mcc_object.h"
 #include <string.h>
 
+static uint64_t hash_seed;
+
+void mcc_set_hash_seed(uint64_t seed)
+{
+	hash_seed = seed;
+}
+
+#define P0 0xa0761d6478bd642fULL
+#define P1 0xe7037ed1a0b428dbULL
+#define P2 0x8ebc6af09c88c6e3ULL
+
+/*
+ * Folded 64x64->128 bit multiply as in wyhash. Every input bit reaches both
+ * the low and the high bits of the result, so keys that only differ in their
+ * high bits (or only share their low bits) still spread over all buckets.
+ */
+static inline uint64_t mum(uint64_t a, uint64_t b)
+{
+	__uint128_t r = (__uint128_t)a * b;
+
+	return (uint64_t)(r ^ (r >> 64));
+}
+
+static inline size_t mix(uint64_t x)
+{
+	return mum(x ^ hash_seed ^ P0, P1);
+}
+
+/* Bits of a double, with -0.0 hashed like 0.0 since they compare equal. */
+static inline uint64_t double_bits(double x)
+{
+	uint64_t bits = 0;
+
+	if (x != 0)
+		memcpy(&bits, &x, sizeof(double));
+	return bits;
+}
+
 /* mcc_str_t (const char *) */
 
 static int mcc_str_cmp(const mcc_str_t *self, const mcc_str_t *other)
@@ -8,15 +46,91 @@ static int mcc_str_cmp(const mcc_str_t *self, const mcc_str_t *other)
 	return strcmp(*self, *other);
 }
 
+#define ONES 0x0101010101010101ULL
+#define HIGHS 0x8080808080808080ULL
+
+#define PAGE_SIZE 4096
+
+/*
+ * Loads the next 8 bytes of a string as a little endian word. The load may
+ * read past the terminator, but never into the next page, which is the only
+ * way such a read can fault. AddressSanitizer would still flag the bytes past
+ * the terminator, so neither this nor its caller is instrumented.
+ */
+__attribute__((no_sanitize_address))
+static inline uint64_t load_word(const char *p)
+{
+	uint64_t w = 0;
+	int i;
+
+	if (((uintptr_t)p & (PAGE_SIZE - 1)) > PAGE_SIZE - 8) {
+		for (i = 0; i < 8 && p[i]; i++)
+			w |= (uint64_t)(uint8_t)p[i] << (i * 8);
+		return w;
+	}
+
+	memcpy(&w, p, sizeof(w));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	w = __builtin_bswap64(w);
+#endif
+	return w;
+}
+
+/*
+ * The lowest set bit of the result marks the first zero byte of w. Higher
+ * bits may be false positives, which is fine since only the first counts.
+ */
+static inline uint64_t zero_bytes(uint64_t w)
+{
+	return (w - ONES) & ~w & HIGHS;
+}
+
+/* Number of bytes before the first zero byte marked in mask. */
+static inline size_t bytes_before(uint64_t mask)
+{
+	return __builtin_ctzll(mask) >> 3;
+}
+
+static inline uint64_t low_bytes(uint64_t w, size_t n)
+{
+	return n ? w & (~0ULL >> (64 - n * 8)) : 0;
+}
+
+/*
+ * In the style of wyhash, 16 bytes at a time, with the length found on the
+ * way instead of by a strlen pass.
+ */
+__attribute__((no_sanitize_address))
 static size_t mcc_str_hash(const mcc_str_t *key)
 {
-	const char *c = *key;
-	size_t h = 0;
+	const char *p = *key;
+	uint64_t seed = hash_seed ^ P0, a, b = 0, zeros;
+	size_t len = 0;
 
-	while (*c)
-		h = h * 31 + *c++;
+	while (true) {
+		a = load_word(p);
+		zeros = zero_bytes(a);
+		if (zeros) {
+			a = low_bytes(a, bytes_before(zeros));
+			len += bytes_before(zeros);
+			break;
+		}
 
-	return h;
+		b = load_word(p + 8);
+		zeros = zero_bytes(b);
+		if (zeros) {
+			b = low_bytes(b, bytes_before(zeros));
+			len += 8 + bytes_before(zeros);
+			break;
+		}
+
+		seed = mum(a ^ P1, b ^ seed);
+		p += 16;
+		len += 16;
+		b = 0;
+	}
+
+	return mum(P1 ^ len, mum(a ^ P1, b ^ seed ^ P2));
 }
 
 static const struct mcc_object_interface mcc_str_obj_intf = {
@@ -40,7 +154,7 @@ static int mcc_char_cmp(const signed char *self, const signed char *other)
 
 static size_t mcc_char_hash(const signed char *key)
 {
-	return *key;
+	return mix(*key);
 }
 
 static const struct mcc_object_interface mcc_char_obj_intf = {
@@ -64,7 +178,7 @@ static int mcc_short_cmp(const signed short *self, const signed short *other)
 
 static size_t mcc_short_hash(const signed short *key)
 {
-	return *key;
+	return mix(*key);
 }
 
 static const struct mcc_object_interface mcc_short_obj_intf = {
@@ -88,7 +202,7 @@ static int mcc_int_cmp(const signed int *self, const signed int *other)
 
 static size_t mcc_int_hash(const signed int *key)
 {
-	return *key;
+	return mix(*key);
 }
 
 static const struct mcc_object_interface mcc_int_obj_intf = {
@@ -112,7 +226,7 @@ static int mcc_long_cmp(const signed long *self, const signed long *other)
 
 static size_t mcc_long_hash(const signed long *key)
 {
-	return *key;
+	return mix(*key);
 }
 
 static const struct mcc_object_interface mcc_long_obj_intf = {
@@ -137,7 +251,7 @@ static int mcc_long_long_cmp(const signed long long *self,
 
 static size_t mcc_long_long_hash(const signed long long *key)
 {
-	return *key;
+	return mix(*key);
 }
 
 static const struct mcc_object_interface mcc_long_long_obj_intf = {
@@ -161,7 +275,7 @@ static int mcc_uchar_cmp(const unsigned char *self, const unsigned char *other)
 
 static size_t mcc_uchar_hash(const unsigned char *key)
 {
-	return *key;
+	return mix(*key);
 }
 
 static const struct mcc_object_interface mcc_uchar_obj_intf = {
@@ -186,7 +300,7 @@ static int mcc_ushort_cmp(const unsigned short *self,
 
 static size_t mcc_ushort_hash(const unsigned short *key)
 {
-	return *key;
+	return mix(*key);
 }
 
 static const struct mcc_object_interface mcc_ushort_obj_intf = {
@@ -210,7 +324,7 @@ static int mcc_uint_cmp(const unsigned int *self, const unsigned int *other)
 
 static size_t mcc_uint_hash(const unsigned int *key)
 {
-	return *key;
+	return mix(*key);
 }
 
 static const struct mcc_object_interface mcc_uint_obj_intf = {
@@ -234,7 +348,7 @@ static int mcc_ulong_cmp(const unsigned long *self, const unsigned long *other)
 
 static size_t mcc_ulong_hash(const unsigned long *key)
 {
-	return *key;
+	return mix(*key);
 }
 
 static const struct mcc_object_interface mcc_ulong_obj_intf = {
@@ -259,7 +373,7 @@ static int mcc_ulong_long_cmp(const unsigned long long *self,
 
 static size_t mcc_ulong_long_hash(const unsigned long long *key)
 {
-	return *key;
+	return mix(*key);
 }
 
 static const struct mcc_object_interface mcc_ulong_long_obj_intf = {
@@ -283,7 +397,7 @@ static int mcc_float_cmp(const float *self, const float *other)
 
 static size_t mcc_float_hash(const float *key)
 {
-	return *key;
+	return mix(double_bits(*key));
 }
 
 static const struct mcc_object_interface mcc_float_obj_intf = {
@@ -306,7 +420,7 @@ static int mcc_double_cmp(const double *self, const double *other)
 
 static size_t mcc_double_hash(const double *key)
 {
-	return *key;
+	return mix(double_bits(*key));
 }
 
 static const struct mcc_object_interface mcc_double_obj_intf = {
@@ -329,9 +443,20 @@ static int mcc_long_double_cmp(const long double *self,
 	return *self > *other ? 1 : *self == *other ? 0 : -1;
 }
 
+/*
+ * A long double is the sum of its rounding to double and a remainder that is
+ * exact in double, so the pair tells apart any two values. Hashing the bytes
+ * would also hash the padding of the 80-bit format.
+ */
 static size_t mcc_long_double_hash(const long double *key)
 {
-	return *key;
+	double hi = *key, lo = *key - hi;
+
+	/* The remainder of an infinity is NaN. */
+	if (lo != lo)
+		lo = 0;
+
+	return mix(double_bits(hi) ^ mix(double_bits(lo)));
 }
 
 static const struct mcc_object_interface mcc_long_double_obj_intf = {
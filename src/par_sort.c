@@ -0,0 +1,255 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "sort.h"
+
+/*
+ * Parallel merge sort over a struct sort_seq. The sequence is cut into one
+ * chunk per thread and every chunk is sorted on its own (radix sort for the
+ * built-in interfaces, pdqsort otherwise). Sorted runs are then merged
+ * pairwise, ping-ponging between the sequence and a buffer of the same size.
+ * Every merge round splits the whole output evenly between all threads by
+ * binary searching the merge path, so that no thread idles while the last
+ * few long runs are merged.
+ */
+
+enum { PAR_SORT_MIN_CHUNK = 1 << 14 };
+
+struct par_sort_ctx {
+	const struct sort_seq *seq;
+	const struct mcc_object_interface *T;
+	const struct sort_seq *src;
+	const struct sort_seq *dst;
+	uint8_t *buf; /* seq->len elements */
+	size_t *bounds; /* run r is [bounds[r], bounds[r + 1]) */
+	size_t runs;
+	size_t width; /* runs per half of a merged pair */
+	size_t nthreads;
+};
+
+struct par_sort_task {
+	struct par_sort_ctx *ctx;
+	size_t index;
+};
+
+static inline uint8_t *at(const struct sort_seq *seq, size_t i)
+{
+	if (i < seq->split)
+		return seq->first + i * seq->size;
+	else
+		return seq->second + (i - seq->split) * seq->size;
+}
+
+static inline void copy(uint8_t *dst, const uint8_t *src, size_t size)
+{
+	switch (size) {
+	case 4:
+		memcpy(dst, src, 4);
+		break;
+	case 8:
+		memcpy(dst, src, 8);
+		break;
+	default:
+		memcpy(dst, src, size);
+		break;
+	}
+}
+
+static struct sort_seq slice(const struct sort_seq *seq, size_t lo, size_t hi)
+{
+	struct sort_seq s = *seq;
+
+	s.first = at(seq, lo);
+	s.len = hi - lo;
+	if (lo < seq->split) {
+		s.split = seq->split - lo;
+	} else {
+		s.split = s.len;
+		s.second = NULL;
+	}
+	if (s.split > s.len)
+		s.split = s.len;
+	return s;
+}
+
+static void sort_chunk(struct par_sort_ctx *ctx, size_t index)
+{
+	struct sort_seq s = slice(ctx->seq, ctx->bounds[index],
+				  ctx->bounds[index + 1]);
+
+	/* The chunk's share of the merge buffer is free until the merges. */
+	if (s.split == s.len &&
+	    radix_sort_buf(ctx->T, s.first,
+			   ctx->buf + ctx->bounds[index] * s.size, s.len))
+		return;
+	pdq_sort(&s);
+}
+
+/*
+ * Number of elements taken from a (of length m) among the first k elements of
+ * the merge of a and b (of length l). Ties are taken from a first.
+ */
+static size_t co_rank(const struct sort_seq *src, size_t a, size_t m,
+		      size_t b, size_t l, size_t k)
+{
+	size_t lo = k > l ? k - l : 0, hi = k < m ? k : m, i, j;
+
+	while (lo < hi) {
+		i = lo + (hi - lo) / 2;
+		j = k - i;
+		if (src->cmp(at(src, a + i), at(src, b + j - 1)) <= 0)
+			lo = i + 1;
+		else
+			hi = i;
+	}
+	return lo;
+}
+
+static void merge(struct par_sort_ctx *ctx, size_t a, size_t m, size_t b,
+		  size_t l, size_t k0, size_t k1)
+{
+	const struct sort_seq *src = ctx->src, *dst = ctx->dst;
+	size_t i = co_rank(src, a, m, b, l, k0), j = k0 - i;
+	size_t i1 = co_rank(src, a, m, b, l, k1), j1 = k1 - i1;
+	size_t out = a + k0, size = src->size;
+
+	while (i < i1 && j < j1) {
+		if (src->cmp(at(src, b + j), at(src, a + i)) < 0)
+			copy(at(dst, out++), at(src, b + j++), size);
+		else
+			copy(at(dst, out++), at(src, a + i++), size);
+	}
+	while (i < i1)
+		copy(at(dst, out++), at(src, a + i++), size);
+	while (j < j1)
+		copy(at(dst, out++), at(src, b + j++), size);
+}
+
+/* Merges the part of the current round that lands in this thread's share. */
+static void merge_share(struct par_sort_ctx *ctx, size_t index)
+{
+	size_t n = ctx->seq->len, runs = ctx->runs, w = ctx->width;
+	size_t lo = n / ctx->nthreads * index, hi, r, a, b, e;
+
+	hi = index + 1 == ctx->nthreads ? n : lo + n / ctx->nthreads;
+	for (r = 0; r < runs; r += 2 * w) {
+		a = ctx->bounds[r];
+		b = ctx->bounds[r + w < runs ? r + w : runs];
+		e = ctx->bounds[r + 2 * w < runs ? r + 2 * w : runs];
+		if (e <= lo)
+			continue;
+		if (a >= hi)
+			break;
+		merge(ctx, a, b - a, b, e - b, (lo > a ? lo : a) - a,
+		      (hi < e ? hi : e) - a);
+	}
+}
+
+static void *sort_task(void *arg)
+{
+	struct par_sort_task *task = arg;
+
+	sort_chunk(task->ctx, task->index);
+	return NULL;
+}
+
+static void *merge_task(void *arg)
+{
+	struct par_sort_task *task = arg;
+
+	merge_share(task->ctx, task->index);
+	return NULL;
+}
+
+/*
+ * Runs fn for every thread index, index 0 on the calling thread. If a thread
+ * cannot be started its share is done on the calling thread as well.
+ */
+static void run_parallel(struct par_sort_ctx *ctx, struct par_sort_task *tasks,
+			 pthread_t *threads, bool *started,
+			 void *(*fn)(void *))
+{
+	size_t i;
+
+	for (i = 1; i < ctx->nthreads; i++) {
+		tasks[i].ctx = ctx;
+		tasks[i].index = i;
+		started[i] = !pthread_create(&threads[i], NULL, fn, &tasks[i]);
+	}
+
+	tasks[0].ctx = ctx;
+	tasks[0].index = 0;
+	fn(&tasks[0]);
+
+	for (i = 1; i < ctx->nthreads; i++) {
+		if (started[i])
+			pthread_join(threads[i], NULL);
+		else
+			fn(&tasks[i]);
+	}
+}
+
+bool par_sort(const struct mcc_allocator *allocator,
+	      const struct sort_seq *seq, const struct mcc_object_interface *T,
+	      size_t nthreads)
+{
+	struct par_sort_ctx ctx = {.seq = seq, .T = T};
+	struct sort_seq buf = *seq;
+	struct par_sort_task *tasks;
+	pthread_t *threads;
+	bool *started;
+	size_t i;
+
+	if (nthreads > seq->len / PAR_SORT_MIN_CHUNK)
+		nthreads = seq->len / PAR_SORT_MIN_CHUNK;
+	if (nthreads <= 1)
+		return false;
+
+	buf.first = mem_alloc(allocator, seq->len * seq->size);
+	buf.second = NULL;
+	buf.split = seq->len;
+	ctx.buf = buf.first;
+	ctx.bounds = mem_alloc(allocator, (nthreads + 1) * sizeof(size_t));
+	tasks = mem_alloc(allocator, nthreads * sizeof(struct par_sort_task));
+	threads = mem_alloc(allocator, nthreads * sizeof(pthread_t));
+	started = mem_alloc(allocator, nthreads * sizeof(bool));
+	if (!buf.first || !ctx.bounds || !tasks || !threads || !started) {
+		mem_free(allocator, buf.first);
+		mem_free(allocator, ctx.bounds);
+		mem_free(allocator, tasks);
+		mem_free(allocator, threads);
+		mem_free(allocator, started);
+		return false;
+	}
+
+	ctx.runs = nthreads;
+	ctx.nthreads = nthreads;
+	for (i = 0; i <= nthreads; i++)
+		ctx.bounds[i] = seq->len / nthreads * i;
+	ctx.bounds[nthreads] = seq->len;
+
+	run_parallel(&ctx, tasks, threads, started, sort_task);
+
+	/*
+	 * Merge rounds alternate between the sequence and the buffer. One more
+	 * round with a single run copies the result back if it ends up in the
+	 * buffer.
+	 */
+	ctx.src = seq;
+	ctx.dst = &buf;
+	for (ctx.width = 1; ctx.width < ctx.runs || ctx.src != seq;
+	     ctx.width *= 2) {
+		run_parallel(&ctx, tasks, threads, started, merge_task);
+		ctx.dst = ctx.src;
+		ctx.src = ctx.src == seq ? &buf : seq;
+	}
+
+	mem_free(allocator, buf.first);
+	mem_free(allocator, ctx.bounds);
+	mem_free(allocator, tasks);
+	mem_free(allocator, threads);
+	mem_free(allocator, started);
+	return true;
+}
@@ -1,6 +1,7 @@
+#include "heap.h"
+#include "mcc_err.h"
 #include "mcc_priority_queue.h"
 #include "mcc_vector.h"
-#include "sift_down.h"
 
 #define VECTOR(PTR) ((struct mcc_vector *)(PTR))
 #define PRIORITY_QUEUE(PTR) ((struct mcc_priority_queue *)(PTR))
@@ -13,6 +14,20 @@ mcc_priority_queue_new(const struct mcc_object_interface *T)
 	return PRIORITY_QUEUE(mcc_vector_new(T));
 }
 
+struct mcc_priority_queue *
+mcc_priority_queue_new_in(struct mcc_arena *arena,
+			  const struct mcc_object_interface *T)
+{
+	return PRIORITY_QUEUE(mcc_vector_new_in(arena, T));
+}
+
+struct mcc_priority_queue *
+mcc_priority_queue_new_with_allocator(const struct mcc_allocator *allocator,
+				      const struct mcc_object_interface *T)
+{
+	return PRIORITY_QUEUE(mcc_vector_new_with_allocator(allocator, T));
+}
+
 void mcc_priority_queue_drop(struct mcc_priority_queue *self)
 {
 	mcc_vector_drop(VECTOR(self));
@@ -27,22 +42,37 @@ int mcc_priority_queue_reserve(struct mcc_priority_queue *self,
 int mcc_priority_queue_push(struct mcc_priority_queue *self, const void *value)
 {
 	int err;
-	size_t i;
 
 	err = mcc_vector_push(VECTOR(self), value);
 	if (err)
 		return err;
 
-	i = mcc_vector_len(VECTOR(self));
-	if (i > 1) {
-		i >>= 1;
-		while (true) {
-			sift_down(VECTOR(self), i);
-			if (i-- == 0)
-				break;
-		}
+	sift_up(VECTOR(self), mcc_vector_len(VECTOR(self)) - 1);
+	return OK;
+}
+
+int mcc_priority_queue_push_many(struct mcc_priority_queue *self,
+				 const void *values, size_t n)
+{
+	size_t old_len, i;
+	int err;
+
+	old_len = mcc_vector_len(VECTOR(self));
+	err = mcc_vector_push_many(VECTOR(self), values, n);
+	if (err)
+		return err;
+
+	/*
+	 * Rebuilding the whole heap costs O(old_len + n), sifting up every new
+	 * element costs O(n log(old_len + n)).
+	 */
+	if (n >= old_len) {
+		heapify(VECTOR(self));
+	} else {
+		for (i = old_len; i < old_len + n; i++)
+			sift_up(VECTOR(self), i);
 	}
-	return err;
+	return OK;
 }
 
 void mcc_priority_queue_pop(struct mcc_priority_queue *self)
@@ -92,6 +122,12 @@ mcc_priority_queue_iter_new(struct mcc_priority_queue *queue)
 	return PRIORITY_QUEUE_ITER(mcc_vector_iter_new(VECTOR(queue)));
 }
 
+int mcc_priority_queue_iter_init(struct mcc_priority_queue_iter *self,
+				 struct mcc_priority_queue *queue)
+{
+	return mcc_vector_iter_init(VECTOR_ITER(self), VECTOR(queue));
+}
+
 void mcc_priority_queue_iter_drop(struct mcc_priority_queue_iter *self)
 {
 	mcc_vector_iter_drop(VECTOR_ITER(self));
@@ -109,3 +145,38 @@ bool mcc_priority_queue_iter_next(struct mcc_priority_queue_iter *self,
 		return false;
 	}
 }
+
+size_t mcc_priority_queue_iter_next_n(struct mcc_priority_queue_iter *self,
+				      const void **refs, size_t n)
+{
+	return mcc_vector_iter_next_n(VECTOR_ITER(self), (void **)refs, n);
+}
+
+struct visit_elements {
+	mcc_const_visit_fn fn;
+	void *ctx;
+};
+
+static int visit_element(void *elem, void *ctx)
+{
+	struct visit_elements *v = ctx;
+
+	return v->fn(elem, v->ctx);
+}
+
+int mcc_priority_queue_for_each(struct mcc_priority_queue *self,
+				mcc_const_visit_fn fn, void *ctx)
+{
+	struct visit_elements v = {fn, ctx};
+
+	if (!fn)
+		return INVALID_ARGUMENTS;
+
+	return mcc_vector_for_each(VECTOR(self), visit_element, &v);
+}
+
+size_t mcc_priority_queue_fold(struct mcc_priority_queue *self,
+			       mcc_fold_fn fn, void *acc)
+{
+	return mcc_vector_fold(VECTOR(self), fn, acc);
+}
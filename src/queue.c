@@ -9,6 +9,19 @@ struct mcc_queue *mcc_queue_new(const struct mcc_object_interface *T)
 	return QUEUE(mcc_deque_new(T));
 }
 
+struct mcc_queue *mcc_queue_new_in(struct mcc_arena *arena,
+				   const struct mcc_object_interface *T)
+{
+	return QUEUE(mcc_deque_new_in(arena, T));
+}
+
+struct mcc_queue *
+mcc_queue_new_with_allocator(const struct mcc_allocator *allocator,
+			     const struct mcc_object_interface *T)
+{
+	return QUEUE(mcc_deque_new_with_allocator(allocator, T));
+}
+
 void mcc_queue_drop(struct mcc_queue *self)
 {
 	mcc_deque_drop(DEQUE(self));
@@ -0,0 +1,472 @@
+#include "align.h"
+#include "epoch.h"
+#include "mcc_err.h"
+#include "mcc_rcu_hash_map.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A chained hash table whose readers follow the read-copy-update pattern.
+ *
+ * Readers only pin the current epoch, which writes to a cache line of their
+ * own, and then follow the bucket and next pointers with acquire loads.
+ * Writers take a mutex and never change a node that readers can reach, except
+ * for its next pointer: a new value goes into a copy of the node that replaces
+ * it in the chain, and a removed node keeps pointing to its successor so that
+ * a reader standing on it can walk on. Growing builds a second table out of
+ * copies of all nodes and publishes it with a single store. Everything that
+ * got unlinked is retired and freed once no reader can see it anymore.
+ */
+
+#define INITIAL_CAPACITY 8
+
+struct rcu_node {
+	struct epoch_entry entry;
+	const struct mcc_object_interface *V;
+	_Atomic(struct rcu_node *) next;
+	size_t hash;
+};
+
+struct rcu_table {
+	struct epoch_entry entry;
+	size_t cap;
+	unsigned int shift;
+	_Atomic(struct rcu_node *) buckets[];
+};
+
+struct mcc_rcu_hash_map_iter {
+	struct rcu_table *table;
+	struct rcu_node *curr;
+	size_t bucket;
+	size_t val_offset;
+	struct mcc_pair pair;
+};
+
+struct mcc_rcu_hash_map {
+	const struct mcc_object_interface *K;
+	const struct mcc_object_interface *V;
+	_Atomic(struct rcu_table *) table;
+	atomic_size_t len;
+	size_t val_offset;
+	pthread_mutex_t lock;
+};
+
+static inline size_t value_offset(const struct mcc_object_interface *K)
+{
+	return round_up(K->size, sizeof(void *));
+}
+
+static inline void *key_of(struct rcu_node *node)
+{
+	return (uint8_t *)node + sizeof(struct rcu_node);
+}
+
+static inline void *value_of(struct rcu_node *node, size_t val_offset)
+{
+	return (uint8_t *)key_of(node) + val_offset;
+}
+
+static inline _Atomic(struct rcu_node *) *bucket_of(struct rcu_table *t,
+						      size_t hash)
+{
+	return &t->buckets[(hash * 0x9e3779b97f4a7c15ULL) >> t->shift];
+}
+
+static struct rcu_table *create_table(size_t cap)
+{
+	struct rcu_table *t;
+	size_t i;
+
+	t = malloc(sizeof(struct rcu_table) +
+		   cap * sizeof(_Atomic(struct rcu_node *)));
+	if (!t)
+		return NULL;
+
+	t->cap = cap;
+	t->shift = 64;
+	for (i = cap; i > 1; i >>= 1)
+		t->shift--;
+	for (i = 0; i < cap; i++)
+		atomic_init(&t->buckets[i], NULL);
+	return t;
+}
+
+static void free_table(struct epoch_entry *entry)
+{
+	free(entry);
+}
+
+static struct rcu_node *create_node(struct mcc_rcu_hash_map *self,
+				    size_t hash, const void *key,
+				    const void *value)
+{
+	struct rcu_node *node;
+
+	node = malloc(sizeof(struct rcu_node) + self->val_offset +
+		      self->V->size);
+	if (!node)
+		return NULL;
+
+	node->V = self->V;
+	node->hash = hash;
+	memcpy(key_of(node), key, self->K->size);
+	memcpy(value_of(node, self->val_offset), value, self->V->size);
+	return node;
+}
+
+static void free_node(struct epoch_entry *entry)
+{
+	const struct mcc_object_interface *K = entry->arg;
+	struct rcu_node *node = (struct rcu_node *)entry;
+
+	if (K->drop)
+		K->drop(key_of(node));
+	if (node->V->drop)
+		node->V->drop(value_of(node, value_offset(K)));
+	free(node);
+}
+
+/* For a node replaced by a copy that took over its key. */
+static void free_value(struct epoch_entry *entry)
+{
+	const struct mcc_object_interface *K = entry->arg;
+	struct rcu_node *node = (struct rcu_node *)entry;
+
+	if (node->V->drop)
+		node->V->drop(value_of(node, value_offset(K)));
+	free(node);
+}
+
+/* For a node whose key and value were both moved into a copy. */
+static void free_shell(struct epoch_entry *entry)
+{
+	free(entry);
+}
+
+/*
+ * Returns the link pointing to the node with key, or to NULL at the end of
+ * the chain. Must be called with the lock held.
+ */
+static _Atomic(struct rcu_node *) *find_link(struct mcc_rcu_hash_map *self,
+					     struct rcu_table *t, size_t hash,
+					     const void *key)
+{
+	_Atomic(struct rcu_node *) *link = bucket_of(t, hash);
+	struct rcu_node *node;
+
+	for (; (node = atomic_load_explicit(link, memory_order_relaxed));
+	     link = &node->next) {
+		if (node->hash == hash && !self->K->cmp(key_of(node), key))
+			break;
+	}
+	return link;
+}
+
+/*
+ * Doubles the number of buckets. Readers still walking the old table keep
+ * seeing the old nodes, so the new table is built from copies. Failing to
+ * grow only makes the chains longer.
+ */
+static void grow(struct mcc_rcu_hash_map *self)
+{
+	struct rcu_table *old = atomic_load_explicit(&self->table,
+						     memory_order_relaxed);
+	struct rcu_table *t = create_table(old->cap * 2);
+	size_t size = sizeof(struct rcu_node) + self->val_offset +
+		      self->V->size;
+	_Atomic(struct rcu_node *) *bucket;
+	struct rcu_node *node, *copy;
+	size_t i;
+
+	if (!t)
+		return;
+
+	for (i = 0; i < old->cap; i++) {
+		node = atomic_load_explicit(&old->buckets[i],
+					    memory_order_relaxed);
+		for (; node; node = atomic_load_explicit(&node->next,
+							 memory_order_relaxed)) {
+			copy = malloc(size);
+			if (!copy)
+				goto fail;
+
+			memcpy(copy, node, size);
+			bucket = bucket_of(t, node->hash);
+			atomic_init(&copy->next,
+				    atomic_load_explicit(bucket,
+							 memory_order_relaxed));
+			atomic_init(bucket, copy);
+		}
+	}
+
+	atomic_store_explicit(&self->table, t, memory_order_release);
+	for (i = 0; i < old->cap; i++) {
+		node = atomic_load_explicit(&old->buckets[i],
+					    memory_order_relaxed);
+		while (node) {
+			copy = atomic_load_explicit(&node->next,
+						    memory_order_relaxed);
+			epoch_retire(&node->entry, free_shell, NULL);
+			node = copy;
+		}
+	}
+	epoch_retire(&old->entry, free_table, NULL);
+	return;
+
+fail:
+	for (i = 0; i < t->cap; i++) {
+		node = atomic_load_explicit(&t->buckets[i],
+					    memory_order_relaxed);
+		while (node) {
+			copy = atomic_load_explicit(&node->next,
+						    memory_order_relaxed);
+			free(node);
+			node = copy;
+		}
+	}
+	free(t);
+}
+
+struct mcc_rcu_hash_map *
+mcc_rcu_hash_map_new(const struct mcc_object_interface *K,
+		     const struct mcc_object_interface *V)
+{
+	struct mcc_rcu_hash_map *self;
+	struct rcu_table *t;
+
+	if (!K || !V)
+		return NULL;
+
+	self = malloc(sizeof(struct mcc_rcu_hash_map));
+	if (!self)
+		return NULL;
+
+	t = create_table(INITIAL_CAPACITY);
+	if (!t) {
+		free(self);
+		return NULL;
+	}
+
+	self->K = K;
+	self->V = V;
+	self->val_offset = value_offset(K);
+	atomic_init(&self->table, t);
+	atomic_init(&self->len, 0);
+	pthread_mutex_init(&self->lock, NULL);
+	return self;
+}
+
+void mcc_rcu_hash_map_drop(struct mcc_rcu_hash_map *self)
+{
+	struct rcu_table *t;
+	struct rcu_node *node, *next;
+	size_t i;
+
+	if (!self)
+		return;
+
+	t = atomic_load(&self->table);
+	for (i = 0; i < t->cap; i++) {
+		for (node = atomic_load(&t->buckets[i]); node; node = next) {
+			next = atomic_load(&node->next);
+			node->entry.arg = self->K;
+			free_node(&node->entry);
+		}
+	}
+	free(t);
+	pthread_mutex_destroy(&self->lock);
+	free(self);
+}
+
+int mcc_rcu_hash_map_insert(struct mcc_rcu_hash_map *self, const void *key,
+			    const void *value)
+{
+	_Atomic(struct rcu_node *) *link;
+	struct rcu_node *node, *old;
+	struct rcu_table *t;
+	size_t hash, len;
+	int err = OK;
+
+	if (!self || !key || !value)
+		return INVALID_ARGUMENTS;
+
+	hash = self->K->hash(key);
+	pthread_mutex_lock(&self->lock);
+	if (epoch_enter()) {
+		pthread_mutex_unlock(&self->lock);
+		return CANNOT_ALLOCATE_MEMORY;
+	}
+
+	t = atomic_load_explicit(&self->table, memory_order_relaxed);
+	link = find_link(self, t, hash, key);
+	old = atomic_load_explicit(link, memory_order_relaxed);
+
+	/* When used as a set, the size of V is 0. */
+	if (old && !self->V->size)
+		goto out;
+
+	node = create_node(self, hash, old ? key_of(old) : key, value);
+	if (!node) {
+		err = CANNOT_ALLOCATE_MEMORY;
+		goto out;
+	}
+
+	if (old) {
+		atomic_init(&node->next, atomic_load_explicit(
+				&old->next, memory_order_relaxed));
+		atomic_store_explicit(link, node, memory_order_release);
+		epoch_retire(&old->entry, free_value, self->K);
+		goto out;
+	}
+
+	link = bucket_of(t, hash);
+	atomic_init(&node->next,
+		    atomic_load_explicit(link, memory_order_relaxed));
+	atomic_store_explicit(link, node, memory_order_release);
+
+	len = atomic_load_explicit(&self->len, memory_order_relaxed) + 1;
+	atomic_store_explicit(&self->len, len, memory_order_relaxed);
+	if (len > t->cap)
+		grow(self);
+out:
+	epoch_exit();
+	pthread_mutex_unlock(&self->lock);
+	return err;
+}
+
+int mcc_rcu_hash_map_remove(struct mcc_rcu_hash_map *self, const void *key)
+{
+	_Atomic(struct rcu_node *) *link;
+	struct rcu_node *node;
+	struct rcu_table *t;
+	size_t hash, len;
+	int err = NONE;
+
+	if (!self || !key)
+		return INVALID_ARGUMENTS;
+
+	hash = self->K->hash(key);
+	pthread_mutex_lock(&self->lock);
+	if (epoch_enter()) {
+		pthread_mutex_unlock(&self->lock);
+		return CANNOT_ALLOCATE_MEMORY;
+	}
+
+	t = atomic_load_explicit(&self->table, memory_order_relaxed);
+	link = find_link(self, t, hash, key);
+	node = atomic_load_explicit(link, memory_order_relaxed);
+	if (node) {
+		atomic_store_explicit(link,
+				      atomic_load_explicit(&node->next,
+							   memory_order_relaxed),
+				      memory_order_release);
+		epoch_retire(&node->entry, free_node, self->K);
+		len = atomic_load_explicit(&self->len, memory_order_relaxed);
+		atomic_store_explicit(&self->len, len - 1,
+				      memory_order_relaxed);
+		err = OK;
+	}
+
+	epoch_exit();
+	pthread_mutex_unlock(&self->lock);
+	return err;
+}
+
+int mcc_rcu_hash_map_get(struct mcc_rcu_hash_map *self, const void *key,
+			 void *value)
+{
+	struct rcu_table *t;
+	struct rcu_node *node;
+	size_t hash;
+	int err;
+
+	if (!self || !key)
+		return INVALID_ARGUMENTS;
+
+	hash = self->K->hash(key);
+	err = epoch_enter();
+	if (err)
+		return err;
+
+	t = atomic_load_explicit(&self->table, memory_order_acquire);
+	node = atomic_load_explicit(bucket_of(t, hash), memory_order_acquire);
+	for (; node; node = atomic_load_explicit(&node->next,
+						 memory_order_acquire)) {
+		if (node->hash == hash && !self->K->cmp(key_of(node), key))
+			break;
+	}
+
+	if (node && value)
+		memcpy(value, value_of(node, self->val_offset), self->V->size);
+	epoch_exit();
+	return node ? OK : NONE;
+}
+
+size_t mcc_rcu_hash_map_len(struct mcc_rcu_hash_map *self)
+{
+	return !self ? 0 : atomic_load(&self->len);
+}
+
+bool mcc_rcu_hash_map_is_empty(struct mcc_rcu_hash_map *self)
+{
+	return mcc_rcu_hash_map_len(self) == 0;
+}
+
+struct mcc_rcu_hash_map_iter *
+mcc_rcu_hash_map_iter_new(struct mcc_rcu_hash_map *map)
+{
+	struct mcc_rcu_hash_map_iter *self;
+
+	if (!map)
+		return NULL;
+
+	self = malloc(sizeof(struct mcc_rcu_hash_map_iter));
+	if (!self)
+		return NULL;
+
+	if (epoch_enter()) {
+		free(self);
+		return NULL;
+	}
+
+	self->table = atomic_load_explicit(&map->table, memory_order_acquire);
+	self->curr = NULL;
+	self->bucket = 0;
+	self->val_offset = map->val_offset;
+	return self;
+}
+
+void mcc_rcu_hash_map_iter_drop(struct mcc_rcu_hash_map_iter *self)
+{
+	if (!self)
+		return;
+
+	epoch_exit();
+	free(self);
+}
+
+bool mcc_rcu_hash_map_iter_next(struct mcc_rcu_hash_map_iter *self,
+				struct mcc_pair **ref)
+{
+	struct rcu_node *node;
+
+	if (!self || !ref)
+		return false;
+
+	node = self->curr;
+	while (!node && self->bucket < self->table->cap) {
+		node = atomic_load_explicit(
+			&self->table->buckets[self->bucket++],
+			memory_order_acquire);
+	}
+	if (!node)
+		return false;
+
+	self->curr = atomic_load_explicit(&node->next, memory_order_acquire);
+	self->pair.key = key_of(node);
+	self->pair.value = value_of(node, self->val_offset);
+	*ref = &self->pair;
+	return true;
+}
@@ -1,3 +1,4 @@
+#include "mcc_err.h"
 #include "mcc_map.h"
 #include "mcc_set.h"
 
@@ -6,6 +7,9 @@
 #define SET(PTR) ((struct mcc_set *)(PTR))
 #define SET_ITER(PTR) ((struct mcc_set_iter *)(PTR))
 
+/* Number of entries next_n takes from the map at a time. */
+#define ITER_BATCH 32
+
 static const struct mcc_object_interface none = {
 	.size = 0,
 	.drop = (mcc_drop_fn)0,
@@ -18,6 +22,25 @@ struct mcc_set *mcc_set_new(const struct mcc_object_interface *T)
 	return SET(mcc_map_new(T, &none));
 }
 
+struct mcc_set *mcc_set_new_in(struct mcc_arena *arena,
+			       const struct mcc_object_interface *T)
+{
+	return SET(mcc_map_new_in(arena, T, &none));
+}
+
+struct mcc_set *
+mcc_set_new_with_allocator(const struct mcc_allocator *allocator,
+			   const struct mcc_object_interface *T)
+{
+	return SET(mcc_map_new_with_allocator(allocator, T, &none));
+}
+
+struct mcc_set *mcc_set_from_sorted(const struct mcc_object_interface *T,
+				    const void *values, size_t n)
+{
+	return SET(mcc_map_from_sorted(T, &none, values, NULL, n));
+}
+
 void mcc_set_drop(struct mcc_set *self)
 {
 	mcc_map_drop(MAP(self));
@@ -33,6 +56,16 @@ void mcc_set_remove(struct mcc_set *self, const void *value)
 	mcc_map_remove(MAP(self), value);
 }
 
+void mcc_set_pop_first(struct mcc_set *self)
+{
+	mcc_map_pop_first(MAP(self));
+}
+
+void mcc_set_pop_last(struct mcc_set *self)
+{
+	mcc_map_pop_last(MAP(self));
+}
+
 void mcc_set_clear(struct mcc_set *self)
 {
 	mcc_map_clear(MAP(self));
@@ -49,6 +82,28 @@ int mcc_set_get(struct mcc_set *self, const void *value, const void **ref)
 	return err;
 }
 
+int mcc_set_first(struct mcc_set *self, const void **ref)
+{
+	struct mcc_pair *pair;
+	int err;
+
+	err = mcc_map_first(MAP(self), &pair);
+	if (!err)
+		*ref = pair->key;
+	return err;
+}
+
+int mcc_set_last(struct mcc_set *self, const void **ref)
+{
+	struct mcc_pair *pair;
+	int err;
+
+	err = mcc_map_last(MAP(self), &pair);
+	if (!err)
+		*ref = pair->key;
+	return err;
+}
+
 size_t mcc_set_len(struct mcc_set *self)
 {
 	return mcc_map_len(MAP(self));
@@ -59,11 +114,68 @@ bool mcc_set_is_empty(struct mcc_set *self)
 	return mcc_map_is_empty(MAP(self));
 }
 
+int mcc_set_rank(struct mcc_set *self, const void *value, size_t *rank)
+{
+	return mcc_map_rank(MAP(self), value, rank);
+}
+
+int mcc_set_select(struct mcc_set *self, size_t index, const void **ref)
+{
+	struct mcc_pair *pair;
+	int err;
+
+	err = mcc_map_select(MAP(self), index, &pair);
+	if (!err)
+		*ref = pair->key;
+	return err;
+}
+
+int mcc_set_count_range(struct mcc_set *self, const void *lo, const void *hi,
+			size_t *count)
+{
+	return mcc_map_count_range(MAP(self), lo, hi, count);
+}
+
+struct mcc_set *mcc_set_split(struct mcc_set *self, const void *value)
+{
+	return SET(mcc_map_split(MAP(self), value));
+}
+
+int mcc_set_join(struct mcc_set *self, struct mcc_set *other)
+{
+	return mcc_map_join(MAP(self), MAP(other));
+}
+
+int mcc_set_union(struct mcc_set *self, struct mcc_set *other)
+{
+	return mcc_map_union(MAP(self), MAP(other));
+}
+
+int mcc_set_intersection(struct mcc_set *self, struct mcc_set *other)
+{
+	return mcc_map_intersection(MAP(self), MAP(other));
+}
+
+int mcc_set_difference(struct mcc_set *self, struct mcc_set *other)
+{
+	return mcc_map_difference(MAP(self), MAP(other));
+}
+
+int mcc_set_parallelism(struct mcc_set *self, size_t nthreads)
+{
+	return mcc_map_parallelism(MAP(self), nthreads);
+}
+
 struct mcc_set_iter *mcc_set_iter_new(struct mcc_set *set)
 {
 	return SET_ITER(mcc_map_iter_new(MAP(set)));
 }
 
+int mcc_set_iter_init(struct mcc_set_iter *self, struct mcc_set *set)
+{
+	return mcc_map_iter_init(MAP_ITER(self), MAP(set));
+}
+
 void mcc_set_iter_drop(struct mcc_set_iter *self)
 {
 	mcc_map_iter_drop(MAP_ITER(self));
@@ -80,3 +192,102 @@ bool mcc_set_iter_next(struct mcc_set_iter *self, const void **ref)
 		return false;
 	}
 }
+
+bool mcc_set_iter_prev(struct mcc_set_iter *self, const void **ref)
+{
+	struct mcc_pair *pair;
+
+	if (mcc_map_iter_prev(MAP_ITER(self), &pair)) {
+		*ref = pair->key;
+		return true;
+	} else {
+		return false;
+	}
+}
+
+void mcc_set_iter_seek_ge(struct mcc_set_iter *self, const void *value)
+{
+	mcc_map_iter_seek_ge(MAP_ITER(self), value);
+}
+
+void mcc_set_iter_seek_gt(struct mcc_set_iter *self, const void *value)
+{
+	mcc_map_iter_seek_gt(MAP_ITER(self), value);
+}
+
+void mcc_set_iter_seek_begin(struct mcc_set_iter *self)
+{
+	mcc_map_iter_seek_begin(MAP_ITER(self));
+}
+
+void mcc_set_iter_seek_end(struct mcc_set_iter *self)
+{
+	mcc_map_iter_seek_end(MAP_ITER(self));
+}
+
+void mcc_set_iter_seek_nth(struct mcc_set_iter *self, size_t index)
+{
+	mcc_map_iter_seek_nth(MAP_ITER(self), index);
+}
+
+size_t mcc_set_iter_next_n(struct mcc_set_iter *self, const void **refs,
+			   size_t n)
+{
+	struct mcc_pair pairs[ITER_BATCH];
+	size_t i, m, total = 0;
+
+	if (!refs)
+		return 0;
+
+	while (total < n) {
+		m = n - total < ITER_BATCH ? n - total : ITER_BATCH;
+		m = mcc_map_iter_next_n(MAP_ITER(self), pairs, m);
+		for (i = 0; i < m; i++)
+			refs[total + i] = pairs[i].key;
+		total += m;
+		if (m < ITER_BATCH)
+			break;
+	}
+	return total;
+}
+
+struct visit_values {
+	mcc_const_visit_fn fn;
+	void *ctx;
+};
+
+static int visit_value(struct mcc_pair *pair, void *ctx)
+{
+	struct visit_values *v = ctx;
+
+	return v->fn(pair->key, v->ctx);
+}
+
+int mcc_set_for_each(struct mcc_set *self, mcc_const_visit_fn fn, void *ctx)
+{
+	struct visit_values v = {fn, ctx};
+
+	if (!fn)
+		return INVALID_ARGUMENTS;
+
+	return mcc_map_for_each(MAP(self), visit_value, &v);
+}
+
+struct fold_values {
+	mcc_fold_fn fn;
+	void *acc;
+};
+
+static bool fold_value(const struct mcc_pair *pair, void *acc)
+{
+	struct fold_values *f = acc;
+
+	return f->fn(pair->key, f->acc);
+}
+
+size_t mcc_set_fold(struct mcc_set *self, mcc_fold_fn fn, void *acc)
+{
+	struct fold_values f = {fn, acc};
+
+	return fn ? mcc_map_fold(MAP(self), fold_value, &f) : 0;
+}
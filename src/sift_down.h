@@ -1,3 +0,0 @@
-#include "mcc_vector.h"
-
-void sift_down(struct mcc_vector *self, size_t i);
@@ -0,0 +1,516 @@
+#include "epoch.h"
+#include "mcc_err.h"
+#include "mcc_skiplist_map.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A lock-free skip list in the style of Fraser and Herlihy-Shavit.
+ *
+ * An entry is removed in three steps. Setting its value to NULL is the point
+ * where the key stops being in the map. Then all its next pointers are marked
+ * (the low bit is set) so that nothing can be linked behind it anymore, and
+ * finally find() unlinks it level by level. Any thread running into a marked
+ * node helps unlinking it.
+ *
+ * A node may only be retired once it is unreachable on every level, but the
+ * thread inserting it may still be linking the upper levels while another one
+ * removes it. Both hold a reference, and whoever drops the last one after a
+ * final find() retires the node.
+ */
+
+#define MAX_HEIGHT 20 /* Enough for 4^20 entries with p = 1/4. */
+#define MARK ((uintptr_t)1)
+
+struct skiplist_node {
+	struct epoch_entry entry;
+	_Atomic(void *) value;
+	atomic_int refs;
+	int height;
+	_Atomic uintptr_t next[];
+};
+
+/* Values live in their own block so that they can be replaced atomically. */
+struct value_box {
+	struct epoch_entry entry;
+};
+
+struct mcc_skiplist_map_iter {
+	struct mcc_skiplist_map *map;
+	struct skiplist_node *curr;
+	struct mcc_pair pair;
+};
+
+struct mcc_skiplist_map {
+	const struct mcc_object_interface *K;
+	const struct mcc_object_interface *V;
+	struct skiplist_node *head;
+	atomic_size_t len;
+};
+
+/* The value of every entry when V has a size of 0. */
+static struct value_box present;
+
+static _Thread_local uint64_t seed;
+
+static inline struct skiplist_node *ptr_of(uintptr_t link)
+{
+	return (struct skiplist_node *)(link & ~MARK);
+}
+
+static inline bool is_marked(uintptr_t link)
+{
+	return link & MARK;
+}
+
+static inline void *key_of(struct skiplist_node *node)
+{
+	return (uint8_t *)node + sizeof(struct skiplist_node) +
+	       node->height * sizeof(uintptr_t);
+}
+
+static inline void *data_of(struct value_box *box)
+{
+	return (uint8_t *)box + sizeof(struct value_box);
+}
+
+static int random_height(void)
+{
+	uint64_t x = seed ? seed : (uintptr_t)&seed | 1;
+	int height = 1;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	seed = x;
+	for (x *= 0x2545f4914f6cdd1dULL; (x & 3) == 0; x >>= 2) {
+		if (++height == MAX_HEIGHT)
+			break;
+	}
+	return height;
+}
+
+static struct value_box *create_box(const void *value, size_t size)
+{
+	struct value_box *box;
+
+	if (!size)
+		return &present;
+
+	box = malloc(sizeof(struct value_box) + size);
+	if (box)
+		memcpy(data_of(box), value, size);
+	return box;
+}
+
+static void free_box(struct epoch_entry *entry)
+{
+	const struct mcc_object_interface *V = entry->arg;
+	struct value_box *box = (struct value_box *)entry;
+
+	if (V->drop)
+		V->drop(data_of(box));
+	free(box);
+}
+
+static void retire_box(struct mcc_skiplist_map *self, struct value_box *box)
+{
+	if (box != &present)
+		epoch_retire(&box->entry, free_box, self->V);
+}
+
+static void free_node(struct epoch_entry *entry)
+{
+	const struct mcc_object_interface *K = entry->arg;
+	struct skiplist_node *node = (struct skiplist_node *)entry;
+
+	if (K->drop)
+		K->drop(key_of(node));
+	free(node);
+}
+
+static void release_node(struct mcc_skiplist_map *self,
+			 struct skiplist_node *node)
+{
+	if (atomic_fetch_sub(&node->refs, 1) == 1)
+		epoch_retire(&node->entry, free_node, self->K);
+}
+
+static void mark_node(struct skiplist_node *node)
+{
+	int level;
+
+	for (level = node->height - 1; level >= 0; level--)
+		atomic_fetch_or(&node->next[level], MARK);
+}
+
+/*
+ * Fills preds and succs with the nodes around key on every level, unlinking
+ * the marked nodes on the way. Returns the node holding key, if any.
+ */
+static struct skiplist_node *find(struct mcc_skiplist_map *self,
+				  const void *key, struct skiplist_node **preds,
+				  struct skiplist_node **succs)
+{
+	struct skiplist_node *pred, *curr, *last;
+	uintptr_t succ, expected;
+	int level, res, last_res;
+
+retry:
+	pred = self->head;
+	last = NULL;
+	last_res = 1;
+	for (level = MAX_HEIGHT - 1; level >= 0; level--) {
+		curr = ptr_of(atomic_load(&pred->next[level]));
+		while (curr) {
+			succ = atomic_load(&curr->next[level]);
+			if (is_marked(succ)) {
+				expected = (uintptr_t)curr;
+				if (!atomic_compare_exchange_strong(
+					    &pred->next[level], &expected,
+					    succ & ~MARK))
+					goto retry;
+				curr = ptr_of(succ);
+				continue;
+			}
+
+			/* The node right above is compared only once. */
+			res = curr == last ? last_res :
+					     self->K->cmp(key_of(curr), key);
+			if (res < 0) {
+				pred = curr;
+				curr = ptr_of(succ);
+			} else if (res == 0 && !atomic_load(&curr->value)) {
+				/* Help a remove that has not marked it yet. */
+				mark_node(curr);
+			} else {
+				last = curr;
+				last_res = res;
+				break;
+			}
+		}
+		preds[level] = pred;
+		succs[level] = curr;
+	}
+	return succs[0] && last == succs[0] && last_res == 0 ? succs[0] : NULL;
+}
+
+/*
+ * Returns the first node with a key >= key (or > key if strict) without
+ * modifying the list. The node may be in the middle of being removed.
+ */
+static struct skiplist_node *lower_bound(struct mcc_skiplist_map *self,
+					 const void *key, bool strict)
+{
+	struct skiplist_node *pred = self->head, *curr = NULL, *last = NULL;
+	int level, res;
+
+	for (level = MAX_HEIGHT - 1; level >= 0; level--) {
+		curr = ptr_of(atomic_load(&pred->next[level]));
+		while (curr && curr != last) {
+			res = self->K->cmp(key_of(curr), key);
+			if (res > 0 || (res == 0 && !strict))
+				break;
+			pred = curr;
+			curr = ptr_of(atomic_load(&curr->next[level]));
+		}
+		last = curr;
+	}
+	return curr;
+}
+
+struct mcc_skiplist_map *
+mcc_skiplist_map_new(const struct mcc_object_interface *K,
+		     const struct mcc_object_interface *V)
+{
+	struct mcc_skiplist_map *self;
+
+	if (!K || !V)
+		return NULL;
+
+	self = calloc(1, sizeof(struct mcc_skiplist_map));
+	if (!self)
+		return NULL;
+
+	self->head = calloc(1, sizeof(struct skiplist_node) +
+				       MAX_HEIGHT * sizeof(uintptr_t));
+	if (!self->head) {
+		free(self);
+		return NULL;
+	}
+
+	self->head->height = MAX_HEIGHT;
+	self->K = K;
+	self->V = V;
+	return self;
+}
+
+void mcc_skiplist_map_drop(struct mcc_skiplist_map *self)
+{
+	struct skiplist_node *node, *next;
+	struct value_box *box;
+
+	if (!self)
+		return;
+
+	for (node = ptr_of(self->head->next[0]); node; node = next) {
+		next = ptr_of(node->next[0]);
+		box = atomic_load(&node->value);
+		if (box) {
+			box->entry.arg = self->V;
+			if (box != &present)
+				free_box(&box->entry);
+		}
+		node->entry.arg = self->K;
+		free_node(&node->entry);
+	}
+
+	free(self->head);
+	free(self);
+}
+
+/* Links the upper levels of a node that is already in the list. */
+static void link_upper_levels(struct mcc_skiplist_map *self,
+			      struct skiplist_node *node,
+			      struct skiplist_node **preds,
+			      struct skiplist_node **succs)
+{
+	uintptr_t old, expected;
+	int level;
+
+	for (level = 1; level < node->height; level++) {
+		while (true) {
+			old = atomic_load(&node->next[level]);
+			if (is_marked(old))
+				return;
+			if (old != (uintptr_t)succs[level] &&
+			    !atomic_compare_exchange_strong(
+				    &node->next[level], &old,
+				    (uintptr_t)succs[level]))
+				continue;
+
+			expected = (uintptr_t)succs[level];
+			if (atomic_compare_exchange_strong(
+				    &preds[level]->next[level], &expected,
+				    (uintptr_t)node))
+				break;
+			if (find(self, key_of(node), preds, succs) != node)
+				return;
+		}
+	}
+}
+
+int mcc_skiplist_map_insert(struct mcc_skiplist_map *self, const void *key,
+			    const void *value)
+{
+	struct skiplist_node *preds[MAX_HEIGHT], *succs[MAX_HEIGHT];
+	struct skiplist_node *node = NULL, *found;
+	struct value_box *box, *old;
+	uintptr_t expected;
+	int err, height, level;
+
+	if (!self || !key || !value)
+		return INVALID_ARGUMENTS;
+
+	box = create_box(value, self->V->size);
+	if (!box)
+		return CANNOT_ALLOCATE_MEMORY;
+
+	err = epoch_enter();
+	if (err)
+		goto fail;
+
+	while (true) {
+		found = find(self, key, preds, succs);
+		if (found) {
+			old = atomic_load(&found->value);
+			while (old && !atomic_compare_exchange_weak(
+					      &found->value, (void **)&old, box))
+				;
+			if (!old) /* Removed meanwhile, try again. */
+				continue;
+
+			retire_box(self, old);
+			epoch_exit();
+			free(node);
+			return OK;
+		}
+
+		if (!node) {
+			height = random_height();
+			node = malloc(sizeof(struct skiplist_node) +
+				      height * sizeof(uintptr_t) +
+				      self->K->size);
+			if (!node) {
+				epoch_exit();
+				err = CANNOT_ALLOCATE_MEMORY;
+				goto fail;
+			}
+			node->height = height;
+			atomic_init(&node->value, box);
+			atomic_init(&node->refs, 2);
+			memcpy(key_of(node), key, self->K->size);
+		}
+
+		for (level = 0; level < node->height; level++)
+			atomic_init(&node->next[level], (uintptr_t)succs[level]);
+
+		expected = (uintptr_t)succs[0];
+		if (atomic_compare_exchange_strong(&preds[0]->next[0],
+						   &expected, (uintptr_t)node))
+			break;
+	}
+
+	atomic_fetch_add(&self->len, 1);
+	link_upper_levels(self, node, preds, succs);
+	if (!atomic_load(&node->value))
+		find(self, key, preds, succs);
+	release_node(self, node);
+	epoch_exit();
+	return OK;
+
+fail:
+	if (box != &present)
+		free(box);
+	return err;
+}
+
+int mcc_skiplist_map_remove(struct mcc_skiplist_map *self, const void *key)
+{
+	struct skiplist_node *preds[MAX_HEIGHT], *succs[MAX_HEIGHT], *node;
+	struct value_box *box = NULL;
+	int err;
+
+	if (!self || !key)
+		return INVALID_ARGUMENTS;
+
+	err = epoch_enter();
+	if (err)
+		return err;
+
+	node = find(self, key, preds, succs);
+	if (node) {
+		box = atomic_load(&node->value);
+		while (box && !atomic_compare_exchange_weak(
+				      &node->value, (void **)&box, NULL))
+			;
+	}
+
+	if (!box) {
+		epoch_exit();
+		return NONE;
+	}
+
+	atomic_fetch_sub(&self->len, 1);
+	mark_node(node);
+	find(self, key, preds, succs);
+	retire_box(self, box);
+	release_node(self, node);
+	epoch_exit();
+	return OK;
+}
+
+int mcc_skiplist_map_get(struct mcc_skiplist_map *self, const void *key,
+			 void *value)
+{
+	struct skiplist_node *node;
+	struct value_box *box = NULL;
+	int err;
+
+	if (!self || !key)
+		return INVALID_ARGUMENTS;
+
+	err = epoch_enter();
+	if (err)
+		return err;
+
+	node = lower_bound(self, key, false);
+	if (node && self->K->cmp(key_of(node), key) == 0)
+		box = atomic_load(&node->value);
+	if (box && value)
+		memcpy(value, data_of(box), self->V->size);
+
+	epoch_exit();
+	return box ? OK : NONE;
+}
+
+size_t mcc_skiplist_map_len(struct mcc_skiplist_map *self)
+{
+	return !self ? 0 : atomic_load(&self->len);
+}
+
+bool mcc_skiplist_map_is_empty(struct mcc_skiplist_map *self)
+{
+	return mcc_skiplist_map_len(self) == 0;
+}
+
+struct mcc_skiplist_map_iter *
+mcc_skiplist_map_iter_new(struct mcc_skiplist_map *map)
+{
+	struct mcc_skiplist_map_iter *self;
+
+	if (!map)
+		return NULL;
+
+	self = malloc(sizeof(struct mcc_skiplist_map_iter));
+	if (!self)
+		return NULL;
+
+	if (epoch_enter()) {
+		free(self);
+		return NULL;
+	}
+
+	self->map = map;
+	self->curr = ptr_of(atomic_load(&map->head->next[0]));
+	return self;
+}
+
+void mcc_skiplist_map_iter_drop(struct mcc_skiplist_map_iter *self)
+{
+	if (!self)
+		return;
+
+	epoch_exit();
+	free(self);
+}
+
+bool mcc_skiplist_map_iter_next(struct mcc_skiplist_map_iter *self,
+				struct mcc_pair **ref)
+{
+	struct skiplist_node *node;
+	struct value_box *box;
+
+	if (!self || !ref)
+		return false;
+
+	for (node = self->curr; node; node = ptr_of(node->next[0])) {
+		box = atomic_load(&node->value);
+		if (!box)
+			continue;
+
+		self->curr = ptr_of(atomic_load(&node->next[0]));
+		self->pair.key = key_of(node);
+		self->pair.value = data_of(box);
+		*ref = &self->pair;
+		return true;
+	}
+
+	self->curr = NULL;
+	return false;
+}
+
+void mcc_skiplist_map_iter_seek_ge(struct mcc_skiplist_map_iter *self,
+				   const void *key)
+{
+	if (self && key)
+		self->curr = lower_bound(self->map, key, false);
+}
+
+void mcc_skiplist_map_iter_seek_gt(struct mcc_skiplist_map_iter *self,
+				   const void *key)
+{
+	if (self && key)
+		self->curr = lower_bound(self->map, key, true);
+}
@@ -0,0 +1,494 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "memswap.h"
+#include "sort.h"
+
+/*
+ * Pattern-defeating quicksort (Orson Peters) over a struct sort_seq. It is an
+ * introsort with insertion sort for short ranges, a median of three (ninther
+ * for large ranges) pivot, detection of already partitioned ranges, a fast
+ * path for runs of equal elements and a heapsort fallback once too many
+ * partitions turn out unbalanced. Elements are only ever swapped, so no
+ * scratch space of the element size is needed.
+ */
+
+enum {
+	INSERTION_SORT_THRESHOLD = 24,
+	NINTHER_THRESHOLD = 128,
+	PARTIAL_INSERTION_SORT_LIMIT = 8,
+};
+
+static inline uint8_t *at(const struct sort_seq *seq, size_t i)
+{
+	if (i < seq->split)
+		return seq->first + i * seq->size;
+	else
+		return seq->second + (i - seq->split) * seq->size;
+}
+
+static inline bool less(const struct sort_seq *seq, size_t a, size_t b)
+{
+	return seq->cmp(at(seq, a), at(seq, b)) < 0;
+}
+
+static inline void swap(const struct sort_seq *seq, size_t a, size_t b)
+{
+	uint8_t *p1 = at(seq, a), *p2 = at(seq, b);
+	uint64_t t8, u8;
+	uint32_t t4, u4;
+
+	/* Word sized elements are swapped through registers. */
+	switch (seq->size) {
+	case 4:
+		memcpy(&t4, p1, 4);
+		memcpy(&u4, p2, 4);
+		memcpy(p1, &u4, 4);
+		memcpy(p2, &t4, 4);
+		break;
+	case 8:
+		memcpy(&t8, p1, 8);
+		memcpy(&u8, p2, 8);
+		memcpy(p1, &u8, 8);
+		memcpy(p2, &t8, 8);
+		break;
+	case 16:
+		memcpy(&t8, p1, 8);
+		memcpy(&u8, p2, 8);
+		memcpy(p1, &u8, 8);
+		memcpy(p2, &t8, 8);
+		memcpy(&t8, p1 + 8, 8);
+		memcpy(&u8, p2 + 8, 8);
+		memcpy(p1 + 8, &u8, 8);
+		memcpy(p2 + 8, &t8, 8);
+		break;
+	default:
+		memswap(p1, p2, seq->size);
+		break;
+	}
+}
+
+static inline void sort2(const struct sort_seq *seq, size_t a, size_t b)
+{
+	if (less(seq, b, a))
+		swap(seq, a, b);
+}
+
+static inline void sort3(const struct sort_seq *seq, size_t a, size_t b,
+			 size_t c)
+{
+	sort2(seq, a, b);
+	sort2(seq, b, c);
+	sort2(seq, a, b);
+}
+
+static void insertion_sort(const struct sort_seq *seq, size_t begin,
+			   size_t end)
+{
+	size_t i, j;
+
+	for (i = begin + 1; i < end; i++) {
+		for (j = i; j > begin && less(seq, j, j - 1); j--)
+			swap(seq, j, j - 1);
+	}
+}
+
+/*
+ * Insertion sort for a range that is not the leftmost one: the element before
+ * begin is not greater than any element of the range and stops the scan.
+ */
+static void unguarded_insertion_sort(const struct sort_seq *seq, size_t begin,
+				     size_t end)
+{
+	size_t i, j;
+
+	for (i = begin + 1; i < end; i++) {
+		for (j = i; less(seq, j, j - 1); j--)
+			swap(seq, j, j - 1);
+	}
+}
+
+/*
+ * Try to sort the range with insertion sort, giving up once more than
+ * PARTIAL_INSERTION_SORT_LIMIT elements have been moved.
+ */
+static bool partial_insertion_sort(const struct sort_seq *seq, size_t begin,
+				   size_t end)
+{
+	size_t i, j, moved = 0;
+
+	if (begin == end)
+		return true;
+
+	for (i = begin + 1; i < end; i++) {
+		for (j = i; j > begin && less(seq, j, j - 1); j--)
+			swap(seq, j, j - 1);
+
+		moved += i - j;
+		if (moved > PARTIAL_INSERTION_SORT_LIMIT)
+			return false;
+	}
+	return true;
+}
+
+static void sift_down(const struct sort_seq *seq, size_t begin, size_t i,
+		      size_t n)
+{
+	size_t child;
+
+	while ((child = 2 * i + 1) < n) {
+		if (child + 1 < n &&
+		    less(seq, begin + child, begin + child + 1))
+			child++;
+		if (!less(seq, begin + i, begin + child))
+			break;
+		swap(seq, begin + i, begin + child);
+		i = child;
+	}
+}
+
+static void heap_sort(const struct sort_seq *seq, size_t begin, size_t end)
+{
+	size_t n = end - begin, i;
+
+	for (i = n >> 1; i-- > 0;)
+		sift_down(seq, begin, i, n);
+
+	for (i = n - 1; i > 0; i--) {
+		swap(seq, begin, begin + i);
+		sift_down(seq, begin, 0, i);
+	}
+}
+
+/*
+ * Partition around the pivot at begin. Elements equal to the pivot go to the
+ * right. Return the final position of the pivot and report whether the range
+ * was already partitioned.
+ */
+static size_t partition_right(const struct sort_seq *seq, size_t begin,
+			      size_t end, bool *already_partitioned)
+{
+	size_t first = begin, last = end, pivot;
+
+	/* The pivot selection guarantees an element >= pivot at end - 1. */
+	while (less(seq, ++first, begin))
+		;
+
+	if (first - 1 == begin) {
+		while (first < last && !less(seq, --last, begin))
+			;
+	} else {
+		while (!less(seq, --last, begin))
+			;
+	}
+
+	*already_partitioned = first >= last;
+
+	while (first < last) {
+		swap(seq, first, last);
+		while (less(seq, ++first, begin))
+			;
+		while (!less(seq, --last, begin))
+			;
+	}
+
+	pivot = first - 1;
+	swap(seq, begin, pivot);
+	return pivot;
+}
+
+/*
+ * Partition around the pivot at begin, putting elements equal to the pivot
+ * to the left. Used when the pivot equals the element before the range, in
+ * which case the left part needs no further sorting.
+ */
+static size_t partition_left(const struct sort_seq *seq, size_t begin,
+			     size_t end)
+{
+	size_t first = begin, last = end;
+
+	while (less(seq, begin, --last))
+		;
+
+	if (last + 1 == end) {
+		while (first < last && !less(seq, begin, ++first))
+			;
+	} else {
+		while (!less(seq, begin, ++first))
+			;
+	}
+
+	while (first < last) {
+		swap(seq, first, last);
+		while (less(seq, begin, --last))
+			;
+		while (!less(seq, begin, ++first))
+			;
+	}
+
+	swap(seq, begin, last);
+	return last;
+}
+
+/* Swap a few elements around to break patterns that defeat the pivot. */
+static void break_patterns(const struct sort_seq *seq, size_t begin,
+			   size_t pivot, size_t end)
+{
+	size_t l_size = pivot - begin, r_size = end - (pivot + 1);
+
+	if (l_size >= INSERTION_SORT_THRESHOLD) {
+		swap(seq, begin, begin + l_size / 4);
+		swap(seq, pivot - 1, pivot - l_size / 4);
+		if (l_size > NINTHER_THRESHOLD) {
+			swap(seq, begin + 1, begin + (l_size / 4 + 1));
+			swap(seq, begin + 2, begin + (l_size / 4 + 2));
+			swap(seq, pivot - 2, pivot - (l_size / 4 + 1));
+			swap(seq, pivot - 3, pivot - (l_size / 4 + 2));
+		}
+	}
+
+	if (r_size >= INSERTION_SORT_THRESHOLD) {
+		swap(seq, pivot + 1, pivot + (1 + r_size / 4));
+		swap(seq, end - 1, end - r_size / 4);
+		if (r_size > NINTHER_THRESHOLD) {
+			swap(seq, pivot + 2, pivot + (2 + r_size / 4));
+			swap(seq, pivot + 3, pivot + (3 + r_size / 4));
+			swap(seq, end - 2, end - (1 + r_size / 4));
+			swap(seq, end - 3, end - (2 + r_size / 4));
+		}
+	}
+}
+
+static void pdq_sort_loop(const struct sort_seq *seq, size_t begin,
+			  size_t end, int bad_allowed, bool leftmost)
+{
+	size_t size, half, pivot;
+	bool already_partitioned;
+
+	while (true) {
+		size = end - begin;
+		if (size < INSERTION_SORT_THRESHOLD) {
+			if (leftmost)
+				insertion_sort(seq, begin, end);
+			else
+				unguarded_insertion_sort(seq, begin, end);
+			return;
+		}
+
+		/* Move the pivot to begin. */
+		half = size / 2;
+		if (size > NINTHER_THRESHOLD) {
+			sort3(seq, begin, begin + half, end - 1);
+			sort3(seq, begin + 1, begin + (half - 1), end - 2);
+			sort3(seq, begin + 2, begin + (half + 1), end - 3);
+			sort3(seq, begin + (half - 1), begin + half,
+			      begin + (half + 1));
+			swap(seq, begin, begin + half);
+		} else {
+			sort3(seq, begin + half, begin, end - 1);
+		}
+
+		/*
+		 * If the pivot equals the element before the range, every
+		 * element equal to it is already in place.
+		 */
+		if (!leftmost && !less(seq, begin - 1, begin)) {
+			begin = partition_left(seq, begin, end) + 1;
+			continue;
+		}
+
+		pivot = partition_right(seq, begin, end, &already_partitioned);
+
+		if (pivot - begin < size / 8 || end - (pivot + 1) < size / 8) {
+			if (--bad_allowed == 0) {
+				heap_sort(seq, begin, end);
+				return;
+			}
+			break_patterns(seq, begin, pivot, end);
+		} else if (already_partitioned &&
+			   partial_insertion_sort(seq, begin, pivot) &&
+			   partial_insertion_sort(seq, pivot + 1, end)) {
+			return;
+		}
+
+		/* Recurse into the left part, loop on the right one. */
+		pdq_sort_loop(seq, begin, pivot, bad_allowed, leftmost);
+		begin = pivot + 1;
+		leftmost = false;
+	}
+}
+
+void pdq_sort(const struct sort_seq *seq)
+{
+	int log2 = 0;
+
+	if (seq->len <= 1)
+		return;
+
+	while (seq->len >> log2 > 1)
+		log2++;
+
+	pdq_sort_loop(seq, 0, seq->len, log2, true);
+}
+
+/*
+ * LSD radix sort for the built-in integer and floating point interfaces.
+ * Keys are first mapped in place to unsigned integers of the same width that
+ * sort in the same order, then sorted one byte per pass, then mapped back.
+ */
+
+enum radix_kind {
+	RADIX_NONE,
+	RADIX_UNSIGNED,
+	RADIX_SIGNED,
+	RADIX_FLOAT,
+};
+
+enum { RADIX_SORT_THRESHOLD = 256 };
+
+static enum radix_kind radix_kind_of(const struct mcc_object_interface *T)
+{
+	if (T == mcc_uchar() || T == mcc_ushort() || T == mcc_uint() ||
+	    T == mcc_ulong() || T == mcc_ulong_long())
+		return RADIX_UNSIGNED;
+
+	if (T == mcc_char() || T == mcc_short() || T == mcc_int() ||
+	    T == mcc_long() || T == mcc_long_long())
+		return RADIX_SIGNED;
+
+	if (T == mcc_float() || T == mcc_double())
+		return RADIX_FLOAT;
+
+	return RADIX_NONE;
+}
+
+/*
+ * Signed integers only need their sign bit flipped. A non-negative float gets
+ * its sign bit set, a negative one gets all its bits flipped, so that larger
+ * magnitudes of negative numbers sort first.
+ */
+#define DEFINE_RADIX_SORT(BITS)                                                \
+	static void encode_##BITS(uint##BITS##_t *a, size_t n,                 \
+				  enum radix_kind kind)                        \
+	{                                                                      \
+		const uint##BITS##_t sign = (uint##BITS##_t)1 << (BITS - 1);   \
+		size_t i;                                                      \
+                                                                               \
+		if (kind == RADIX_SIGNED) {                                    \
+			for (i = 0; i < n; i++)                                \
+				a[i] ^= sign;                                  \
+		} else if (kind == RADIX_FLOAT) {                              \
+			for (i = 0; i < n; i++)                                \
+				a[i] = a[i] & sign ? ~a[i] : a[i] | sign;      \
+		}                                                              \
+	}                                                                      \
+                                                                               \
+	static void decode_##BITS(uint##BITS##_t *a, size_t n,                 \
+				  enum radix_kind kind)                        \
+	{                                                                      \
+		const uint##BITS##_t sign = (uint##BITS##_t)1 << (BITS - 1);   \
+		size_t i;                                                      \
+                                                                               \
+		if (kind == RADIX_SIGNED) {                                    \
+			for (i = 0; i < n; i++)                                \
+				a[i] ^= sign;                                  \
+		} else if (kind == RADIX_FLOAT) {                              \
+			for (i = 0; i < n; i++)                                \
+				a[i] = a[i] & sign ? a[i] ^ sign : ~a[i];      \
+		}                                                              \
+	}                                                                      \
+                                                                               \
+	static void radix_sort_##BITS(uint##BITS##_t *a, uint##BITS##_t *buf,  \
+				      size_t n, enum radix_kind kind)          \
+	{                                                                      \
+		enum { PASSES = BITS / 8 };                                    \
+		size_t count[PASSES][256];                                     \
+		uint##BITS##_t *src = a, *dst = buf, *tmp;                     \
+		size_t i, pass, sum, c;                                        \
+		unsigned int digit;                                            \
+                                                                               \
+		encode_##BITS(a, n, kind);                                     \
+                                                                               \
+		/* Count every digit of every pass in a single read. */       \
+		memset(count, 0, sizeof(count));                               \
+		for (i = 0; i < n; i++) {                                      \
+			for (pass = 0; pass < PASSES; pass++)                  \
+				count[pass][(src[i] >> (pass * 8)) & 0xff]++;  \
+		}                                                              \
+                                                                               \
+		for (pass = 0; pass < PASSES; pass++) {                        \
+			/* All keys share this digit, skip the pass. */       \
+			digit = src[0] >> (pass * 8) & 0xff;                   \
+			if (count[pass][digit] == n)                           \
+				continue;                                      \
+                                                                               \
+			for (sum = 0, digit = 0; digit < 256; digit++) {       \
+				c = count[pass][digit];                        \
+				count[pass][digit] = sum;                      \
+				sum += c;                                      \
+			}                                                      \
+                                                                               \
+			for (i = 0; i < n; i++) {                              \
+				digit = (src[i] >> (pass * 8)) & 0xff;         \
+				dst[count[pass][digit]++] = src[i];            \
+			}                                                      \
+                                                                               \
+			tmp = src;                                             \
+			src = dst;                                             \
+			dst = tmp;                                             \
+		}                                                              \
+                                                                               \
+		if (src != a)                                                  \
+			memcpy(a, src, n * sizeof(uint##BITS##_t));            \
+                                                                               \
+		decode_##BITS(a, n, kind);                                     \
+	}
+
+DEFINE_RADIX_SORT(8)
+DEFINE_RADIX_SORT(16)
+DEFINE_RADIX_SORT(32)
+DEFINE_RADIX_SORT(64)
+
+bool radix_sort_buf(const struct mcc_object_interface *T, void *base,
+		    void *buf, size_t n)
+{
+	enum radix_kind kind = radix_kind_of(T);
+
+	if (kind == RADIX_NONE || n < RADIX_SORT_THRESHOLD)
+		return false;
+
+	switch (T->size) {
+	case 1:
+		radix_sort_8(base, buf, n, kind);
+		break;
+	case 2:
+		radix_sort_16(base, buf, n, kind);
+		break;
+	case 4:
+		radix_sort_32(base, buf, n, kind);
+		break;
+	case 8:
+		radix_sort_64(base, buf, n, kind);
+		break;
+	}
+	return true;
+}
+
+bool radix_sort(const struct mcc_allocator *allocator,
+		const struct mcc_object_interface *T, void *base, size_t n)
+{
+	void *buf;
+	bool sorted;
+
+	if (radix_kind_of(T) == RADIX_NONE || n < RADIX_SORT_THRESHOLD)
+		return false;
+
+	buf = mem_alloc(allocator, n * T->size);
+	if (!buf)
+		return false;
+
+	sorted = radix_sort_buf(T, base, buf, n);
+	mem_free(allocator, buf);
+	return sorted;
+}
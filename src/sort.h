@@ -0,0 +1,58 @@
+#include "mcc_allocator.h"
+#include "mcc_object.h"
+
+/*
+ * A sequence of len elements stored in at most two contiguous blocks: the
+ * first split elements start at first, the others start at second. This
+ * describes the buffer of a vector as well as a wrapped ring buffer of a
+ * deque without moving any element.
+ */
+struct sort_seq {
+	uint8_t *first;
+	uint8_t *second;
+	size_t split;
+	size_t len;
+	size_t size;
+	mcc_compare_fn cmp;
+};
+
+void pdq_sort(const struct sort_seq *seq);
+
+/*
+ * Sorts n elements of a built-in integer or floating point interface in place
+ * with an LSD radix sort. Returns false without touching the elements if T is
+ * not such an interface, n is too small to benefit or no scratch buffer could
+ * be taken from allocator, in which case the caller should fall back to
+ * pdq_sort.
+ */
+bool radix_sort(const struct mcc_allocator *allocator,
+		const struct mcc_object_interface *T, void *base, size_t n);
+
+/* Same as radix_sort with a caller provided scratch buffer of n elements. */
+bool radix_sort_buf(const struct mcc_object_interface *T, void *base,
+		    void *buf, size_t n);
+
+/*
+ * Sorts seq with up to nthreads threads and a buffer of seq->len elements.
+ * All memory is taken from allocator on the calling thread, the workers never
+ * allocate. Returns false without touching the elements if the sequence is
+ * too short to be worth splitting or the buffer could not be allocated, in
+ * which case the caller should sort on the calling thread instead.
+ */
+bool par_sort(const struct mcc_allocator *allocator,
+	      const struct sort_seq *seq, const struct mcc_object_interface *T,
+	      size_t nthreads);
+
+/*
+ * Stable sort of len contiguous elements. Returns CANNOT_ALLOCATE_MEMORY
+ * without touching the elements if the merge buffer of len / 2 elements
+ * cannot be taken from allocator.
+ */
+int stable_sort(const struct mcc_allocator *allocator, void *base, size_t len,
+		size_t size, mcc_compare_fn cmp);
+
+/*
+ * Powersort merge priority of the boundary between the adjacent runs
+ * [s1, s1 + n1) and [s1 + n1, s1 + n1 + n2) of a sequence of n elements.
+ */
+int run_power(size_t s1, size_t n1, size_t n2, size_t n);
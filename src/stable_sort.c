@@ -0,0 +1,506 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "mcc_err.h"
+#include "memswap.h"
+#include "sort.h"
+
+/*
+ * Stable, run-adaptive merge sort in the spirit of TimSort with the powersort
+ * merge policy (as used by CPython since 3.11). Natural runs, ascending or
+ * strictly descending, are detected and short ones are extended with binary
+ * insertion sort. Runs are merged with a buffer of at most half the elements,
+ * switching to galloping (exponential search) whenever one side keeps
+ * winning, so that nearly sorted input costs close to n comparisons.
+ */
+
+enum {
+	MIN_GALLOP = 7,
+	MAX_PENDING_RUNS = 85,
+};
+
+struct run {
+	size_t base;
+	size_t len;
+	int power;
+};
+
+struct stable_sort_state {
+	uint8_t *base;
+	size_t size;
+	mcc_compare_fn cmp;
+	uint8_t *tmp;
+	size_t min_gallop;
+	struct run runs[MAX_PENDING_RUNS];
+	size_t n;
+};
+
+static inline uint8_t *elem(const struct stable_sort_state *s, uint8_t *p,
+			    size_t i)
+{
+	return p + i * s->size;
+}
+
+static inline bool lt(const struct stable_sort_state *s, const void *a,
+		      const void *b)
+{
+	return s->cmp(a, b) < 0;
+}
+
+static inline void copy(const struct stable_sort_state *s, void *dst,
+			const void *src)
+{
+	memcpy(dst, src, s->size);
+}
+
+static void reverse(const struct stable_sort_state *s, uint8_t *lo,
+		    uint8_t *hi)
+{
+	for (hi -= s->size; lo < hi; lo += s->size, hi -= s->size)
+		memswap(lo, hi, s->size);
+}
+
+/*
+ * Length of the run starting at lo, at most n elements long. A strictly
+ * descending run is reversed in place, which keeps the sort stable.
+ */
+static size_t count_run(struct stable_sort_state *s, uint8_t *lo, size_t n)
+{
+	size_t k = 1;
+
+	if (n == 1)
+		return 1;
+
+	if (lt(s, elem(s, lo, 1), lo)) {
+		for (k = 2; k < n; k++) {
+			if (!lt(s, elem(s, lo, k), elem(s, lo, k - 1)))
+				break;
+		}
+		reverse(s, lo, elem(s, lo, k));
+	} else {
+		for (k = 2; k < n; k++) {
+			if (lt(s, elem(s, lo, k), elem(s, lo, k - 1)))
+				break;
+		}
+	}
+	return k;
+}
+
+/* Sorts lo[0..n) given that lo[0..sorted) already is. */
+static void binary_insertion_sort(struct stable_sort_state *s, uint8_t *lo,
+				  size_t n, size_t sorted)
+{
+	uint8_t *pivot = s->tmp;
+	size_t i, l, r, m;
+
+	for (i = sorted; i < n; i++) {
+		copy(s, pivot, elem(s, lo, i));
+		l = 0;
+		r = i;
+		while (l < r) {
+			m = l + (r - l) / 2;
+			if (lt(s, pivot, elem(s, lo, m)))
+				r = m;
+			else
+				l = m + 1;
+		}
+		memmove(elem(s, lo, l + 1), elem(s, lo, l), (i - l) * s->size);
+		copy(s, elem(s, lo, l), pivot);
+	}
+}
+
+/*
+ * Returns k such that a[k - 1] < key <= a[k], searching outwards from hint
+ * in steps of 1, 3, 7, 15... before finishing with a binary search.
+ */
+static size_t gallop_left(struct stable_sort_state *s, const void *key,
+			  uint8_t *a, size_t n, size_t hint)
+{
+	size_t ofs = 1, last = 0, max, k, m;
+
+	if (lt(s, elem(s, a, hint), key)) {
+		/* a[hint + last] < key <= a[hint + ofs] */
+		max = n - hint;
+		while (ofs < max && lt(s, elem(s, a, hint + ofs), key)) {
+			last = ofs;
+			ofs = (ofs << 1) + 1;
+		}
+		if (ofs > max)
+			ofs = max;
+		last += hint + 1;
+		ofs += hint;
+	} else {
+		/* a[hint - ofs] < key <= a[hint - last] */
+		max = hint + 1;
+		while (ofs < max && !lt(s, elem(s, a, hint - ofs), key)) {
+			last = ofs;
+			ofs = (ofs << 1) + 1;
+		}
+		if (ofs > max)
+			ofs = max;
+		k = last;
+		last = hint + 1 - ofs;
+		ofs = hint - k;
+	}
+
+	while (last < ofs) {
+		m = last + (ofs - last) / 2;
+		if (lt(s, elem(s, a, m), key))
+			last = m + 1;
+		else
+			ofs = m;
+	}
+	return ofs;
+}
+
+/* Like gallop_left, but returns k such that a[k - 1] <= key < a[k]. */
+static size_t gallop_right(struct stable_sort_state *s, const void *key,
+			   uint8_t *a, size_t n, size_t hint)
+{
+	size_t ofs = 1, last = 0, max, k, m;
+
+	if (lt(s, key, elem(s, a, hint))) {
+		/* a[hint - ofs] <= key < a[hint - last] */
+		max = hint + 1;
+		while (ofs < max && lt(s, key, elem(s, a, hint - ofs))) {
+			last = ofs;
+			ofs = (ofs << 1) + 1;
+		}
+		if (ofs > max)
+			ofs = max;
+		k = last;
+		last = hint + 1 - ofs;
+		ofs = hint - k;
+	} else {
+		/* a[hint + last] <= key < a[hint + ofs] */
+		max = n - hint;
+		while (ofs < max && !lt(s, key, elem(s, a, hint + ofs))) {
+			last = ofs;
+			ofs = (ofs << 1) + 1;
+		}
+		if (ofs > max)
+			ofs = max;
+		last += hint + 1;
+		ofs += hint;
+	}
+
+	while (last < ofs) {
+		m = last + (ofs - last) / 2;
+		if (lt(s, key, elem(s, a, m)))
+			ofs = m;
+		else
+			last = m + 1;
+	}
+	return ofs;
+}
+
+/*
+ * Merges the adjacent runs a[0..na) and b[0..nb) with na <= nb, copying a
+ * into the buffer and filling from the left. The caller guarantees that
+ * b[0] < a[0] and that a[na - 1] is greater than every element of b.
+ */
+static void merge_lo(struct stable_sort_state *s, uint8_t *a, size_t na,
+		     uint8_t *b, size_t nb)
+{
+	size_t size = s->size, min_gallop = s->min_gallop, acount, bcount, k;
+	uint8_t *dst = a, *pa = s->tmp;
+
+	memcpy(pa, a, na * size);
+	copy(s, dst, b);
+	dst += size;
+	b += size;
+	if (--nb == 0)
+		goto done;
+	if (na == 1)
+		goto copy_b;
+
+	for (;;) {
+		acount = bcount = 0;
+
+		/* One element at a time until one run wins consistently. */
+		do {
+			if (lt(s, b, pa)) {
+				copy(s, dst, b);
+				dst += size;
+				b += size;
+				bcount++;
+				acount = 0;
+				if (--nb == 0)
+					goto done;
+			} else {
+				copy(s, dst, pa);
+				dst += size;
+				pa += size;
+				acount++;
+				bcount = 0;
+				if (--na == 1)
+					goto copy_b;
+			}
+		} while ((acount | bcount) < min_gallop);
+
+		/* Gallop until neither run wins by MIN_GALLOP or more. */
+		min_gallop++;
+		do {
+			min_gallop -= min_gallop > 1;
+
+			k = gallop_right(s, b, pa, na, 0);
+			acount = k;
+			if (k) {
+				memcpy(dst, pa, k * size);
+				dst += k * size;
+				pa += k * size;
+				na -= k;
+				if (na == 1)
+					goto copy_b;
+				/* Only possible with an inconsistent cmp. */
+				if (na == 0)
+					goto done;
+			}
+			copy(s, dst, b);
+			dst += size;
+			b += size;
+			if (--nb == 0)
+				goto done;
+
+			k = gallop_left(s, pa, b, nb, 0);
+			bcount = k;
+			if (k) {
+				memmove(dst, b, k * size);
+				dst += k * size;
+				b += k * size;
+				nb -= k;
+				if (nb == 0)
+					goto done;
+			}
+			copy(s, dst, pa);
+			dst += size;
+			pa += size;
+			if (--na == 1)
+				goto copy_b;
+		} while (acount >= MIN_GALLOP || bcount >= MIN_GALLOP);
+		min_gallop++;
+	}
+
+copy_b:
+	/* The last element of a goes after the rest of b. */
+	memmove(dst, b, nb * size);
+	copy(s, dst + nb * size, pa);
+	goto out;
+done:
+	memcpy(dst, pa, na * size);
+out:
+	s->min_gallop = min_gallop ? min_gallop : 1;
+}
+
+/*
+ * Mirror image of merge_lo for nb <= na: b is copied into the buffer and the
+ * merge fills from the right.
+ */
+static void merge_hi(struct stable_sort_state *s, uint8_t *a, size_t na,
+		     uint8_t *b, size_t nb)
+{
+	size_t size = s->size, min_gallop = s->min_gallop, acount, bcount, k;
+	uint8_t *dst, *pa, *pb;
+
+	memcpy(s->tmp, b, nb * size);
+	dst = elem(s, b, nb - 1);
+	pa = elem(s, a, na - 1);
+	pb = elem(s, s->tmp, nb - 1);
+
+	copy(s, dst, pa);
+	dst -= size;
+	pa -= size;
+	if (--na == 0)
+		goto done;
+	if (nb == 1)
+		goto copy_a;
+
+	for (;;) {
+		acount = bcount = 0;
+
+		do {
+			if (lt(s, pb, pa)) {
+				copy(s, dst, pa);
+				dst -= size;
+				pa -= size;
+				acount++;
+				bcount = 0;
+				if (--na == 0)
+					goto done;
+			} else {
+				copy(s, dst, pb);
+				dst -= size;
+				pb -= size;
+				bcount++;
+				acount = 0;
+				if (--nb == 1)
+					goto copy_a;
+			}
+		} while ((acount | bcount) < min_gallop);
+
+		min_gallop++;
+		do {
+			min_gallop -= min_gallop > 1;
+
+			k = na - gallop_right(s, pb, a, na, na - 1);
+			acount = k;
+			if (k) {
+				dst -= k * size;
+				pa -= k * size;
+				memmove(dst + size, pa + size, k * size);
+				na -= k;
+				if (na == 0)
+					goto done;
+			}
+			copy(s, dst, pb);
+			dst -= size;
+			pb -= size;
+			if (--nb == 1)
+				goto copy_a;
+
+			k = nb - gallop_left(s, pa, s->tmp, nb, nb - 1);
+			bcount = k;
+			if (k) {
+				dst -= k * size;
+				pb -= k * size;
+				memcpy(dst + size, pb + size, k * size);
+				nb -= k;
+				if (nb == 1)
+					goto copy_a;
+				/* Only possible with an inconsistent cmp. */
+				if (nb == 0)
+					goto done;
+			}
+			copy(s, dst, pa);
+			dst -= size;
+			pa -= size;
+			if (--na == 0)
+				goto done;
+		} while (acount >= MIN_GALLOP || bcount >= MIN_GALLOP);
+		min_gallop++;
+	}
+
+copy_a:
+	/* The first element of b goes before the rest of a. */
+	dst -= na * size;
+	pa -= na * size;
+	memmove(dst + size, pa + size, na * size);
+	copy(s, dst, pb);
+	goto out;
+done:
+	memcpy(dst - (nb - 1) * size, s->tmp, nb * size);
+out:
+	s->min_gallop = min_gallop ? min_gallop : 1;
+}
+
+/* Merges the pending runs i and i + 1. */
+static void merge_at(struct stable_sort_state *s, size_t i)
+{
+	uint8_t *a = elem(s, s->base, s->runs[i].base);
+	uint8_t *b = elem(s, s->base, s->runs[i + 1].base);
+	size_t na = s->runs[i].len, nb = s->runs[i + 1].len, k;
+
+	s->runs[i].len = na + nb;
+	if (i + 3 == s->n)
+		s->runs[i + 1] = s->runs[i + 2];
+	s->n--;
+
+	/* Elements of a that are <= b[0] are already in place. */
+	k = gallop_right(s, b, a, na, 0);
+	a += k * s->size;
+	na -= k;
+	if (!na)
+		return;
+
+	/* So are the elements of b that are >= the last one of a. */
+	nb = gallop_left(s, elem(s, a, na - 1), b, nb, nb - 1);
+	if (!nb)
+		return;
+
+	if (na <= nb)
+		merge_lo(s, a, na, b, nb);
+	else
+		merge_hi(s, a, na, b, nb);
+}
+
+int run_power(size_t s1, size_t n1, size_t n2, size_t n)
+{
+	/* 2a and 2b for the run midpoints a and b, scaled by n. */
+	size_t a = 2 * s1 + n1, b = a + n1 + n2;
+	int power = 0;
+
+	for (;;) {
+		power++;
+		if (a >= n) {
+			a -= n;
+			b -= n;
+		} else if (b >= n) {
+			break;
+		}
+		a <<= 1;
+		b <<= 1;
+	}
+	return power;
+}
+
+static size_t min_run_length(size_t n)
+{
+	size_t r = 0;
+
+	while (n >= 64) {
+		r |= n & 1;
+		n >>= 1;
+	}
+	return n + r;
+}
+
+int stable_sort(const struct mcc_allocator *allocator, void *base, size_t len,
+		size_t size, mcc_compare_fn cmp)
+{
+	struct stable_sort_state s = {
+		.base = base,
+		.size = size,
+		.cmp = cmp,
+		.min_gallop = MIN_GALLOP,
+	};
+	size_t lo = 0, min_run, n, force;
+	int power;
+
+	if (len <= 1)
+		return OK;
+
+	/* A merge never needs more than half the elements of scratch. */
+	s.tmp = mem_alloc(allocator, (len / 2 > 1 ? len / 2 : 1) * size);
+	if (!s.tmp)
+		return CANNOT_ALLOCATE_MEMORY;
+
+	min_run = min_run_length(len);
+	while (lo < len) {
+		n = count_run(&s, elem(&s, s.base, lo), len - lo);
+		if (n < min_run) {
+			force = len - lo < min_run ? len - lo : min_run;
+			binary_insertion_sort(&s, elem(&s, s.base, lo), force,
+					      n);
+			n = force;
+		}
+
+		if (s.n) {
+			power = run_power(s.runs[s.n - 1].base,
+					  s.runs[s.n - 1].len, n, len);
+			while (s.n > 1 && s.runs[s.n - 2].power > power)
+				merge_at(&s, s.n - 2);
+			s.runs[s.n - 1].power = power;
+		}
+		s.runs[s.n].base = lo;
+		s.runs[s.n].len = n;
+		s.n++;
+		lo += n;
+	}
+
+	while (s.n > 1)
+		merge_at(&s, s.n - 2);
+
+	mem_free(allocator, s.tmp);
+	return OK;
+}
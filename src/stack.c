@@ -9,6 +9,19 @@ struct mcc_stack *mcc_stack_new(const struct mcc_object_interface *T)
 	return STACK(mcc_vector_new(T));
 }
 
+struct mcc_stack *mcc_stack_new_in(struct mcc_arena *arena,
+				   const struct mcc_object_interface *T)
+{
+	return STACK(mcc_vector_new_in(arena, T));
+}
+
+struct mcc_stack *
+mcc_stack_new_with_allocator(const struct mcc_allocator *allocator,
+			     const struct mcc_object_interface *T)
+{
+	return STACK(mcc_vector_new_with_allocator(allocator, T));
+}
+
 void mcc_stack_drop(struct mcc_stack *self)
 {
 	mcc_vector_drop(VECTOR(self));
@@ -1,18 +1,14 @@
+#include "alloc.h"
+#include "heap.h"
 #include "mcc_err.h"
 #include "mcc_vector.h"
 #include "memswap.h"
-#include "sift_down.h"
+#include "sort.h"
 #include <stdlib.h>
 
-struct mcc_vector_iter {
-	struct mcc_vector_iter *next;
-	struct mcc_vector *vector;
-	size_t curr;
-	bool in_use;
-};
-
 struct mcc_vector {
 	const struct mcc_object_interface *T;
+	struct mcc_allocator allocator;
 	struct mcc_vector_iter *iters;
 	uint8_t *ptr;
 	size_t len;
@@ -36,14 +32,16 @@ static int reallocate_buffer(struct mcc_vector *self, size_t capacity)
 
 	if (!capacity) {
 		if (self->capacity) {
-			free(self->ptr);
+			mem_free(&self->allocator, self->ptr);
 			self->ptr = NULL;
 			self->capacity = 0;
 		}
 		return OK;
 	}
 
-	new_ptr = realloc(self->ptr, capacity * self->T->size);
+	new_ptr = mem_realloc(&self->allocator, self->ptr,
+			      self->capacity * self->T->size,
+			      capacity * self->T->size);
 
 	if (new_ptr) {
 		self->ptr = new_ptr;
@@ -56,16 +54,31 @@ static int reallocate_buffer(struct mcc_vector *self, size_t capacity)
 
 struct mcc_vector *mcc_vector_new(const struct mcc_object_interface *T)
 {
+	return mcc_vector_new_with_allocator(NULL, T);
+}
+
+struct mcc_vector *mcc_vector_new_in(struct mcc_arena *arena,
+				     const struct mcc_object_interface *T)
+{
+	return mcc_vector_new_with_allocator(mcc_arena_allocator(arena), T);
+}
+
+struct mcc_vector *
+mcc_vector_new_with_allocator(const struct mcc_allocator *allocator,
+			   const struct mcc_object_interface *T)
+{
+	struct mcc_allocator a;
 	struct mcc_vector *self;
 
-	if (!T)
+	if (!T || !allocator_init(&a, allocator))
 		return NULL;
 
-	self = calloc(1, sizeof(struct mcc_vector));
+	self = mem_calloc(&a, sizeof(struct mcc_vector));
 	if (!self)
 		return NULL;
 
 	self->T = T;
+	self->allocator = a;
 	return self;
 }
 
@@ -78,12 +91,12 @@ void mcc_vector_drop(struct mcc_vector *self)
 
 	while (self->iters) {
 		next = self->iters->next;
-		free(self->iters);
+		mem_free(&self->allocator, self->iters);
 		self->iters = next;
 	}
 	mcc_vector_clear(self);
-	free(self->ptr);
-	free(self);
+	mem_free(&self->allocator, self->ptr);
+	mem_free(&self->allocator, self);
 }
 
 int mcc_vector_reserve(struct mcc_vector *self, size_t additional)
@@ -161,6 +174,24 @@ void mcc_vector_pop(struct mcc_vector *self)
 	self->len--;
 }
 
+int mcc_vector_push_many(struct mcc_vector *self, const void *values, size_t n)
+{
+	if (!self || (!values && n))
+		return INVALID_ARGUMENTS;
+
+	if (!n)
+		return OK;
+
+	if (self->len + n > self->capacity) {
+		if (mcc_vector_reserve(self, n))
+			return CANNOT_ALLOCATE_MEMORY;
+	}
+
+	memcpy(get(self, self->len), values, n * self->T->size);
+	self->len += n;
+	return OK;
+}
+
 int mcc_vector_insert(struct mcc_vector *self, size_t index, const void *value)
 {
 	if (!self || !value)
@@ -300,11 +331,47 @@ int mcc_vector_sort(struct mcc_vector *self)
 	if (self->len <= 1)
 		return OK;
 
-	/* Use the sorting function of the standard library. */
-	qsort(self->ptr, self->len, self->T->size, self->T->cmp);
+	if (radix_sort(&self->allocator, self->T, self->ptr, self->len))
+		return OK;
+
+	pdq_sort(&(struct sort_seq){
+		.first = self->ptr,
+		.split = self->len,
+		.len = self->len,
+		.size = self->T->size,
+		.cmp = self->T->cmp,
+	});
 	return OK;
 }
 
+int mcc_vector_stable_sort(struct mcc_vector *self)
+{
+	if (!self)
+		return INVALID_ARGUMENTS;
+
+	return stable_sort(&self->allocator, self->ptr, self->len,
+			   self->T->size, self->T->cmp);
+}
+
+int mcc_vector_par_sort(struct mcc_vector *self, size_t nthreads)
+{
+	if (!self || !nthreads)
+		return INVALID_ARGUMENTS;
+
+	if (par_sort(&self->allocator,
+		     &(struct sort_seq){
+			     .first = self->ptr,
+			     .split = self->len,
+			     .len = self->len,
+			     .size = self->T->size,
+			     .cmp = self->T->cmp,
+		     },
+		     self->T, nthreads))
+		return OK;
+
+	return mcc_vector_sort(self);
+}
+
 void *mcc_vector_binary_search(struct mcc_vector *self, const void *key)
 {
 	if (!self || !key || !self->len)
@@ -314,6 +381,40 @@ void *mcc_vector_binary_search(struct mcc_vector *self, const void *key)
 	return bsearch(key, self->ptr, self->len, self->T->size, self->T->cmp);
 }
 
+int mcc_vector_for_each(struct mcc_vector *self, mcc_visit_fn fn, void *ctx)
+{
+	size_t i, size;
+	uint8_t *ptr;
+	int ret;
+
+	if (!self || !fn)
+		return INVALID_ARGUMENTS;
+
+	size = self->T->size;
+	for (i = 0, ptr = self->ptr; i < self->len; i++, ptr += size) {
+		ret = fn(ptr, ctx);
+		if (ret)
+			return ret;
+	}
+	return OK;
+}
+
+size_t mcc_vector_fold(struct mcc_vector *self, mcc_fold_fn fn, void *acc)
+{
+	size_t i, size;
+	uint8_t *ptr;
+
+	if (!self || !fn)
+		return 0;
+
+	size = self->T->size;
+	for (i = 0, ptr = self->ptr; i < self->len; i++, ptr += size) {
+		if (!fn(ptr, acc))
+			break;
+	}
+	return i;
+}
+
 struct mcc_vector_iter *mcc_vector_iter_new(struct mcc_vector *vector)
 {
 	struct mcc_vector_iter *self;
@@ -328,7 +429,7 @@ struct mcc_vector_iter *mcc_vector_iter_new(struct mcc_vector *vector)
 		self = self->next;
 	}
 
-	self = calloc(1, sizeof(struct mcc_vector_iter));
+	self = mem_calloc(&vector->allocator, sizeof(struct mcc_vector_iter));
 	if (!self)
 		return NULL;
 
@@ -341,6 +442,19 @@ reset_iterator:
 	return self;
 }
 
+int mcc_vector_iter_init(struct mcc_vector_iter *self,
+			 struct mcc_vector *vector)
+{
+	if (!self || !vector)
+		return INVALID_ARGUMENTS;
+
+	self->next = NULL;
+	self->vector = vector;
+	self->curr = 0;
+	self->in_use = false;
+	return OK;
+}
+
 void mcc_vector_iter_drop(struct mcc_vector_iter *self)
 {
 	if (self)
@@ -356,6 +470,29 @@ bool mcc_vector_iter_next(struct mcc_vector_iter *self, void **ref)
 	return true;
 }
 
+size_t mcc_vector_iter_next_n(struct mcc_vector_iter *self, void **refs,
+			      size_t n)
+{
+	struct mcc_vector *vector;
+	uint8_t *ptr;
+	size_t i, size;
+
+	if (!self || !refs || self->curr >= self->vector->len)
+		return 0;
+
+	vector = self->vector;
+	if (n > vector->len - self->curr)
+		n = vector->len - self->curr;
+
+	size = vector->T->size;
+	ptr = get(vector, self->curr);
+	for (i = 0; i < n; i++, ptr += size)
+		refs[i] = ptr;
+
+	self->curr += n;
+	return n;
+}
+
 static inline int do_compare(struct mcc_vector *self, size_t a, size_t b)
 {
 	return self->T->cmp(get(self, a), get(self, b));
@@ -379,10 +516,33 @@ void sift_down(struct mcc_vector *self, size_t i)
 		}
 
 		if (large != i) {
-			mcc_vector_swap(self, large, i);
+			memswap(get(self, large), get(self, i), self->T->size);
 			i = large;
 		} else {
 			break;
 		}
 	}
 }
+
+void sift_up(struct mcc_vector *self, size_t i)
+{
+	size_t parent;
+
+	while (i > 0) {
+		parent = (i - 1) >> 1;
+		if (do_compare(self, i, parent) <= 0)
+			break;
+
+		memswap(get(self, parent), get(self, i), self->T->size);
+		i = parent;
+	}
+}
+
+void heapify(struct mcc_vector *self)
+{
+	size_t i = self->len >> 1;
+
+	/* Floyd's method: sift down every internal node, bottom up. */
+	while (i-- > 0)
+		sift_down(self, i);
+}
@@ -0,0 +1,91 @@
+#include "mcc_arena.h"
+#include <assert.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static void test_alloc()
+{
+	struct mcc_arena *arena = mcc_arena_new(256);
+	uint8_t *p[64];
+	size_t i;
+
+	assert(arena != NULL);
+	for (i = 0; i < 64; i++) {
+		p[i] = mcc_arena_alloc(arena, i + 1);
+		assert(p[i] != NULL);
+		assert((uintptr_t)p[i] % alignof(max_align_t) == 0);
+		memset(p[i], (int)i, i + 1);
+	}
+	for (i = 0; i < 64; i++)
+		assert(p[i][i] == (uint8_t)i);
+
+	/* Larger than a block. */
+	p[0] = mcc_arena_alloc(arena, 1000);
+	assert(p[0] != NULL);
+	memset(p[0], 0, 1000);
+	mcc_arena_drop(arena);
+}
+
+static void test_realloc()
+{
+	struct mcc_arena *arena = mcc_arena_new(1024);
+	uint8_t *p, *q;
+
+	assert(arena != NULL);
+	p = mcc_arena_realloc(arena, NULL, 0, 16);
+	assert(p != NULL);
+	memset(p, 7, 16);
+
+	/* The last allocation grows in place. */
+	q = mcc_arena_realloc(arena, p, 16, 512);
+	assert(q == p && q[15] == 7);
+
+	/* Any other one is copied. */
+	assert(mcc_arena_alloc(arena, 16) != NULL);
+	q = mcc_arena_realloc(arena, p, 512, 2048);
+	assert(q != NULL && q != p && q[0] == 7 && q[15] == 7);
+	mcc_arena_drop(arena);
+}
+
+static void test_mark_and_release()
+{
+	struct mcc_arena *arena = mcc_arena_new(128);
+	size_t mark;
+	void *p, *q;
+	int i;
+
+	assert(arena != NULL);
+	assert(mcc_arena_mark(arena) == 0);
+	p = mcc_arena_alloc(arena, 32);
+	mark = mcc_arena_mark(arena);
+	q = mcc_arena_alloc(arena, 32);
+	assert(p != NULL && q != NULL);
+	mcc_arena_release(arena, mark);
+	assert(mcc_arena_mark(arena) == mark);
+	assert(mcc_arena_alloc(arena, 32) == q);
+
+	/* Releasing across blocks. */
+	mcc_arena_release(arena, mark);
+	for (i = 0; i < 100; i++)
+		assert(mcc_arena_alloc(arena, 64) != NULL);
+	assert(mcc_arena_mark(arena) > mark);
+	mcc_arena_release(arena, mark);
+	assert(mcc_arena_mark(arena) == mark);
+	assert(mcc_arena_alloc(arena, 32) == q);
+
+	mcc_arena_release(arena, 0);
+	assert(mcc_arena_mark(arena) == 0);
+	assert(mcc_arena_alloc(arena, 32) == p);
+	mcc_arena_drop(arena);
+}
+
+int main(void)
+{
+	test_alloc();
+	test_realloc();
+	test_mark_and_release();
+	puts("testing done");
+	return 0;
+}
@@ -0,0 +1,152 @@
+#include "mcc_btree_map.h"
+#include "mcc_err.h"
+#include <assert.h>
+#include <stdio.h>
+
+#define map_insert mcc_btree_map_insert
+#define map_remove mcc_btree_map_remove
+#define map_get mcc_btree_map_get
+
+static void print(struct mcc_btree_map *map)
+{
+	struct mcc_btree_map_iter *iter;
+	struct mcc_pair *pair;
+	const mcc_str_t *k;
+	int *v;
+
+	iter = mcc_btree_map_iter_new(map);
+	assert(iter != NULL);
+	while (mcc_btree_map_iter_next(iter, &pair)) {
+		k = pair->key;
+		v = pair->value;
+		printf("(%s, %d)\n", *k, *v);
+	}
+
+	mcc_btree_map_iter_drop(iter);
+}
+
+static void test_str_keys()
+{
+	struct mcc_btree_map *map = mcc_btree_map_new(mcc_str(), mcc_int());
+	assert(map != NULL);
+	assert(!map_insert(map, &(mcc_str_t){"Apple"}, &(int){0}));
+	assert(!map_insert(map, &(mcc_str_t){"Banana"}, &(int){1}));
+	assert(!map_insert(map, &(mcc_str_t){"Orange"}, &(int){2}));
+	assert(!map_insert(map, &(mcc_str_t){"Raspberry"}, &(int){3}));
+	assert(!map_insert(map, &(mcc_str_t){"Pear"}, &(int){4}));
+	assert(!map_insert(map, &(mcc_str_t){"Watermelon"}, &(int){5}));
+	assert(!map_insert(map, &(mcc_str_t){"Coconut"}, &(int){6}));
+	assert(!map_insert(map, &(mcc_str_t){"Pineapple"}, &(int){7}));
+	assert(!map_insert(map, &(mcc_str_t){"Strawberry"}, &(int){8}));
+	assert(!map_insert(map, &(mcc_str_t){"Grape"}, &(int){9}));
+	print(map);
+	map_remove(map, &(mcc_str_t){"Orange"});
+	map_remove(map, &(mcc_str_t){"Grape"});
+	map_remove(map, &(mcc_str_t){"Watermelon"});
+	puts("---------------------------");
+	print(map);
+	mcc_btree_map_drop(map);
+}
+
+static void test_small_order()
+{
+	struct mcc_btree_map_iter *iter;
+	struct mcc_pair *pair;
+	int i, n = 10000, *v, prev = -1;
+	struct mcc_btree_map *map;
+
+	map = mcc_btree_map_new_with_order(mcc_int(), mcc_int(), 4);
+	assert(map != NULL);
+	for (i = 0; i < n; i++)
+		assert(!map_insert(map, &(int){i * 7 % n}, &(int){i}));
+	for (i = 0; i < n; i += 2)
+		map_remove(map, &i);
+	assert(mcc_btree_map_len(map) == (size_t)n / 2);
+	for (i = 0; i < n; i++) {
+		if (i % 2) {
+			assert(!map_get(map, &i, (void **)&v));
+			assert(*v * 7 % n == i);
+		} else {
+			assert(map_get(map, &i, (void **)&v) == NONE);
+		}
+	}
+
+	iter = mcc_btree_map_iter_new(map);
+	assert(iter != NULL);
+	for (i = 0; mcc_btree_map_iter_next(iter, &pair); i++) {
+		assert(*(const int *)pair->key > prev);
+		prev = *(const int *)pair->key;
+	}
+	assert(i == n / 2);
+	mcc_btree_map_drop(map);
+}
+
+static void test_iter_init()
+{
+	struct mcc_btree_map_iter iter;
+	struct mcc_pair pairs[3];
+	size_t n;
+	int i, expected = 0;
+	struct mcc_btree_map *map;
+
+	map = mcc_btree_map_new_with_order(mcc_int(), mcc_int(), 4);
+	assert(map != NULL);
+	for (i = 0; i < 1000; i++)
+		assert(!map_insert(map, &(int){i * 7 % 1000}, &(int){i}));
+
+	assert(!mcc_btree_map_iter_init(&iter, map));
+	while ((n = mcc_btree_map_iter_next_n(&iter, pairs, 3))) {
+		for (i = 0; i < (int)n; i++, expected++)
+			assert(*(const int *)pairs[i].key == expected);
+	}
+	assert(expected == 1000);
+	assert(!mcc_btree_map_iter_next_n(&iter, pairs, 3));
+	mcc_btree_map_drop(map);
+}
+
+static int negate_value(struct mcc_pair *pair, void *ctx)
+{
+	if (*(const int *)pair->key == *(int *)ctx)
+		return NONE;
+	*(int *)pair->value = -*(int *)pair->value;
+	return OK;
+}
+
+static bool count_below(const struct mcc_pair *pair, void *acc)
+{
+	if (*(const int *)pair->key >= 500)
+		return false;
+	++*(int *)acc;
+	return true;
+}
+
+static void test_for_each()
+{
+	int i, count = 0, *v;
+	struct mcc_btree_map *map;
+
+	map = mcc_btree_map_new_with_order(mcc_int(), mcc_int(), 4);
+	assert(map != NULL);
+	for (i = 999; i >= 0; i--)
+		assert(!map_insert(map, &i, &i));
+
+	/* Stops at the first key >= 500, which comes after all smaller ones. */
+	assert(mcc_btree_map_fold(map, count_below, &count) == 500);
+	assert(count == 500);
+	assert(mcc_btree_map_for_each(map, negate_value, &(int){250}) == NONE);
+	for (i = 0; i < 1000; i++) {
+		assert(!map_get(map, &i, (void **)&v));
+		assert(*v == (i < 250 ? -i : i));
+	}
+	mcc_btree_map_drop(map);
+}
+
+int main(void)
+{
+	test_str_keys();
+	test_small_order();
+	test_iter_init();
+	test_for_each();
+	puts("testing done");
+	return 0;
+}
@@ -0,0 +1,33 @@
+#include "fruit.h"
+#include "mcc_btree_set.h"
+#include <assert.h>
+
+#define set_insert mcc_btree_set_insert
+#define set_remove mcc_btree_set_remove
+#define set_get mcc_btree_set_get
+#define set_clear mcc_btree_set_clear
+
+int main(void)
+{
+	struct fruit tmp;
+	const struct fruit *ref;
+	struct mcc_btree_set *set = mcc_btree_set_new_with_order(&fruit_, 4);
+	assert(set != NULL);
+	assert(!set_insert(set, fruit_new(&tmp, "Orange")));
+	assert(!set_insert(set, fruit_new(&tmp, "Watermelon")));
+	assert(!set_insert(set, fruit_new(&tmp, "Apple")));
+	assert(!set_insert(set, fruit_new(&tmp, "Pear")));
+	assert(!set_insert(set, fruit_new(&tmp, "Pineapple")));
+	assert(!set_insert(set, fruit_new(&tmp, "Banana")));
+	assert(!set_insert(set, fruit_new(&tmp, "Grape")));
+	assert(!set_insert(set, fruit_new(&tmp, "Strawberry")));
+	assert(!set_get(set, &(struct fruit){"Apple"}, (const void **)&ref));
+	assert(!fruit_cmp(ref, &(struct fruit){"Apple", 1, 0.5}));
+	assert(!set_get(set, &(struct fruit){"Grape"}, (const void **)&ref));
+	assert(!fruit_cmp(ref, &(struct fruit){"Grape", 1, 0.5}));
+	set_remove(set, &(struct fruit){"Pineapple"});
+	assert(set_get(set, &(struct fruit){"Pineapple"}, (const void **)&ref));
+	mcc_btree_set_drop(set);
+	puts("testing done");
+	return 0;
+}
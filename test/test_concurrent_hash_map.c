@@ -0,0 +1,92 @@
+#include "mcc_concurrent_hash_map.h"
+#include "mcc_err.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+
+#define map_insert mcc_concurrent_hash_map_insert
+#define map_remove mcc_concurrent_hash_map_remove
+#define map_get mcc_concurrent_hash_map_get
+
+#define NTHREADS 4
+#define KEYS_PER_THREAD 20000
+
+static void test_basic()
+{
+	struct mcc_concurrent_hash_map_iter *iter;
+	struct mcc_pair *pair;
+	int i, value, sum = 0;
+	struct mcc_concurrent_hash_map *map =
+		mcc_concurrent_hash_map_new(mcc_int(), mcc_int());
+	assert(map != NULL);
+	for (i = 0; i < 1000; i++)
+		assert(!map_insert(map, &i, &(int){i * 10}));
+	assert(mcc_concurrent_hash_map_len(map) == 1000);
+	assert(!map_insert(map, &(int){5}, &(int){-5}));
+	assert(!map_get(map, &(int){5}, &value) && value == -5);
+	assert(map_get(map, &(int){1000}, &value) == NONE);
+
+	for (i = 0; i < 1000; i += 2)
+		assert(!map_remove(map, &i));
+	assert(map_remove(map, &(int){0}) == NONE);
+	assert(mcc_concurrent_hash_map_len(map) == 500);
+
+	iter = mcc_concurrent_hash_map_iter_new(map);
+	assert(iter != NULL);
+	assert(!map_insert(map, &(int){2000}, &(int){0}));
+	while (mcc_concurrent_hash_map_iter_next(iter, &pair)) {
+		assert(*(const int *)pair->key % 2 == 1);
+		sum++;
+	}
+	assert(sum == 500);
+	mcc_concurrent_hash_map_iter_drop(iter);
+	mcc_concurrent_hash_map_drop(map);
+}
+
+static void *worker(void *arg)
+{
+	struct mcc_concurrent_hash_map *map = arg;
+	static int next_id;
+	int id = __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED);
+	int i, key, value;
+
+	for (i = 0; i < KEYS_PER_THREAD; i++) {
+		key = i * NTHREADS + id;
+		assert(!map_insert(map, &key, &key));
+		assert(!map_get(map, &key, &value) && value == key);
+		if (i % 2)
+			assert(!map_remove(map, &key));
+	}
+	return NULL;
+}
+
+static void test_threads()
+{
+	pthread_t threads[NTHREADS];
+	int i, key;
+	struct mcc_concurrent_hash_map *map =
+		mcc_concurrent_hash_map_new_with_shards(mcc_int(), mcc_int(), 6);
+	assert(map != NULL);
+	for (i = 0; i < NTHREADS; i++)
+		assert(!pthread_create(&threads[i], NULL, worker, map));
+	for (i = 0; i < NTHREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	assert(mcc_concurrent_hash_map_len(map) ==
+	       NTHREADS * KEYS_PER_THREAD / 2);
+	for (key = 0; key < NTHREADS * KEYS_PER_THREAD; key++) {
+		if (key / NTHREADS % 2)
+			assert(map_get(map, &key, NULL) == NONE);
+		else
+			assert(!map_get(map, &key, NULL));
+	}
+	mcc_concurrent_hash_map_drop(map);
+}
+
+int main(void)
+{
+	test_basic();
+	test_threads();
+	puts("testing done");
+	return 0;
+}
@@ -1,6 +1,9 @@
 #include "fruit.h"
+#include "mcc_err.h"
 #include "mcc_deque.h"
+#include "visit.h"
 #include <assert.h>
+#include <stdlib.h>
 
 static bool equals(struct mcc_deque *d, int *a)
 {
@@ -142,12 +145,115 @@ static void test_iterator()
 	mcc_deque_drop(d);
 }
 
+static void test_par_sort()
+{
+	int *prev, *cur;
+	size_t i, n = 100000;
+	struct mcc_deque *d = mcc_deque_new(mcc_int());
+	assert(d != NULL);
+	/* Wrap the ring buffer around before sorting it. */
+	for (i = 0; i < n; i++) {
+		if (i % 2)
+			assert(!mcc_deque_push_front(d, &(int){rand()}));
+		else
+			assert(!mcc_deque_push_back(d, &(int){rand()}));
+	}
+	assert(!mcc_deque_par_sort(d, 3));
+	assert(mcc_deque_len(d) == n);
+	for (i = 1; i < n; i++) {
+		assert(!mcc_deque_get(d, i - 1, (void **)&prev));
+		assert(!mcc_deque_get(d, i, (void **)&cur));
+		assert(*prev <= *cur);
+	}
+	mcc_deque_drop(d);
+}
+
+struct pair {
+	int key;
+	int seq;
+};
+
+static int pair_cmp(const struct pair *self, const struct pair *other)
+{
+	return self->key > other->key ? 1 : self->key == other->key ? 0 : -1;
+}
+
+static void test_stable_sort()
+{
+	struct mcc_object_interface pair_ = {
+		.size = sizeof(struct pair),
+		.cmp = (mcc_compare_fn)&pair_cmp,
+	};
+	struct pair *prev, *cur;
+	int i, n = 5000;
+	struct mcc_deque *d = mcc_deque_new(&pair_);
+	assert(d != NULL);
+	/* Wrap the ring buffer around before sorting it. */
+	for (i = n / 2 - 1; i >= 0; i--)
+		assert(!mcc_deque_push_front(d, &(struct pair){rand() % 9, i}));
+	for (i = n / 2; i < n; i++)
+		assert(!mcc_deque_push_back(d, &(struct pair){rand() % 9, i}));
+	assert(!mcc_deque_stable_sort(d));
+	for (i = 1; i < n; i++) {
+		assert(!mcc_deque_get(d, i - 1, (void **)&prev));
+		assert(!mcc_deque_get(d, i, (void **)&cur));
+		assert(prev->key < cur->key ||
+		       (prev->key == cur->key && prev->seq < cur->seq));
+	}
+	mcc_deque_drop(d);
+}
+
+static void test_iter_init()
+{
+	struct mcc_deque_iter iter;
+	int *refs[5];
+	size_t i, n, total = 0;
+	struct mcc_deque *d = mcc_deque_new(mcc_int());
+	assert(d != NULL);
+	/* Make the elements wrap around the end of the buffer. */
+	for (i = 8; i < 16; i++)
+		assert(!mcc_deque_push_back(d, &(int){i}));
+	for (i = 8; i > 0; i--)
+		assert(!mcc_deque_push_front(d, &(int){i - 1}));
+	assert(!mcc_deque_iter_init(&iter, d));
+	while ((n = mcc_deque_iter_next_n(&iter, (void **)refs, 5))) {
+		for (i = 0; i < n; i++)
+			assert(*refs[i] == total + i);
+		total += n;
+	}
+	assert(total == 16);
+	mcc_deque_drop(d);
+}
+
+/* Stopping early is covered by the vector test, this one wraps around. */
+static void test_for_each()
+{
+	int i, *ref;
+	long sum = 0;
+	struct mcc_deque *d = mcc_deque_new(mcc_int());
+	assert(d != NULL);
+	for (i = 8; i < 16; i++)
+		assert(!mcc_deque_push_back(d, &(int){i}));
+	for (i = 8; i > 0; i--)
+		assert(!mcc_deque_push_front(d, &(int){i - 1}));
+
+	assert(!mcc_deque_for_each(d, double_below, &(int){100}));
+	for (i = 0; i < 16; i++)
+		assert(!mcc_deque_get(d, i, (void **)&ref) && *ref == i * 2);
+	assert(mcc_deque_fold(d, sum_below_100, &sum) == 10 && sum == 90);
+	mcc_deque_drop(d);
+}
+
 int main(void)
 {
 	test_push_and_pop();
 	test_insert_and_remove();
 	test_drop_call();
 	test_iterator();
+	test_iter_init();
+	test_for_each();
+	test_par_sort();
+	test_stable_sort();
 	puts("testing done");
 	return 0;
 }
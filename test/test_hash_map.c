@@ -1,6 +1,8 @@
+#include "mcc_err.h"
 #include "mcc_hash_map.h"
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #define map_insert mcc_hash_map_insert
 #define map_get mcc_hash_map_get
@@ -24,6 +26,334 @@ static void print(struct mcc_hash_map *map)
 	mcc_hash_map_iter_drop(iter);
 }
 
+static void test_incremental_resize()
+{
+	struct mcc_hash_map *map = mcc_hash_map_new(mcc_int(), mcc_int());
+	int *v, *first, n;
+	size_t cap;
+
+	assert(map != NULL);
+	assert(!mcc_hash_map_incremental_resize(map, true));
+	for (int i = 0; i < 10000; i++)
+		assert(!map_insert(map, &i, &(int){i * 2}));
+	for (int i = 0; i < 10000; i += 2)
+		map_remove(map, &i);
+	assert(mcc_hash_map_len(map) == 5000);
+	for (int i = 0; i < 10000; i++) {
+		if (i % 2) {
+			assert(!map_get(map, &i, (void **)&v));
+			assert(*v == i * 2);
+		} else {
+			assert(map_get(map, &i, (void **)&v) == NONE);
+		}
+	}
+	mcc_hash_map_drop(map);
+
+	/* Gets during a resize leave the refs from earlier gets valid. */
+	map = mcc_hash_map_new(mcc_int(), mcc_int());
+	assert(map != NULL);
+	assert(!mcc_hash_map_incremental_resize(map, true));
+	n = 0;
+	do {
+		cap = mcc_hash_map_capacity(map);
+		assert(!map_insert(map, &n, &(int){n * 2}));
+		n++;
+	} while (n < 1000 || mcc_hash_map_capacity(map) == cap);
+	assert(!map_get(map, &(int){0}, (void **)&first));
+	for (int i = 0; i < 5000; i++)
+		map_get(map, &(int){i % n}, (void **)&v);
+	assert(*first == 0);
+	mcc_hash_map_drop(map);
+}
+
+static void test_get_many()
+{
+	struct mcc_hash_map *map = mcc_hash_map_new(mcc_int(), mcc_int());
+	int keys[1000], many[4096], n;
+	void *refs[1000], *many_refs[4096];
+	size_t cap;
+
+	assert(map != NULL);
+	assert(!mcc_hash_map_incremental_resize(map, true));
+	for (int i = 0; i < 3000; i += 3)
+		assert(!map_insert(map, &i, &(int){-i}));
+	for (int i = 0; i < 1000; i++)
+		keys[i] = i;
+	assert(!mcc_hash_map_get_many(map, keys, 1000, refs));
+	for (int i = 0; i < 1000; i++) {
+		if (i % 3)
+			assert(refs[i] == NULL);
+		else
+			assert(*(int *)refs[i] == -i);
+	}
+	assert(!mcc_hash_map_get_many(map, keys, 0, NULL));
+	mcc_hash_map_drop(map);
+
+	/*
+	 * Stop right after an insert that started a resize, so the lookups
+	 * run while the old table is still being drained. None of them may
+	 * move entries, or the refs of earlier keys would dangle.
+	 */
+	map = mcc_hash_map_new(mcc_int(), mcc_int());
+	assert(map != NULL);
+	assert(!mcc_hash_map_incremental_resize(map, true));
+	n = 0;
+	do {
+		cap = mcc_hash_map_capacity(map);
+		assert(!map_insert(map, &(int){n}, &(int){-n}));
+		n++;
+	} while (n < 1000 || mcc_hash_map_capacity(map) == cap);
+	for (int i = 0; i < 4096; i++)
+		many[i] = i;
+	assert(!mcc_hash_map_get_many(map, many, 4096, many_refs));
+	for (int i = 0; i < 4096; i++) {
+		if (i < n)
+			assert(*(int *)many_refs[i] == -i);
+		else
+			assert(many_refs[i] == NULL);
+	}
+	mcc_hash_map_drop(map);
+}
+
+static void test_hashed()
+{
+	struct mcc_hash_map *a = mcc_hash_map_new(mcc_str(), mcc_int());
+	struct mcc_hash_map *b = mcc_hash_map_new(mcc_str(), mcc_long());
+	mcc_str_t key = "Apple";
+	size_t hash;
+	void *v;
+
+	assert(a != NULL && b != NULL);
+	hash = mcc_hash_map_hash(a, &key);
+	assert(hash == mcc_hash_map_hash(b, &key));
+	assert(!mcc_hash_map_insert_hashed(a, &key, hash, &(int){1}));
+	assert(!mcc_hash_map_insert_hashed(b, &key, hash, &(long){2}));
+	assert(!map_get(a, &key, &v) && *(int *)v == 1);
+	assert(!mcc_hash_map_get_hashed(b, &key, hash, &v));
+	assert(*(long *)v == 2);
+	mcc_hash_map_remove_hashed(a, &key, hash);
+	assert(mcc_hash_map_get_hashed(a, &key, hash, &v) == NONE);
+	mcc_hash_map_drop(a);
+	mcc_hash_map_drop(b);
+}
+
+static void test_double_keys()
+{
+	struct mcc_hash_map *map = mcc_hash_map_new(mcc_double(), mcc_int());
+	const struct mcc_object_interface *D = mcc_double();
+	void *v;
+
+	assert(map != NULL);
+	assert(D->hash(&(double){0.0}) == D->hash(&(double){-0.0}));
+	assert(D->hash(&(double){1.25}) != D->hash(&(double){1.5}));
+	for (int i = 0; i < 1000; i++)
+		assert(!map_insert(map, &(double){1.0 + i / 1000.0}, &i));
+	assert(mcc_hash_map_len(map) == 1000);
+	assert(!map_get(map, &(double){1.5}, &v) && *(int *)v == 500);
+	assert(!map_insert(map, &(double){0.0}, &(int){-1}));
+	assert(!map_get(map, &(double){-0.0}, &v) && *(int *)v == -1);
+	mcc_hash_map_drop(map);
+}
+
+struct counter {
+	size_t allocs;
+	size_t frees;
+};
+
+static void *count_alloc(void *ctx, size_t size)
+{
+	((struct counter *)ctx)->allocs++;
+	return malloc(size);
+}
+
+static void count_free(void *ctx, void *ptr)
+{
+	((struct counter *)ctx)->frees++;
+	free(ptr);
+}
+
+static void test_allocator()
+{
+	struct counter c = { 0, 0 };
+	struct mcc_allocator a = { count_alloc, NULL, count_free, &c };
+	struct mcc_hash_map *map;
+	int i, *ref;
+
+	/* The global allocator applies to maps created afterwards. */
+	mcc_set_allocator(&a);
+	map = mcc_hash_map_new(mcc_int(), mcc_int());
+	mcc_set_allocator(NULL);
+	assert(map != NULL);
+	for (i = 0; i < 1000; i++)
+		assert(!map_insert(map, &i, &i));
+	for (i = 0; i < 1000; i++)
+		assert(!map_get(map, &i, (void **)&ref) && *ref == i);
+	assert(c.allocs > 2);
+	mcc_hash_map_drop(map);
+	assert(c.allocs == c.frees);
+
+	a.alloc = NULL;
+	assert(!mcc_hash_map_new_with_allocator(&a, mcc_int(), mcc_int()));
+}
+
+/* Removes keys while the table doubles, so tombstones move with it. */
+static void test_growth()
+{
+	struct mcc_hash_map *map = mcc_hash_map_new(mcc_int(), mcc_int());
+	size_t cap, doublings = 0;
+	int i, *v;
+
+	assert(map != NULL);
+	cap = mcc_hash_map_capacity(map);
+	for (i = 0; i < 100000; i++) {
+		assert(!map_insert(map, &i, &i));
+		if (i % 3 == 2)
+			map_remove(map, &(int){i - 1});
+		if (mcc_hash_map_capacity(map) != cap) {
+			assert(mcc_hash_map_capacity(map) == cap * 2);
+			cap *= 2;
+			doublings++;
+		}
+	}
+	assert(doublings >= 5);
+	assert(mcc_hash_map_len(map) == 100000 - 100000 / 3);
+	for (i = 0; i < 100000; i++) {
+		if (i % 3 == 1 && i != 99999)
+			assert(map_get(map, &i, (void **)&v) == NONE);
+		else
+			assert(!map_get(map, &i, (void **)&v) && *v == i);
+	}
+	mcc_hash_map_drop(map);
+}
+
+#define insert_at(map, key, hash, value)                                     \
+	mcc_hash_map_insert_hashed(map, &(int){key}, hash, &(int){value})
+#define get_at(map, key, hash, ref)                                          \
+	mcc_hash_map_get_hashed(map, &(int){key}, hash, (void **)(ref))
+#define remove_at(map, key, hash)                                            \
+	mcc_hash_map_remove_hashed(map, &(int){key}, hash)
+
+/*
+ * Keys given the same hash all probe the groups in the same order, so they
+ * fill the table group by group, and removing them leaves only tombstones.
+ */
+static void test_tombstones()
+{
+	struct counter c = { 0, 0 };
+	struct mcc_allocator a = { count_alloc, NULL, count_free, &c };
+	struct mcc_hash_map *map;
+	size_t cap, allocs;
+	int i, full, *v;
+
+	map = mcc_hash_map_new_with_allocator(&a, mcc_int(), mcc_int());
+	assert(map != NULL);
+	assert(!mcc_hash_map_reserve(map, 1000));
+	cap = mcc_hash_map_capacity(map);
+	allocs = c.allocs;
+	full = cap - cap / 8;
+	for (i = 0; i < full; i++)
+		assert(!insert_at(map, i, 0, i));
+	for (i = 0; i < full; i++)
+		remove_at(map, i, 0);
+	assert(mcc_hash_map_is_empty(map));
+
+	/* A miss probes past every group of tombstones. */
+	assert(get_at(map, 0, 0, &v) == NONE);
+	assert(get_at(map, full, 0, &v) == NONE);
+
+	/* Reinserted keys take the tombstones, the table stays as it is. */
+	for (i = 0; i < full; i++)
+		assert(!insert_at(map, i, 0, -i));
+	for (i = 0; i < full; i++)
+		assert(!get_at(map, i, 0, &v) && *v == -i);
+	assert(c.allocs == allocs && mcc_hash_map_capacity(map) == cap);
+	for (i = 0; i < full; i++)
+		remove_at(map, i, 0);
+
+	/*
+	 * No room is left, so the first key whose probe starts at one of the
+	 * empty groups rehashes. The bits above the low 7, which go to the
+	 * control byte, pick that group. Few entries are live, so the table
+	 * is rebuilt at the same capacity.
+	 */
+	for (i = 1; c.allocs == allocs; i++) {
+		assert(i < full);
+		assert(!insert_at(map, i, (size_t)i << 7, i));
+	}
+	assert(mcc_hash_map_capacity(map) == cap);
+	assert(mcc_hash_map_len(map) == (size_t)i - 1);
+	while (--i)
+		assert(!get_at(map, i, (size_t)i << 7, &v) && *v == i);
+	mcc_hash_map_drop(map);
+	assert(c.allocs == c.frees);
+}
+
+static void test_iter_init()
+{
+	struct mcc_hash_map_iter iter;
+	struct mcc_pair pairs[7], *pair;
+	size_t n, i, count = 0;
+	long sum = 0;
+	int *v;
+	struct mcc_hash_map *map = mcc_hash_map_new(mcc_int(), mcc_int());
+	assert(map != NULL);
+	assert(!mcc_hash_map_incremental_resize(map, true));
+	for (int i = 0; i < 10000; i++)
+		assert(!map_insert(map, &i, &(int){i * 2}));
+
+	/* Walks the old table as well while a resize is in progress. */
+	assert(!mcc_hash_map_iter_init(&iter, map));
+	assert(mcc_hash_map_iter_next(&iter, &pair));
+	count++;
+	sum += *(const int *)pair->key;
+	while ((n = mcc_hash_map_iter_next_n(&iter, pairs, 7))) {
+		for (i = 0; i < n; i++) {
+			v = pairs[i].value;
+			assert(*v == *(const int *)pairs[i].key * 2);
+			sum += *(const int *)pairs[i].key;
+		}
+		count += n;
+	}
+	assert(count == 10000);
+	assert(sum == 9999L * 10000 / 2);
+	mcc_hash_map_drop(map);
+}
+
+static int negate_value(struct mcc_pair *pair, void *ctx)
+{
+	if (*(const int *)pair->key == *(int *)ctx)
+		return NONE;
+	*(int *)pair->value = -*(int *)pair->value;
+	return OK;
+}
+
+static bool count_below(const struct mcc_pair *pair, void *acc)
+{
+	if (*(const int *)pair->key >= 500)
+		return false;
+	++*(int *)acc;
+	return true;
+}
+
+static void test_for_each()
+{
+	int i, count = 0, *v;
+	struct mcc_hash_map *map = mcc_hash_map_new(mcc_int(), mcc_int());
+	assert(map != NULL);
+	for (i = 999; i >= 0; i--)
+		assert(!map_insert(map, &i, &i));
+
+	/* Stops at the first key >= 500, wherever it is. */
+	assert(mcc_hash_map_fold(map, count_below, &count) == (size_t)count);
+	assert(count < 500);
+	assert(!mcc_hash_map_for_each(map, negate_value, &(int){-1}));
+	for (i = 0; i < 1000; i++) {
+		assert(!map_get(map, &i, (void **)&v));
+		assert(*v == -i);
+	}
+	mcc_hash_map_drop(map);
+}
+
 int main(void)
 {
 	struct mcc_hash_map *map = mcc_hash_map_new(mcc_str(), mcc_int());
@@ -44,6 +374,15 @@ int main(void)
 	map_remove(map, &(mcc_str_t){"Strawberry"});
 	print(map);
 	mcc_hash_map_drop(map);
+	test_incremental_resize();
+	test_get_many();
+	test_hashed();
+	test_double_keys();
+	test_allocator();
+	test_growth();
+	test_tombstones();
+	test_iter_init();
+	test_for_each();
 	puts("testing done");
 	return 0;
 }
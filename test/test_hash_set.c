@@ -12,6 +12,8 @@ int main(void)
 {
 	struct fruit tmp;
 	const struct fruit *ref;
+	struct fruit batch[3] = { { "Apple" }, { "Kiwi" }, { "Grape" } };
+	bool found[3];
 	struct mcc_hash_set *set = mcc_hash_set_new(&fruit_);
 	assert(set != NULL);
 	assert(!set_insert(set, fruit_new(&tmp, "Orange")));
@@ -26,6 +28,8 @@ int main(void)
 	assert(!fruit_cmp(ref, &(struct fruit){"Apple", 1, 0.5}));
 	assert(!set_get(set, &(struct fruit){"Grape"}, (const void **)&ref));
 	assert(!fruit_cmp(ref, &(struct fruit){"Grape", 1, 0.5}));
+	assert(!mcc_hash_set_contains_many(set, batch, 3, found));
+	assert(found[0] && !found[1] && found[2]);
 	set_remove(set, &(struct fruit){"Pineapple"});
 	assert(set_get(set, &(struct fruit){"Pineapple"}, (const void **)&ref));
 	mcc_hash_set_drop(set);
@@ -1,5 +1,7 @@
 #include "fruit.h"
+#include "mcc_err.h"
 #include "mcc_list.h"
+#include "visit.h"
 #include <assert.h>
 
 static bool equals(struct mcc_list *d, int *a)
@@ -143,12 +145,73 @@ static void test_iterator()
 	mcc_list_drop(d);
 }
 
+static void test_sort()
+{
+	struct mcc_list *d = mcc_list_new(mcc_int());
+	assert(d != NULL);
+	/* An ascending run, a descending run and an unordered tail. */
+	assert(!mcc_list_push_back(d, &(int){1}));
+	assert(!mcc_list_push_back(d, &(int){4}));
+	assert(!mcc_list_push_back(d, &(int){6}));
+	assert(!mcc_list_push_back(d, &(int){9}));
+	assert(!mcc_list_push_back(d, &(int){8}));
+	assert(!mcc_list_push_back(d, &(int){5}));
+	assert(!mcc_list_push_back(d, &(int){2}));
+	assert(!mcc_list_push_back(d, &(int){7}));
+	assert(!mcc_list_push_back(d, &(int){0}));
+	assert(!mcc_list_push_back(d, &(int){3}));
+	assert(!mcc_list_sort(d));
+	assert(equals(d, (int[]){0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+	mcc_list_pop_back(d);
+	mcc_list_pop_front(d);
+	assert(equals(d, (int[]){1, 2, 3, 4, 5, 6, 7, 8}));
+	mcc_list_drop(d);
+}
+
+static void test_iter_init()
+{
+	struct mcc_list_iter iter;
+	int *refs[5];
+	size_t i, n, total = 0;
+	struct mcc_list *d = mcc_list_new(mcc_int());
+	assert(d != NULL);
+	for (i = 0; i < 16; i++)
+		assert(!mcc_list_push_back(d, &(int){i}));
+	assert(!mcc_list_iter_init(&iter, d));
+	while ((n = mcc_list_iter_next_n(&iter, (void **)refs, 5))) {
+		for (i = 0; i < n; i++)
+			assert(*refs[i] == total + i);
+		total += n;
+	}
+	assert(total == 16);
+	mcc_list_drop(d);
+}
+
+static void test_for_each()
+{
+	int i;
+	long sum = 0;
+	struct mcc_list *d = mcc_list_new(mcc_int());
+	assert(d != NULL);
+	for (i = 0; i < 16; i++)
+		assert(!mcc_list_push_back(d, &(int){i}));
+
+	assert(mcc_list_for_each(d, double_below, &(int){3}) == OUT_OF_RANGE);
+	assert(equals(d, (int[]){0, 2, 4, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13,
+				 14, 15}));
+	assert(mcc_list_fold(d, sum_below_100, &sum) == 14 && sum == 94);
+	mcc_list_drop(d);
+}
+
 int main(void)
 {
 	test_push_and_pop();
 	test_insert_and_remove();
 	test_drop_call();
 	test_iterator();
+	test_iter_init();
+	test_for_each();
+	test_sort();
 	puts("testing done");
 	return 0;
 }
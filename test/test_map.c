@@ -1,6 +1,9 @@
+#include "mcc_err.h"
 #include "mcc_map.h"
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #define map_insert mcc_map_insert
 #define map_remove mcc_map_remove
@@ -24,6 +27,344 @@ static void print(struct mcc_map *map)
 	mcc_map_iter_drop(iter);
 }
 
+static void test_cursor()
+{
+	struct mcc_map_iter *iter;
+	struct mcc_pair *pair;
+	int i, expected;
+	struct mcc_map *map = mcc_map_new(mcc_int(), mcc_int());
+	assert(map != NULL);
+	for (i = 0; i < 100; i += 2)
+		assert(!map_insert(map, &i, &i));
+
+	assert(!mcc_map_first(map, &pair) && *(const int *)pair->key == 0);
+	assert(!mcc_map_last(map, &pair) && *(const int *)pair->key == 98);
+
+	iter = mcc_map_iter_new(map);
+	assert(iter != NULL);
+	mcc_map_iter_seek_ge(iter, &(int){40});
+	for (expected = 40; expected < 50; expected += 2) {
+		assert(mcc_map_iter_next(iter, &pair));
+		assert(*(const int *)pair->key == expected);
+	}
+	mcc_map_iter_seek_gt(iter, &(int){40});
+	assert(mcc_map_iter_next(iter, &pair) && *(const int *)pair->key == 42);
+	assert(mcc_map_iter_prev(iter, &pair) && *(const int *)pair->key == 42);
+	assert(mcc_map_iter_prev(iter, &pair) && *(const int *)pair->key == 40);
+
+	mcc_map_iter_seek_end(iter);
+	for (expected = 98; mcc_map_iter_prev(iter, &pair); expected -= 2)
+		assert(*(const int *)pair->key == expected);
+	assert(expected == -2);
+	mcc_map_iter_drop(iter);
+
+	mcc_map_pop_first(map);
+	mcc_map_pop_last(map);
+	assert(!mcc_map_first(map, &pair) && *(const int *)pair->key == 2);
+	assert(!mcc_map_last(map, &pair) && *(const int *)pair->key == 96);
+	mcc_map_clear(map);
+	assert(mcc_map_first(map, &pair) == NONE);
+	mcc_map_drop(map);
+}
+
+static void test_order_statistics()
+{
+	struct mcc_map_iter *iter;
+	struct mcc_pair *pair;
+	size_t rank, count;
+	int i;
+	struct mcc_map *map = mcc_map_new(mcc_int(), mcc_int());
+	assert(map != NULL);
+	for (i = 0; i < 50; i += 2)
+		assert(!map_insert(map, &i, &i));
+
+	for (i = 50; i < 100; i += 2)
+		assert(!map_insert(map, &i, &i));
+	for (i = 0; i < 100; i += 4)
+		map_remove(map, &i);
+
+	/* The keys are now 2, 6, 10, ..., 98. */
+	assert(!mcc_map_rank(map, &(int){2}, &rank) && rank == 0);
+	assert(!mcc_map_rank(map, &(int){7}, &rank) && rank == 2);
+	assert(!mcc_map_rank(map, &(int){1000}, &rank) && rank == 25);
+	for (i = 0; i < 25; i++) {
+		assert(!mcc_map_select(map, i, &pair));
+		assert(*(const int *)pair->key == 4 * i + 2);
+	}
+	assert(mcc_map_select(map, 25, &pair) == OUT_OF_RANGE);
+	assert(!mcc_map_count_range(map, &(int){10}, &(int){30}, &count));
+	assert(count == 5);
+	assert(!mcc_map_count_range(map, &(int){30}, &(int){10}, &count));
+	assert(count == 0);
+
+	iter = mcc_map_iter_new(map);
+	assert(iter != NULL);
+	mcc_map_iter_seek_nth(iter, 10);
+	assert(mcc_map_iter_next(iter, &pair) && *(const int *)pair->key == 42);
+	mcc_map_iter_seek_nth(iter, 25);
+	assert(!mcc_map_iter_next(iter, &pair));
+	mcc_map_iter_drop(iter);
+	mcc_map_drop(map);
+}
+
+static void test_from_sorted()
+{
+	int keys[100], values[100], i;
+	struct mcc_pair *pair;
+	size_t rank;
+	struct mcc_map *map;
+	int *v;
+
+	for (i = 0; i < 100; i++) {
+		keys[i] = i * 2;
+		values[i] = -i;
+	}
+	map = mcc_map_from_sorted(mcc_int(), mcc_int(), keys, values, 100);
+	assert(map != NULL && mcc_map_len(map) == 100);
+	assert(!map_get(map, &(int){42}, (void **)&v) && *v == -21);
+	assert(!mcc_map_select(map, 99, &pair));
+	assert(*(const int *)pair->key == 198);
+	assert(!map_insert(map, &(int){43}, &(int){0}));
+	map_remove(map, &(int){0});
+	assert(!mcc_map_first(map, &pair) && *(const int *)pair->key == 2);
+	assert(!mcc_map_rank(map, &(int){44}, &rank) && rank == 22);
+	mcc_map_drop(map);
+
+	keys[1] = keys[0];
+	assert(!mcc_map_from_sorted(mcc_int(), mcc_int(), keys, values, 100));
+}
+
+static void test_union()
+{
+	struct mcc_map *a, *b;
+	struct mcc_pair *pair;
+	int i, *v;
+
+	a = mcc_map_new(mcc_int(), mcc_int());
+	b = mcc_map_new(mcc_int(), mcc_int());
+	assert(a != NULL && b != NULL);
+	for (i = 0; i < 100; i++) {
+		assert(!map_insert(a, &(int){i * 2}, &(int){1}));
+		assert(!map_insert(b, &(int){i * 3}, &(int){2}));
+	}
+	assert(!mcc_map_union(a, b));
+	assert(mcc_map_len(a) == 166 && mcc_map_is_empty(b));
+	assert(!map_get(a, &(int){6}, (void **)&v) && *v == 1);
+	assert(!map_get(a, &(int){9}, (void **)&v) && *v == 2);
+
+	/* The nodes that came from b outlive it. */
+	mcc_map_drop(b);
+	for (i = 0; i < 300; i += 3)
+		map_remove(a, &i);
+	assert(!map_insert(a, &(int){3}, &(int){3}));
+	assert(mcc_map_len(a) == 67);
+
+	/* Subtree sizes stay exact across union and split. */
+	b = mcc_map_split(a, &(int){100});
+	assert(b != NULL && mcc_map_len(a) == 34 && mcc_map_len(b) == 33);
+	assert(!mcc_map_select(a, 33, &pair) && *(const int *)pair->key == 98);
+	assert(!mcc_map_select(b, 0, &pair) && *(const int *)pair->key == 100);
+	assert(!mcc_map_select(b, 32, &pair) && *(const int *)pair->key == 196);
+	mcc_map_drop(b);
+	mcc_map_drop(a);
+}
+
+struct counter {
+	size_t allocs;
+	size_t frees;
+};
+
+static void *count_alloc(void *ctx, size_t size)
+{
+	((struct counter *)ctx)->allocs++;
+	return malloc(size);
+}
+
+static void count_free(void *ctx, void *ptr)
+{
+	((struct counter *)ctx)->frees++;
+	free(ptr);
+}
+
+static void test_allocator()
+{
+	struct counter ca = { 0, 0 }, cb = { 0, 0 };
+	struct mcc_allocator a = { count_alloc, NULL, count_free, &ca };
+	struct mcc_allocator b = { count_alloc, NULL, count_free, &cb };
+	struct mcc_map *x, *y, *z;
+	int i;
+
+	x = mcc_map_new_with_allocator(&a, mcc_int(), mcc_int());
+	y = mcc_map_new_with_allocator(&a, mcc_int(), mcc_int());
+	z = mcc_map_new_with_allocator(&b, mcc_int(), mcc_int());
+	assert(x != NULL && y != NULL && z != NULL);
+	for (i = 0; i < 100; i++) {
+		assert(!map_insert(x, &(int){i * 2}, &i));
+		assert(!map_insert(y, &(int){i * 3}, &i));
+		assert(!map_insert(z, &(int){i * 5}, &i));
+	}
+	assert(cb.allocs > 0);
+
+	/* Nodes only move between maps with equal allocators. */
+	assert(mcc_map_join(x, z) == INVALID_ARGUMENTS);
+	assert(mcc_map_union(x, z) == INVALID_ARGUMENTS);
+	assert(!mcc_map_union(x, y));
+	assert(mcc_map_len(x) == 166);
+	mcc_map_drop(y);
+	mcc_map_drop(z);
+	assert(cb.allocs == cb.frees);
+	mcc_map_drop(x);
+	assert(ca.allocs == ca.frees);
+}
+
+static void test_arena()
+{
+	struct mcc_arena *arena = mcc_arena_new(0);
+	struct mcc_map *a, *b, *c;
+	size_t mark;
+	int i;
+
+	assert(arena != NULL);
+	a = mcc_map_new_in(arena, mcc_int(), mcc_int());
+	mark = mcc_arena_mark(arena);
+	b = mcc_map_new_in(arena, mcc_int(), mcc_int());
+	c = mcc_map_new(mcc_int(), mcc_int());
+	assert(a != NULL && b != NULL && c != NULL);
+	for (i = 0; i < 1000; i++) {
+		assert(!map_insert(a, &(int){i * 2}, &i));
+		assert(!map_insert(b, &(int){i * 3}, &i));
+		assert(!map_insert(c, &(int){i * 5}, &i));
+	}
+
+	/* Only maps of the same arena exchange nodes. */
+	assert(mcc_map_union(a, c) == INVALID_ARGUMENTS);
+	assert(!mcc_map_union(a, b));
+	assert(mcc_map_len(a) == 1666);
+	mcc_map_drop(c);
+
+	c = mcc_map_split(a, &(int){1000});
+	assert(c != NULL && mcc_map_len(c) == 999);
+	assert(!mcc_map_join(a, c));
+	assert(mcc_map_len(a) == 1666);
+
+	/* a holds nodes of b, which must stay valid past b. */
+	mcc_map_drop(b);
+	mcc_map_drop(c);
+	for (i = 0; i < 3000; i += 3)
+		map_remove(a, &i);
+	assert(mcc_map_len(a) == 666);
+	mcc_map_drop(a);
+	mcc_arena_release(arena, mark);
+	mcc_arena_drop(arena);
+}
+
+static void test_iter_init()
+{
+	struct mcc_map_iter iter;
+	struct mcc_pair pairs[7];
+	size_t n;
+	int i, expected = 0;
+	struct mcc_map *map = mcc_map_new(mcc_int(), mcc_int());
+	assert(map != NULL);
+	for (i = 999; i >= 0; i--)
+		assert(!map_insert(map, &i, &(int){i * 2}));
+
+	assert(!mcc_map_iter_init(&iter, map));
+	while ((n = mcc_map_iter_next_n(&iter, pairs, 7))) {
+		for (i = 0; i < (int)n; i++, expected++) {
+			assert(*(const int *)pairs[i].key == expected);
+			assert(*(int *)pairs[i].value == expected * 2);
+		}
+	}
+	assert(expected == 1000);
+	mcc_map_drop(map);
+}
+
+static int negate_value(struct mcc_pair *pair, void *ctx)
+{
+	if (*(const int *)pair->key == *(int *)ctx)
+		return NONE;
+	*(int *)pair->value = -*(int *)pair->value;
+	return OK;
+}
+
+static bool count_below(const struct mcc_pair *pair, void *acc)
+{
+	if (*(const int *)pair->key >= 500)
+		return false;
+	++*(int *)acc;
+	return true;
+}
+
+static void test_for_each()
+{
+	int i, count = 0, *v;
+	struct mcc_map *map = mcc_map_new(mcc_int(), mcc_int());
+	assert(map != NULL);
+	for (i = 999; i >= 0; i--)
+		assert(!map_insert(map, &i, &i));
+
+	/* Stops at the first key >= 500, which comes after all smaller ones. */
+	assert(mcc_map_fold(map, count_below, &count) == 500);
+	assert(count == 500);
+	assert(mcc_map_for_each(map, negate_value, &(int){250}) == NONE);
+	for (i = 0; i < 1000; i++) {
+		assert(!map_get(map, &i, (void **)&v));
+		assert(*v == (i < 250 ? -i : i));
+	}
+	mcc_map_drop(map);
+}
+
+struct churn_arg {
+	struct mcc_map *map;
+	int base;
+};
+
+/* Removes and re-inserts the keys base to base + 9999 of a map. */
+static void *churn(void *arg)
+{
+	struct churn_arg *c = arg;
+	int i, j, k;
+
+	for (j = 0; j < 10; j++) {
+		for (i = j & 1; i < 10000; i += 2)
+			map_remove(c->map, &(int){c->base + i});
+		for (i = j & 1; i < 10000; i += 2) {
+			k = c->base + i;
+			assert(!map_insert(c->map, &k, &k));
+		}
+	}
+	return NULL;
+}
+
+static void test_split_threads()
+{
+	struct churn_arg a, b;
+	pthread_t thread;
+	int i, *v;
+
+	/* b starts out with nodes from the blocks of a. */
+	a.map = mcc_map_new(mcc_int(), mcc_int());
+	assert(a.map != NULL);
+	for (i = 0; i < 20000; i++)
+		assert(!map_insert(a.map, &i, &i));
+	b.map = mcc_map_split(a.map, &(int){10000});
+	assert(b.map != NULL);
+	a.base = 0;
+	b.base = 10000;
+
+	assert(!pthread_create(&thread, NULL, churn, &b));
+	churn(&a);
+	assert(!pthread_join(thread, NULL));
+
+	assert(!mcc_map_join(a.map, b.map));
+	assert(mcc_map_len(a.map) == 20000);
+	for (i = 0; i < 20000; i++)
+		assert(!map_get(a.map, &i, (void **)&v) && *v == i);
+	mcc_map_drop(b.map);
+	mcc_map_drop(a.map);
+}
+
 int main(void)
 {
 	struct mcc_map *map = mcc_map_new(mcc_str(), mcc_int());
@@ -54,6 +395,15 @@ int main(void)
 	puts("---------------------------");
 	print(map);
 	mcc_map_drop(map);
+	test_cursor();
+	test_order_statistics();
+	test_from_sorted();
+	test_union();
+	test_allocator();
+	test_arena();
+	test_split_threads();
+	test_iter_init();
+	test_for_each();
 	puts("testing done");
 	return 0;
 }
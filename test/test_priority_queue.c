@@ -30,5 +30,22 @@ int main(void)
 	putchar('\n');
 
 	mcc_priority_queue_drop(q);
+
+	assert((q = mcc_priority_queue_new(mcc_int())) != NULL);
+	int values[1000];
+	for (size_t i = 0; i < 1000; i++)
+		values[i] = rand() % 1000;
+	assert(!mcc_priority_queue_push_many(q, values, 1000));
+	assert(!mcc_priority_queue_push_many(q, values, 10));
+	assert(mcc_priority_queue_len(q) == 1010);
+	int last = 1000;
+	while (!mcc_priority_queue_is_empty(q)) {
+		assert(!mcc_priority_queue_front(q, (void **)&mut_ref));
+		assert(*mut_ref <= last);
+		last = *mut_ref;
+		mcc_priority_queue_pop(q);
+	}
+	mcc_priority_queue_drop(q);
+	puts("testing done");
 	return 0;
 }
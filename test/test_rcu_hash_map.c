@@ -0,0 +1,159 @@
+#include "mcc_err.h"
+#include "mcc_rcu_hash_map.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+
+#define map_insert mcc_rcu_hash_map_insert
+#define map_remove mcc_rcu_hash_map_remove
+#define map_get mcc_rcu_hash_map_get
+
+#define NREADERS 4
+#define STABLE_KEYS 1000
+#define ROUNDS 20
+
+static void test_basic()
+{
+	struct mcc_rcu_hash_map_iter *iter;
+	struct mcc_pair *pair;
+	int i, value, sum = 0;
+	struct mcc_rcu_hash_map *map =
+		mcc_rcu_hash_map_new(mcc_int(), mcc_int());
+	assert(map != NULL);
+	for (i = 0; i < 1000; i++)
+		assert(!map_insert(map, &i, &(int){i * 10}));
+	assert(mcc_rcu_hash_map_len(map) == 1000);
+	assert(!map_insert(map, &(int){5}, &(int){-5}));
+	assert(!map_get(map, &(int){5}, &value) && value == -5);
+	assert(map_get(map, &(int){1000}, &value) == NONE);
+
+	for (i = 0; i < 1000; i += 2)
+		assert(!map_remove(map, &i));
+	assert(map_remove(map, &(int){0}) == NONE);
+	assert(mcc_rcu_hash_map_len(map) == 500);
+
+	iter = mcc_rcu_hash_map_iter_new(map);
+	assert(iter != NULL);
+	while (mcc_rcu_hash_map_iter_next(iter, &pair)) {
+		assert(*(const int *)pair->key % 2 == 1);
+		sum++;
+	}
+	assert(sum == 500);
+	mcc_rcu_hash_map_iter_drop(iter);
+	mcc_rcu_hash_map_drop(map);
+}
+
+static int done;
+
+/* Keys below STABLE_KEYS are never removed, only get new values. */
+static void *reader(void *arg)
+{
+	struct mcc_rcu_hash_map *map = arg;
+	int key = 0, value;
+
+	while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+		assert(!map_get(map, &key, &value));
+		assert(value % STABLE_KEYS == key);
+		key = (key + 1) % STABLE_KEYS;
+	}
+	return NULL;
+}
+
+static void test_threads()
+{
+	pthread_t threads[NREADERS];
+	int i, j, key;
+	struct mcc_rcu_hash_map *map =
+		mcc_rcu_hash_map_new(mcc_int(), mcc_int());
+	assert(map != NULL);
+	for (key = 0; key < STABLE_KEYS; key++)
+		assert(!map_insert(map, &key, &key));
+	for (i = 0; i < NREADERS; i++)
+		assert(!pthread_create(&threads[i], NULL, reader, map));
+
+	/* Every round grows the table, replaces values and shrinks back. */
+	for (i = 1; i <= ROUNDS; i++) {
+		for (key = STABLE_KEYS; key < STABLE_KEYS * 8; key++)
+			assert(!map_insert(map, &key, &key));
+		for (key = 0; key < STABLE_KEYS; key++) {
+			j = key + i * STABLE_KEYS;
+			assert(!map_insert(map, &key, &j));
+		}
+		for (key = STABLE_KEYS; key < STABLE_KEYS * 8; key++)
+			assert(!map_remove(map, &key));
+	}
+
+	__atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+	for (i = 0; i < NREADERS; i++)
+		pthread_join(threads[i], NULL);
+
+	assert(mcc_rcu_hash_map_len(map) == STABLE_KEYS);
+	for (key = 0; key < STABLE_KEYS; key++) {
+		assert(!map_get(map, &key, &j));
+		assert(j == key + ROUNDS * STABLE_KEYS);
+	}
+	mcc_rcu_hash_map_drop(map);
+}
+
+static int drops;
+
+static void count_drop(void *self)
+{
+	__atomic_fetch_add(&drops, 1, __ATOMIC_RELAXED);
+}
+
+static struct mcc_object_interface counted = {
+	.size = sizeof(int),
+	.drop = count_drop,
+};
+
+static void *remove_some(void *arg)
+{
+	int key;
+
+	for (key = 10; key < 20; key++)
+		assert(!map_remove(arg, &key));
+	return NULL;
+}
+
+/*
+ * Fewer removes than it takes to trigger a reclaim, by a thread that keeps
+ * reading and by one that exits right away. The entries of the latter are
+ * freed by the next thread that reclaims its own.
+ */
+static void test_quiet_writers()
+{
+	pthread_t thread;
+	int i, key, value;
+	struct mcc_rcu_hash_map *map =
+		mcc_rcu_hash_map_new(mcc_int(), &counted);
+	assert(map != NULL);
+	for (key = 0; key < 100; key++)
+		assert(!map_insert(map, &key, &key));
+
+	for (key = 0; key < 10; key++)
+		assert(!map_remove(map, &key));
+	for (i = 0; i < 1000; i++)
+		assert(!map_get(map, &(int){50}, &value));
+	assert(__atomic_load_n(&drops, __ATOMIC_RELAXED) == 10);
+
+	assert(!pthread_create(&thread, NULL, remove_some, map));
+	pthread_join(thread, NULL);
+	for (i = 0; i < 1000; i++)
+		assert(!map_get(map, &(int){50}, &value));
+	assert(__atomic_load_n(&drops, __ATOMIC_RELAXED) == 10);
+	assert(!map_remove(map, &(int){20}));
+	for (i = 0; i < 1000; i++)
+		assert(!map_get(map, &(int){50}, &value));
+	assert(__atomic_load_n(&drops, __ATOMIC_RELAXED) == 21);
+	mcc_rcu_hash_map_drop(map);
+}
+
+int main(void)
+{
+	test_basic();
+	test_threads();
+	test_quiet_writers();
+	puts("testing done");
+	return 0;
+}
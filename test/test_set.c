@@ -1,4 +1,5 @@
 #include "fruit.h"
+#include "mcc_err.h"
 #include "mcc_set.h"
 #include <assert.h>
 
@@ -7,6 +8,107 @@
 #define set_get mcc_set_get
 #define set_clear mcc_set_clear
 
+static struct mcc_set *range(int begin, int end, int step)
+{
+	struct mcc_set *set = mcc_set_new(mcc_int());
+	int i;
+
+	assert(set != NULL);
+	for (i = begin; i < end; i += step)
+		assert(!set_insert(set, &i));
+	return set;
+}
+
+static void assert_range(struct mcc_set *set, int begin, int end, int step)
+{
+	struct mcc_set_iter *iter = mcc_set_iter_new(set);
+	const int *ref;
+	int i;
+
+	assert(iter != NULL);
+	for (i = begin; i < end; i += step)
+		assert(mcc_set_iter_next(iter, (const void **)&ref) && *ref == i);
+	assert(!mcc_set_iter_next(iter, (const void **)&ref));
+	mcc_set_iter_drop(iter);
+}
+
+static void test_set_operations()
+{
+	struct mcc_set *a = range(0, 1000, 2), *b = range(0, 1000, 3);
+
+	assert(!mcc_set_intersection(a, b));
+	assert(mcc_set_is_empty(b));
+	assert_range(a, 0, 1000, 6);
+	mcc_set_drop(b);
+
+	b = range(0, 1000, 3);
+	assert(!mcc_set_union(a, b));
+	assert(mcc_set_len(a) == 334);
+	assert_range(a, 0, 1000, 3);
+	mcc_set_drop(b);
+
+	b = range(0, 500, 1);
+	assert(!mcc_set_difference(a, b));
+	assert_range(a, 501, 1000, 3);
+	mcc_set_drop(b);
+
+	b = mcc_set_split(a, &(int){750});
+	assert(b != NULL);
+	assert_range(a, 501, 750, 3);
+	assert_range(b, 750, 1000, 3);
+	assert(mcc_set_join(b, a) == INVALID_ARGUMENTS);
+	assert(!mcc_set_join(a, b));
+	assert_range(a, 501, 1000, 3);
+	assert(mcc_set_is_empty(b));
+	mcc_set_drop(a);
+	mcc_set_drop(b);
+}
+
+static void test_iter_init()
+{
+	struct mcc_set_iter iter;
+	const int *refs[40];
+	struct mcc_set *set = range(0, 300, 3);
+	size_t i;
+
+	assert(!mcc_set_iter_init(&iter, set));
+	assert(mcc_set_iter_next_n(&iter, (const void **)refs, 40) == 40);
+	for (i = 0; i < 40; i++)
+		assert(*refs[i] == (int)i * 3);
+	assert(mcc_set_iter_next_n(&iter, (const void **)refs, 40) == 40);
+	assert(*refs[0] == 120);
+	assert(mcc_set_iter_next_n(&iter, (const void **)refs, 40) == 20);
+	assert(*refs[19] == 297);
+	mcc_set_drop(set);
+}
+
+static int find_first_above(const void *elem, void *ctx)
+{
+	if (*(const int *)elem <= *(int *)ctx)
+		return OK;
+	*(int *)ctx = *(const int *)elem;
+	return NONE;
+}
+
+static bool sum_values(const void *elem, void *acc)
+{
+	*(long *)acc += *(const int *)elem;
+	return true;
+}
+
+static void test_for_each()
+{
+	struct mcc_set *set = range(0, 300, 3);
+	int value = 100;
+	long sum = 0;
+
+	assert(mcc_set_for_each(set, find_first_above, &value) == NONE);
+	assert(value == 102);
+	assert(mcc_set_fold(set, sum_values, &sum) == 100);
+	assert(sum == 3L * 99 * 100 / 2);
+	mcc_set_drop(set);
+}
+
 int main(void)
 {
 	struct fruit tmp;
@@ -28,6 +130,9 @@ int main(void)
 	set_remove(set, &(struct fruit){"Pineapple"});
 	assert(set_get(set, &(struct fruit){"Pineapple"}, (const void **)&ref));
 	mcc_set_drop(set);
+	test_set_operations();
+	test_iter_init();
+	test_for_each();
 	puts("testing done");
 	return 0;
 }
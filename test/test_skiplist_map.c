@@ -0,0 +1,99 @@
+#include "mcc_err.h"
+#include "mcc_skiplist_map.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+
+#define map_insert mcc_skiplist_map_insert
+#define map_remove mcc_skiplist_map_remove
+#define map_get mcc_skiplist_map_get
+
+#define NTHREADS 4
+#define KEYS_PER_THREAD 20000
+
+static void test_basic()
+{
+	struct mcc_skiplist_map_iter *iter;
+	struct mcc_pair *pair;
+	int i, value;
+	struct mcc_skiplist_map *map =
+		mcc_skiplist_map_new(mcc_int(), mcc_int());
+	assert(map != NULL);
+	for (i = 99; i >= 0; i--)
+		assert(!map_insert(map, &i, &(int){i * 10}));
+	assert(mcc_skiplist_map_len(map) == 100);
+	assert(!map_insert(map, &(int){5}, &(int){-5}));
+	assert(!map_get(map, &(int){5}, &value) && value == -5);
+	assert(map_get(map, &(int){100}, &value) == NONE);
+
+	for (i = 0; i < 100; i += 2)
+		assert(!map_remove(map, &i));
+	assert(map_remove(map, &(int){0}) == NONE);
+	assert(mcc_skiplist_map_len(map) == 50);
+
+	iter = mcc_skiplist_map_iter_new(map);
+	assert(iter != NULL);
+	mcc_skiplist_map_iter_seek_ge(iter, &(int){40});
+	for (i = 41; i < 100; i += 2) {
+		assert(mcc_skiplist_map_iter_next(iter, &pair));
+		assert(*(const int *)pair->key == i);
+		assert(*(int *)pair->value == i * 10);
+	}
+	assert(!mcc_skiplist_map_iter_next(iter, &pair));
+	mcc_skiplist_map_iter_seek_gt(iter, &(int){41});
+	assert(mcc_skiplist_map_iter_next(iter, &pair));
+	assert(*(const int *)pair->key == 43);
+	mcc_skiplist_map_iter_drop(iter);
+	mcc_skiplist_map_drop(map);
+}
+
+static void *worker(void *arg)
+{
+	struct mcc_skiplist_map *map = arg;
+	static int next_id;
+	int id = __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED);
+	int i, key, value;
+
+	for (i = 0; i < KEYS_PER_THREAD; i++) {
+		key = i * NTHREADS + id;
+		assert(!map_insert(map, &key, &key));
+		assert(!map_get(map, &key, &value) && value == key);
+		if (i % 2)
+			assert(!map_remove(map, &key));
+	}
+	return NULL;
+}
+
+static void test_threads()
+{
+	pthread_t threads[NTHREADS];
+	struct mcc_skiplist_map_iter *iter;
+	struct mcc_pair *pair;
+	int i, expected = 0;
+	struct mcc_skiplist_map *map =
+		mcc_skiplist_map_new(mcc_int(), mcc_int());
+	assert(map != NULL);
+	for (i = 0; i < NTHREADS; i++)
+		assert(!pthread_create(&threads[i], NULL, worker, map));
+	for (i = 0; i < NTHREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	assert(mcc_skiplist_map_len(map) == NTHREADS * KEYS_PER_THREAD / 2);
+	iter = mcc_skiplist_map_iter_new(map);
+	assert(iter != NULL);
+	while (mcc_skiplist_map_iter_next(iter, &pair)) {
+		assert(*(const int *)pair->key == expected);
+		expected += (expected + 1) % NTHREADS ? 1 : NTHREADS + 1;
+	}
+	assert(expected == NTHREADS * KEYS_PER_THREAD);
+	mcc_skiplist_map_iter_drop(iter);
+	mcc_skiplist_map_drop(map);
+}
+
+int main(void)
+{
+	test_basic();
+	test_threads();
+	puts("testing done");
+	return 0;
+}
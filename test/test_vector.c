@@ -1,6 +1,9 @@
 #include "fruit.h"
+#include "mcc_err.h"
 #include "mcc_vector.h"
+#include "visit.h"
 #include <assert.h>
+#include <stdlib.h>
 
 static bool equals(struct mcc_vector *v, int *a)
 {
@@ -124,12 +127,239 @@ static void test_iterator()
 	mcc_vector_drop(v);
 }
 
+static int compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x > y ? 1 : x == y ? 0 : -1;
+}
+
+static void test_radix_sort()
+{
+	size_t i, n = 5000;
+	double *a = malloc(n * sizeof(double)), *elem;
+	long long *prev, *cur;
+	struct mcc_vector *v = mcc_vector_new(mcc_double());
+	assert(v != NULL && a != NULL);
+	for (i = 0; i < n; i++)
+		a[i] = (double)(rand() - RAND_MAX / 2) / (rand() % 97 + 1);
+	a[0] = 0.0;
+	a[1] = -0.5;
+	assert(!mcc_vector_push_many(v, a, n));
+	assert(!mcc_vector_sort(v));
+	qsort(a, n, sizeof(double), compare_double);
+	for (i = 0; i < n; i++) {
+		assert(!mcc_vector_get(v, i, (void **)&elem));
+		assert(*elem == a[i]);
+	}
+	mcc_vector_drop(v);
+	free(a);
+
+	v = mcc_vector_new(mcc_long_long());
+	assert(v != NULL);
+	for (i = 0; i < n; i++) {
+		long long x = (long long)(i * i) * (i % 2 ? -1 : 1);
+		assert(!mcc_vector_push(v, &x));
+	}
+	assert(!mcc_vector_sort(v));
+	for (i = 1; i < n; i++) {
+		assert(!mcc_vector_get(v, i - 1, (void **)&prev));
+		assert(!mcc_vector_get(v, i, (void **)&cur));
+		assert(*prev <= *cur);
+	}
+	mcc_vector_drop(v);
+}
+
+struct record {
+	int key;
+	int seq;
+	char payload[8];
+};
+
+static int record_cmp(const struct record *self, const struct record *other)
+{
+	return self->key > other->key ? 1 : self->key == other->key ? 0 : -1;
+}
+
+static void test_par_sort()
+{
+	struct mcc_object_interface record_ = {
+		.size = sizeof(struct record),
+		.cmp = (mcc_compare_fn)&record_cmp,
+	};
+	struct record r = {}, *prev, *cur;
+	size_t i, n = 200003;
+	struct mcc_vector *v = mcc_vector_new(&record_);
+	assert(v != NULL);
+	for (i = 0; i < n; i++) {
+		r.key = rand() % 1000;
+		assert(!mcc_vector_push(v, &r));
+	}
+	assert(!mcc_vector_par_sort(v, 5));
+	assert(mcc_vector_len(v) == n);
+	for (i = 1; i < n; i++) {
+		assert(!mcc_vector_get(v, i - 1, (void **)&prev));
+		assert(!mcc_vector_get(v, i, (void **)&cur));
+		assert(prev->key <= cur->key);
+	}
+	mcc_vector_drop(v);
+}
+
+static void test_stable_sort()
+{
+	struct mcc_object_interface record_ = {
+		.size = sizeof(struct record),
+		.cmp = (mcc_compare_fn)&record_cmp,
+	};
+	struct record r = {}, *prev, *cur;
+	size_t i, n = 10000;
+	struct mcc_vector *v = mcc_vector_new(&record_);
+	assert(v != NULL);
+	/* Mostly sorted with an unordered tail, few distinct keys. */
+	for (i = 0; i < n; i++) {
+		r.key = i < n - 100 ? (int)(i / 50) : rand() % 300;
+		r.seq = i;
+		assert(!mcc_vector_push(v, &r));
+	}
+	assert(!mcc_vector_stable_sort(v));
+	for (i = 1; i < n; i++) {
+		assert(!mcc_vector_get(v, i - 1, (void **)&prev));
+		assert(!mcc_vector_get(v, i, (void **)&cur));
+		assert(prev->key < cur->key ||
+		       (prev->key == cur->key && prev->seq < cur->seq));
+	}
+	mcc_vector_drop(v);
+}
+
+struct counter {
+	size_t allocs;
+	size_t frees;
+};
+
+static void *count_alloc(void *ctx, size_t size)
+{
+	((struct counter *)ctx)->allocs++;
+	return malloc(size);
+}
+
+static void count_free(void *ctx, void *ptr)
+{
+	((struct counter *)ctx)->frees++;
+	free(ptr);
+}
+
+static void test_allocator()
+{
+	struct counter c = { 0, 0 };
+	struct mcc_allocator a = { count_alloc, NULL, count_free, &c };
+	struct mcc_vector *v;
+	size_t allocs;
+	int i, *ref;
+
+	/* Without realloc, growing goes through alloc and free. */
+	v = mcc_vector_new_with_allocator(&a, mcc_int());
+	assert(v != NULL);
+	for (i = 0; i < 1000; i++)
+		assert(!mcc_vector_push(v, &i));
+	for (i = 0; i < 1000; i++)
+		assert(!mcc_vector_get(v, i, (void **)&ref) && *ref == i);
+	assert(c.allocs > 2 && c.frees == c.allocs - 2);
+	assert(!mcc_vector_shrink_to_fit(v));
+	assert(!mcc_vector_get(v, 999, (void **)&ref) && *ref == 999);
+
+	/* Sort scratch buffers are taken from the allocator too. */
+	allocs = c.allocs;
+	assert(!mcc_vector_sort(v) && !mcc_vector_stable_sort(v));
+	assert(c.allocs == allocs + 2 && c.frees == c.allocs - 2);
+	mcc_vector_drop(v);
+	assert(c.allocs == c.frees);
+}
+
+static void test_arena()
+{
+	struct mcc_arena *arena = mcc_arena_new(0);
+	struct mcc_vector *v, *w;
+	size_t mark;
+	int i, *ref;
+
+	assert(arena != NULL);
+	v = mcc_vector_new_in(arena, mcc_int());
+	assert(v != NULL);
+	for (i = 0; i < 1000; i++)
+		assert(!mcc_vector_push(v, &i));
+	for (i = 0; i < 1000; i++)
+		assert(!mcc_vector_get(v, i, (void **)&ref) && *ref == i);
+
+	mark = mcc_arena_mark(arena);
+	w = mcc_vector_new_in(arena, &fruit_);
+	assert(w != NULL);
+	assert(!mcc_vector_push(w, fruit_new(&(struct fruit){}, "Apple")));
+	assert(!mcc_vector_push(w, fruit_new(&(struct fruit){}, "Pear")));
+	putchar('\t');
+	mcc_vector_drop(w);
+	mcc_arena_release(arena, mark);
+
+	assert(mcc_vector_len(v) == 1000);
+	assert(!mcc_vector_shrink_to_fit(v));
+	mcc_vector_drop(v);
+	mcc_arena_drop(arena);
+}
+
+static void test_iter_init()
+{
+	struct mcc_vector_iter iter;
+	int *refs[5];
+	size_t i, n, total = 0;
+	struct mcc_vector *v = mcc_vector_new(mcc_int());
+	assert(v != NULL);
+	for (i = 0; i < 16; i++)
+		assert(!mcc_vector_push(v, &(int){i}));
+	assert(!mcc_vector_iter_init(&iter, v));
+	while ((n = mcc_vector_iter_next_n(&iter, (void **)refs, 5))) {
+		for (i = 0; i < n; i++)
+			assert(*refs[i] == total + i);
+		total += n;
+	}
+	assert(total == 16);
+	assert(!mcc_vector_iter_next(&iter, (void **)refs));
+	mcc_vector_drop(v);
+}
+
+static void test_for_each()
+{
+	int i, *ref;
+	long sum = 0;
+	struct mcc_vector *v = mcc_vector_new(mcc_int());
+	assert(v != NULL);
+	for (i = 0; i < 16; i++)
+		assert(!mcc_vector_push(v, &(int){i}));
+
+	/* 0 + 1 + ... + 13 = 91, adding 14 would reach 100. */
+	assert(mcc_vector_fold(v, sum_below_100, &sum) == 14);
+	assert(sum == 91);
+	i = mcc_vector_for_each(v, double_below, &(int){10});
+	assert(i == OUT_OF_RANGE);
+	assert(!mcc_vector_for_each(v, double_below, &(int){100}));
+	for (i = 0; i < 16; i++) {
+		assert(!mcc_vector_get(v, i, (void **)&ref));
+		assert(*ref == (i < 10 ? i * 4 : i * 2));
+	}
+	mcc_vector_drop(v);
+}
+
 int main(void)
 {
 	test_push_and_pop();
 	test_insert_and_remove();
 	test_drop_call();
 	test_iterator();
+	test_iter_init();
+	test_for_each();
+	test_radix_sort();
+	test_par_sort();
+	test_stable_sort();
+	test_allocator();
+	test_arena();
 	puts("testing done");
 	return 0;
 }
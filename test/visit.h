@@ -0,0 +1,20 @@
+#include "mcc_err.h"
+#include <stdbool.h>
+
+/* Doubles every element and stops at the first one not below *ctx. */
+static inline int double_below(void *elem, void *ctx)
+{
+	if (*(int *)elem >= *(int *)ctx)
+		return OUT_OF_RANGE;
+	*(int *)elem *= 2;
+	return OK;
+}
+
+/* Adds elements of type int to a long for as long as it stays below 100. */
+static inline bool sum_below_100(const void *elem, void *acc)
+{
+	if (*(long *)acc + *(const int *)elem >= 100)
+		return false;
+	*(long *)acc += *(const int *)elem;
+	return true;
+}